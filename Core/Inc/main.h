@@ -41,6 +41,11 @@ extern "C" {
 
 /* Exported constants --------------------------------------------------------*/
 /* USER CODE BEGIN EC */
+/* 1: run the application as CMSIS-RTOS2 threads (App_RTOS), a kernel must be
+   added to the build. 0: run it on the cooperative Scheduler. */
+#ifndef USE_CMSIS_RTOS2
+#define USE_CMSIS_RTOS2 0
+#endif
 
 /* USER CODE END EC */
 
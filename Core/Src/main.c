@@ -21,9 +21,20 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "App_RTOS.h"
 #include "DHT22.h"
+#include "DHT22_History.h"
+#include "FlashLog.h"
+#include "FlashLog_HAL.h"
+#include "I2C_Bus.h"
 #include "LCD_I2C.h"
-#include "stdio.h"
+#include "LowPower.h"
+#include "Profiler.h"
+#include "Scheduler.h"
+#include "Telemetry.h"
+#include "Timebase.h"
+#include "string.h"
+#include <stdio.h>
 #include "stm32f1xx_hal.h"
 #include "stm32f1xx_hal_def.h"
 /* USER CODE END Includes */
@@ -35,6 +46,33 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+/* Define to time a full LCD redraw at 100 and 400 kHz on start-up */
+/* #define LCD_BENCHMARK */
+
+/* Define to stream the LCD backpack in Fast Mode. The PCF8574 is only rated
+   for 100 kHz: check with LCD_BENCHMARK that the module keeps up first */
+/* #define LCD_FAST_MODE */
+
+#ifdef LCD_FAST_MODE
+#define APP_LCD_PROFILE (&I2C_Bus_Fast)
+#else
+#define APP_LCD_PROFILE (&I2C_Bus_Standard)
+#endif
+
+/* Define to measure the telemetry frame rate at 115200 and 921600 baud */
+/* #define TELEMETRY_BENCHMARK */
+
+/* Wake-up of the LCD task once its queue has drained, a drawing kicks it */
+#define APP_LCD_PARK_MS 60000U
+
+/* One flash log record per period: the mean of the last minute */
+#define APP_LOG_INTERVAL_MS 60000U
+
+/* Period of the power report (duty cycle, estimated current) */
+#define APP_POWER_REPORT_MS 60000U
+
+/* Period of the profiler report on SWO, with PROFILER_ENABLE builds */
+#define APP_PROFILE_DUMP_MS 60000U
 
 /* USER CODE END PD */
 
@@ -45,23 +83,61 @@
 
 /* Private variables ---------------------------------------------------------*/
 I2C_HandleTypeDef hi2c1;
+DMA_HandleTypeDef hdma_i2c1_tx;
+DMA_HandleTypeDef hdma_i2c1_rx;
+
+RTC_HandleTypeDef hrtc;
 
 TIM_HandleTypeDef htim1;
+TIM_HandleTypeDef htim2;
+DMA_HandleTypeDef hdma_tim2_ch1;
+
+UART_HandleTypeDef huart1;
+DMA_HandleTypeDef hdma_usart1_tx;
 
 /* USER CODE BEGIN PV */
 DHT22_HandleTypeDef dht22_1;
 LCD_HandleTypeDef hlcd;
-
-float temperature = 0.0f, humidity = 0.0f;
-uint32_t last_read = 0;
+I2C_Bus_HandleTypeDef hbus1;
+Scheduler_HandleTypeDef sched;
+LowPower_HandleTypeDef hlp;
+LowPower_ReportTypeDef power_report;
+Telemetry_HandleTypeDef htel;
+static int8_t lcd_task = -1;
+
+DHT22_ReadingTypeDef reading = {0};
+
+/* Trend of the last minute and five minutes at DHT22_MIN_INTERVAL_MS */
+DHT22_HistoryTypeDef history;
+int8_t history_1min = -1;
+int8_t history_5min = -1;
+
+/* Persistent log; timestamps are seconds, continued across resets */
+FlashLog_HandleTypeDef hflog;
+uint32_t log_epoch;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_TIM1_Init(void);
 static void MX_I2C1_Init(void);
+static void MX_TIM2_Init(void);
+static void MX_RTC_Init(void);
+static void MX_USART1_UART_Init(void);
 /* USER CODE BEGIN PFP */
+static void DHT22_ReadCplt(DHT22_HandleTypeDef *dht22x, HAL_StatusTypeDef status);
+static void App_SampleTask(void *arg);
+static void App_LcdTask(void *arg);
+static void App_ShowReading(void *arg);
+static void App_DrawReading(LCD_HandleTypeDef *LCDx, const DHT22_ReadingTypeDef *r);
+static void App_LogTask(void *arg);
+static void App_PowerTask(void *arg);
+#if PROFILER_ENABLE
+static void App_ProfileTask(void *arg);
+#endif
+static void App_Idle(uint32_t sleep_ms);
 
 /* USER CODE END PFP */
 
@@ -99,21 +175,151 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_TIM1_Init();
   MX_I2C1_Init();
+  MX_TIM2_Init();
+  MX_RTC_Init();
+  MX_USART1_UART_Init();
   /* USER CODE BEGIN 2 */
+  /* TIM1 runs free at 1 MHz and is shared by the DHT22 and LCD drivers */
+  if (Timebase_Init(&htim1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /* DWT cycle counter for the profiling probes, a no-op unless enabled */
+  if (Profiler_Init() != HAL_OK)
+  {
+    Error_Handler();
+  }
+
   HAL_StatusTypeDef status = DHT22_Init(&dht22_1, &htim1, GPIOA, GPIO_PIN_0);
   if (status != HAL_OK)
   {
     Error_Handler();
   }
 
+  /* PA0 is TIM2_CH1: DMA1 channel 5 stores the frame, the CPU stays free */
+  status = DHT22_Init_Async(&dht22_1, &htim2, TIM_CHANNEL_1, DHT22_ReadCplt);
+  if (status != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /* I2C1 runs at 100 kHz; the LCD backpack only moves to Fast Mode with
+     LCD_FAST_MODE. A slave left holding SDA (e.g. by a reset mid-transfer)
+     is clocked free on PB6/PB7. */
+  I2C_Bus_Init(&hbus1, &hi2c1);
+  I2C_Bus_SetPins(&hbus1, GPIOB, GPIO_PIN_6, GPIOB, GPIO_PIN_7);
+  I2C_Bus_SetProfile(&hbus1, LCD_ADDR, APP_LCD_PROFILE);
+
   LCD_Init(&hlcd, &hi2c1, LCD_ADDR);
+  LCD_SetBus(&hlcd, &hbus1);
+
+#ifdef LCD_BENCHMARK
+  {
+    char line[LCD_COLS + 1];
+    uint32_t std_us, fast_us;
+
+    LCD_ClearFrame(&hlcd);
+    LCD_WriteString(&hlcd, 0, 0, "0123456789ABCDEF");
+    LCD_WriteString(&hlcd, 0, 1, "FEDCBA9876543210");
+
+    I2C_Bus_SetProfile(&hbus1, LCD_ADDR, &I2C_Bus_Standard);
+    std_us = LCD_Benchmark(&hlcd);
+    I2C_Bus_SetProfile(&hbus1, LCD_ADDR, &I2C_Bus_Fast);
+    fast_us = LCD_Benchmark(&hlcd);
+    I2C_Bus_SetProfile(&hbus1, LCD_ADDR, APP_LCD_PROFILE);
+
+    LCD_ClearFrame(&hlcd);
+    {
+      PROFILER_SCOPE("snprintf");
+      snprintf(line, sizeof(line), "100k: %lu us", (unsigned long)std_us);
+    }
+    LCD_WriteString(&hlcd, 0, 0, line);
+    {
+      PROFILER_SCOPE("snprintf");
+      snprintf(line, sizeof(line), "400k: %lu us", (unsigned long)fast_us);
+    }
+    LCD_WriteString(&hlcd, 0, 1, line);
+    LCD_Flush(&hlcd);
+    LCD_WaitIdle(&hlcd);
+    HAL_Delay(3000);
+  }
+#endif
+
+  /* Readings and power reports are streamed on USART1 TX (PA9) by DMA */
+  if (Telemetry_Init(&htel, &huart1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+#ifdef TELEMETRY_BENCHMARK
+  {
+    static const uint32_t bauds[2] = {115200U, 921600U};
+    char line[LCD_COLS + 1];
+
+    LCD_ClearFrame(&hlcd);
+    for (uint8_t i = 0; i < 2U; i++)
+    {
+      huart1.Init.BaudRate = bauds[i];
+      if (HAL_UART_Init(&huart1) != HAL_OK)
+      {
+        Error_Handler();
+      }
+      snprintf(line, sizeof(line), "%lu:%lu/s", (unsigned long)bauds[i],
+               (unsigned long)Telemetry_Benchmark(&htel, 1000U));
+      LCD_WriteString(&hlcd, 0, i, line);
+    }
+    LCD_Flush(&hlcd);
+    LCD_WaitIdle(&hlcd);
+    HAL_Delay(3000);
+
+    huart1.Init.BaudRate = 115200U;
+    if (HAL_UART_Init(&huart1) != HAL_OK)
+    {
+      Error_Handler();
+    }
+  }
+#endif
+
   LCD_Clear_Display(&hlcd);
-  LCD_SetCursor(&hlcd, 0, 0);
-  LCD_Print(&hlcd, "DHT22 + LCD");
-  LCD_SetCursor(&hlcd, 0, 1);
-  LCD_Print(&hlcd, "Initialized!");
+  LCD_WriteString(&hlcd, 0, 0, "DHT22 + LCD");
+  LCD_WriteString(&hlcd, 0, 1, "Initialized!");
+  LCD_Flush(&hlcd);
+
+#if USE_CMSIS_RTOS2
+  /* Acquisition, display and logging run as threads from here on */
+  App_RTOS_Start(&dht22_1, &hlcd, App_DrawReading);
+  Error_Handler();
+#endif
+
+  DHT22_History_Init(&history);
+  history_1min = DHT22_History_AddWindow(&history, 60000U / DHT22_MIN_INTERVAL_MS);
+  history_5min = DHT22_History_AddWindow(&history, 300000U / DHT22_MIN_INTERVAL_MS);
+
+  /* There is no calendar: resume counting right after the newest record */
+  if (FlashLog_Init(&hflog, &FlashLog_HAL_Flash) != FLASHLOG_OK)
+  {
+    Error_Handler();
+  }
+  log_epoch = FlashLog_LastTime(&hflog) + 1U;
+
+  /* Between samples the core stops; the RTC alarm wakes it before the
+     next deadline and SystemClock_Config() brings back HSE and the PLL */
+  LowPower_Init(&hlp, &hrtc, SystemClock_Config);
+
+  /* Sampling and display run as tasks; interrupt results come back through
+     the deferred queue and the core sleeps whenever nothing is due */
+  Scheduler_Init(&sched, HAL_GetTick, App_Idle);
+  Scheduler_AddTask(&sched, App_SampleTask, &dht22_1, 0, DHT22_MIN_INTERVAL_MS);
+  lcd_task = Scheduler_AddTask(&sched, App_LcdTask, &hlcd, 0, 1);
+  Scheduler_AddTask(&sched, App_LogTask, &hflog, APP_LOG_INTERVAL_MS, APP_LOG_INTERVAL_MS);
+  Scheduler_AddTask(&sched, App_PowerTask, &hlp, APP_POWER_REPORT_MS, APP_POWER_REPORT_MS);
+#if PROFILER_ENABLE
+  Scheduler_AddTask(&sched, App_ProfileTask, NULL, APP_PROFILE_DUMP_MS, APP_PROFILE_DUMP_MS);
+#endif
 
   /* USER CODE END 2 */
 
@@ -124,28 +330,7 @@ int main(void)
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
-    if (HAL_GetTick() - last_read >= 2000)
-    {
-      if (DHT22_Read_Data(&dht22_1, &humidity, &temperature) == HAL_OK)
-      {
-        LCD_Clear_Display(&hlcd);
-        LCD_SetCursor(&hlcd, 0, 0);
-
-        /* Display temperature */
-        char temp_str[16];
-        snprintf(temp_str, sizeof(temp_str), "Temp: %.1f C", temperature);
-        LCD_Print(&hlcd, temp_str);
-
-        LCD_SetCursor(&hlcd, 0, 1);
-
-        /* Display humidity */
-        char hum_str[16];
-        snprintf(hum_str, sizeof(hum_str), "Humidity: %.1f%%", humidity);
-        LCD_Print(&hlcd, hum_str);
-      }
-
-      last_read = HAL_GetTick();
-    }
+    Scheduler_Dispatch(&sched);
   }
   /* USER CODE END 3 */
 }
@@ -158,13 +343,15 @@ void SystemClock_Config(void)
 {
   RCC_OscInitTypeDef RCC_OscInitStruct = {0};
   RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+  RCC_PeriphCLKInitTypeDef PeriphClkInit = {0};
 
   /** Initializes the RCC Oscillators according to the specified parameters
    * in the RCC_OscInitTypeDef structure.
    */
-  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSE;
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSE | RCC_OSCILLATORTYPE_LSE;
   RCC_OscInitStruct.HSEState = RCC_HSE_ON;
   RCC_OscInitStruct.HSEPredivValue = RCC_HSE_PREDIV_DIV1;
+  RCC_OscInitStruct.LSEState = RCC_LSE_ON;
   RCC_OscInitStruct.HSIState = RCC_HSI_ON;
   RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
   RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSE;
@@ -186,6 +373,12 @@ void SystemClock_Config(void)
   {
     Error_Handler();
   }
+  PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_RTC;
+  PeriphClkInit.RTCClockSelection = RCC_RTCCLKSOURCE_LSE;
+  if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK)
+  {
+    Error_Handler();
+  }
 }
 
 /**
@@ -221,6 +414,36 @@ static void MX_I2C1_Init(void)
   /* USER CODE END I2C1_Init 2 */
 }
 
+/**
+ * @brief RTC Initialization Function
+ * @param None
+ * @retval None
+ */
+static void MX_RTC_Init(void)
+{
+
+  /* USER CODE BEGIN RTC_Init 0 */
+
+  /* USER CODE END RTC_Init 0 */
+
+  /* USER CODE BEGIN RTC_Init 1 */
+
+  /* USER CODE END RTC_Init 1 */
+
+  /** Initialize RTC Only
+   */
+  hrtc.Instance = RTC;
+  hrtc.Init.AsynchPrediv = 31;
+  hrtc.Init.OutPut = RTC_OUTPUTSOURCE_NONE;
+  if (HAL_RTC_Init(&hrtc) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN RTC_Init 2 */
+  /* 32768 Hz / 32: the counter is a 1024 Hz wake-up timebase, not a calendar */
+  /* USER CODE END RTC_Init 2 */
+}
+
 /**
  * @brief TIM1 Initialization Function
  * @param None
@@ -266,6 +489,120 @@ static void MX_TIM1_Init(void)
   /* USER CODE END TIM1_Init 2 */
 }
 
+/**
+ * @brief TIM2 Initialization Function
+ * @param None
+ * @retval None
+ */
+static void MX_TIM2_Init(void)
+{
+
+  /* USER CODE BEGIN TIM2_Init 0 */
+
+  /* USER CODE END TIM2_Init 0 */
+
+  TIM_ClockConfigTypeDef sClockSourceConfig = {0};
+  TIM_MasterConfigTypeDef sMasterConfig = {0};
+  TIM_IC_InitTypeDef sConfigIC = {0};
+
+  /* USER CODE BEGIN TIM2_Init 1 */
+
+  /* USER CODE END TIM2_Init 1 */
+  htim2.Instance = TIM2;
+  htim2.Init.Prescaler = 71;
+  htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim2.Init.Period = 65535;
+  htim2.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim2) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+  if (HAL_TIM_ConfigClockSource(&htim2, &sClockSourceConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (HAL_TIM_IC_Init(&htim2) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+  sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+  if (HAL_TIMEx_MasterConfigSynchronization(&htim2, &sMasterConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sConfigIC.ICPolarity = TIM_INPUTCHANNELPOLARITY_FALLING;
+  sConfigIC.ICSelection = TIM_ICSELECTION_DIRECTTI;
+  sConfigIC.ICPrescaler = TIM_ICPSC_DIV1;
+  sConfigIC.ICFilter = 0;
+  if (HAL_TIM_IC_ConfigChannel(&htim2, &sConfigIC, TIM_CHANNEL_1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN TIM2_Init 2 */
+
+  /* USER CODE END TIM2_Init 2 */
+}
+
+/**
+ * @brief USART1 Initialization Function
+ * @param None
+ * @retval None
+ */
+static void MX_USART1_UART_Init(void)
+{
+
+  /* USER CODE BEGIN USART1_Init 0 */
+
+  /* USER CODE END USART1_Init 0 */
+
+  /* USER CODE BEGIN USART1_Init 1 */
+
+  /* USER CODE END USART1_Init 1 */
+  huart1.Instance = USART1;
+  huart1.Init.BaudRate = 115200;
+  huart1.Init.WordLength = UART_WORDLENGTH_8B;
+  huart1.Init.StopBits = UART_STOPBITS_1;
+  huart1.Init.Parity = UART_PARITY_NONE;
+  huart1.Init.Mode = UART_MODE_TX_RX;
+  huart1.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+  huart1.Init.OverSampling = UART_OVERSAMPLING_16;
+  if (HAL_UART_Init(&huart1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN USART1_Init 2 */
+
+  /* USER CODE END USART1_Init 2 */
+}
+
+/**
+ * Enable DMA controller clock
+ */
+static void MX_DMA_Init(void)
+{
+
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  /* DMA1_Channel4_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel4_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel4_IRQn);
+  /* DMA1_Channel5_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel5_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel5_IRQn);
+  /* DMA1_Channel6_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel6_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel6_IRQn);
+  /* DMA1_Channel7_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel7_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel7_IRQn);
+
+}
+
 /**
  * @brief GPIO Initialization Function
  * @param None
@@ -273,7 +610,6 @@ static void MX_TIM1_Init(void)
  */
 static void MX_GPIO_Init(void)
 {
-  GPIO_InitTypeDef GPIO_InitStruct = {0};
   /* USER CODE BEGIN MX_GPIO_Init_1 */
 
   /* USER CODE END MX_GPIO_Init_1 */
@@ -283,22 +619,172 @@ static void MX_GPIO_Init(void)
   __HAL_RCC_GPIOA_CLK_ENABLE();
   __HAL_RCC_GPIOB_CLK_ENABLE();
 
-  /*Configure GPIO pin Output Level */
-  HAL_GPIO_WritePin(GPIOA, GPIO_PIN_0, GPIO_PIN_RESET);
-
-  /*Configure GPIO pin : PA0 */
-  GPIO_InitStruct.Pin = GPIO_PIN_0;
-  GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
-  GPIO_InitStruct.Pull = GPIO_NOPULL;
-  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
-  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
-
   /* USER CODE BEGIN MX_GPIO_Init_2 */
 
   /* USER CODE END MX_GPIO_Init_2 */
 }
 
 /* USER CODE BEGIN 4 */
+static void DHT22_ReadCplt(DHT22_HandleTypeDef *dht22x, HAL_StatusTypeDef status)
+{
+#if USE_CMSIS_RTOS2
+  App_RTOS_ReadCplt(dht22x, status);
+#else
+  /* Interrupt context: hand the reading to the main loop */
+  if (status == HAL_OK)
+  {
+    Scheduler_Post(&sched, App_ShowReading, dht22x);
+  }
+#endif
+}
+
+static void App_SampleTask(void *arg)
+{
+  DHT22_StartAsync((DHT22_HandleTypeDef *)arg);
+}
+
+static void App_LcdTask(void *arg)
+{
+  LCD_HandleTypeDef *LCDx = (LCD_HandleTypeDef *)arg;
+
+  /* Resumes LCD output held back while slow commands execute */
+  LCD_Process(LCDx);
+
+  /* Drained: stop polling so the idle hook may stop the core */
+  if (LCD_IsIdle(LCDx))
+  {
+    Scheduler_Reschedule(&sched, lcd_task, APP_LCD_PARK_MS);
+  }
+}
+
+static void App_ShowReading(void *arg)
+{
+  DHT22_HandleTypeDef *dht22x = (DHT22_HandleTypeDef *)arg;
+  reading = dht22x->reading;
+  DHT22_History_Push(&history, reading.humidity, reading.temperature);
+  Telemetry_SendReading(&htel, &reading);
+  App_DrawReading(&hlcd, &reading);
+  Scheduler_Reschedule(&sched, lcd_task, 0);
+}
+
+static void App_DrawReading(LCD_HandleTypeDef *LCDx, const DHT22_ReadingTypeDef *r)
+{
+  PROFILER_SCOPE("App_DrawReading");
+
+  /* Redraw in RAM, LCD_Flush sends only the cells that changed */
+  LCD_ClearFrame(LCDx);
+
+  /* Display temperature */
+  char temp_str[17] = "Temp: ";
+  DHT22_FormatDeci(temp_str + strlen(temp_str), r->temperature);
+  strcat(temp_str, " C");
+  LCD_WriteString(LCDx, 0, 0, temp_str);
+
+  /* Display humidity */
+  char hum_str[17] = "Humidity: ";
+  DHT22_FormatDeci(hum_str + strlen(hum_str), r->humidity);
+  strcat(hum_str, "%");
+  LCD_WriteString(LCDx, 0, 1, hum_str);
+
+  LCD_Flush(LCDx);
+}
+
+static void App_LogTask(void *arg)
+{
+  DHT22_History_StatsTypeDef hum, temp;
+
+  if (DHT22_History_GetStats(&history, history_1min, DHT22_HISTORY_HUMIDITY, &hum) == 0U)
+  {
+    return; /* No reading recorded yet */
+  }
+  DHT22_History_GetStats(&history, history_1min, DHT22_HISTORY_TEMPERATURE, &temp);
+
+  /* Programs flash every FLASHLOG_BATCH records, stalling the CPU briefly */
+  FlashLog_Append((FlashLog_HandleTypeDef *)arg, log_epoch + HAL_GetTick() / 1000U, hum.mean, temp.mean);
+}
+
+static void App_PowerTask(void *arg)
+{
+  LowPower_HandleTypeDef *hlpx = (LowPower_HandleTypeDef *)arg;
+  LowPower_GetReport(hlpx, &power_report);
+  LowPower_ResetStats(hlpx);
+
+  Telemetry_MessageTypeDef msg;
+  msg.type = TELEMETRY_MSG_POWER;
+  msg.tick = HAL_GetTick();
+  msg.power.duty_permille = power_report.duty_permille;
+  msg.power.average_ua = power_report.average_ua;
+  Telemetry_Send(&htel, &msg);
+}
+
+#if PROFILER_ENABLE
+static void App_ProfileTask(void *arg)
+{
+  UNUSED(arg);
+
+  /* Report the last period on ITM port 0 (SWO), then start a new one */
+  Profiler_Dump(NULL);
+  Profiler_Reset();
+}
+#endif
+
+static void App_Idle(uint32_t sleep_ms)
+{
+  /* STOP freezes TIM1/TIM2, DMA, I2C and USART: only with no transfer, start
+     pulse or capture in flight, otherwise SLEEP until SysTick or an interrupt */
+  uint8_t allow_stop = LCD_IsIdle(&hlcd) && dht22_1.state == DHT22_STATE_READY &&
+                       HAL_I2C_GetState(&hi2c1) == HAL_I2C_STATE_READY && Telemetry_IsIdle(&htel);
+  LowPower_Idle(&hlp, sleep_ms, allow_stop);
+}
+
+void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim)
+{
+  DHT22_TIM_IC_CaptureCallback(&dht22_1, htim);
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  DHT22_TIM_PeriodElapsedCallback(&dht22_1, htim);
+}
+
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  /* Bus first: it completes queued chunks and starts the next transaction */
+  I2C_Bus_MasterTxCpltCallback(&hbus1, hi2c);
+  LCD_I2C_MasterTxCpltCallback(&hlcd, hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+  I2C_Bus_ErrorCallback(&hbus1, hi2c);
+  LCD_I2C_ErrorCallback(&hlcd, hi2c);
+}
+
+/* Reads and register accesses only run through the bus queue */
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  I2C_Bus_MasterRxCpltCallback(&hbus1, hi2c);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  I2C_Bus_MemTxCpltCallback(&hbus1, hi2c);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  I2C_Bus_MemRxCpltCallback(&hbus1, hi2c);
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  Telemetry_UART_TxCpltCallback(&htel, huart);
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+  Telemetry_UART_ErrorCallback(&htel, huart);
+}
 
 /* USER CODE END 4 */
 
@@ -0,0 +1,212 @@
+#include "main.h"
+
+#if USE_CMSIS_RTOS2
+
+#include "App_RTOS.h"
+#include "Timebase.h"
+#include "cmsis_os2.h"
+
+/* Thread flag set by the capture callback */
+#define APP_RTOS_FLAG_DONE 0x0001U
+
+static DHT22_HandleTypeDef *app_dht22;
+static LCD_HandleTypeDef *app_lcd;
+static void (*app_draw)(LCD_HandleTypeDef *LCDx, const DHT22_ReadingTypeDef *reading);
+
+static osThreadId_t acq_thread;
+static osMessageQueueId_t display_queue;
+static osMessageQueueId_t log_queue;
+static App_RTOS_StatsTypeDef app_stats;
+
+static const osThreadAttr_t acq_attr = {
+    .name = "acquire",
+    .priority = osPriorityRealtime,
+    .stack_size = 512,
+};
+
+static const osThreadAttr_t display_attr = {
+    .name = "display",
+    .priority = osPriorityNormal,
+    .stack_size = 768,
+};
+
+static const osThreadAttr_t logger_attr = {
+    .name = "logger",
+    .priority = osPriorityLow,
+    .stack_size = 512,
+};
+
+static void App_RTOS_AcqThread(void *argument)
+{
+    uint32_t next = osKernelGetTickCount();
+
+    for (;;)
+    {
+        App_RTOS_SampleTypeDef sample;
+
+        osThreadFlagsClear(APP_RTOS_FLAG_DONE);
+        sample.status = DHT22_StartAsync(app_dht22);
+        if (sample.status == HAL_OK)
+        {
+            uint32_t flags = osThreadFlagsWait(APP_RTOS_FLAG_DONE, osFlagsWaitAny, APP_RTOS_FRAME_TIMEOUT_MS);
+            sample.status = (flags & osFlagsError) ? HAL_TIMEOUT : app_dht22->lastStatus;
+        }
+        sample.reading = app_dht22->reading;
+        sample.error = DHT22_GetError(app_dht22);
+        sample.tick = osKernelGetTickCount();
+
+        // Never block here: a slow consumer loses samples, not sensor timing
+        if (sample.status != HAL_BUSY)
+        {
+            osMessageQueuePut(display_queue, &sample, 0, 0);
+            osMessageQueuePut(log_queue, &sample, 0, 0);
+        }
+
+        next += DHT22_MIN_INTERVAL_MS;
+        osDelayUntil(next);
+    }
+}
+
+static void App_RTOS_DisplayThread(void *argument)
+{
+    App_RTOS_SampleTypeDef sample;
+
+    for (;;)
+    {
+        if (osMessageQueueGet(display_queue, &sample, NULL, APP_RTOS_LCD_SERVICE_MS) == osOK &&
+            sample.status == HAL_OK)
+        {
+            app_draw(app_lcd, &sample.reading);
+        }
+        LCD_Process(app_lcd);
+    }
+}
+
+static void App_RTOS_LoggerThread(void *argument)
+{
+    App_RTOS_SampleTypeDef sample;
+
+    for (;;)
+    {
+        if (osMessageQueueGet(log_queue, &sample, NULL, osWaitForever) != osOK)
+        {
+            continue;
+        }
+        if (sample.status == HAL_OK)
+        {
+            app_stats.ok++;
+        }
+        else
+        {
+            app_stats.failed++;
+        }
+        app_stats.lastTick = sample.tick;
+    }
+}
+
+HAL_StatusTypeDef App_RTOS_Start(DHT22_HandleTypeDef *dht22x, LCD_HandleTypeDef *LCDx,
+                                 void (*draw)(LCD_HandleTypeDef *LCDx, const DHT22_ReadingTypeDef *reading))
+{
+    if (dht22x == NULL || LCDx == NULL || draw == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    app_dht22 = dht22x;
+    app_lcd = LCDx;
+    app_draw = draw;
+
+    if (osKernelInitialize() != osOK)
+    {
+        return HAL_ERROR;
+    }
+
+    display_queue = osMessageQueueNew(APP_RTOS_QUEUE_DEPTH, sizeof(App_RTOS_SampleTypeDef), NULL);
+    log_queue = osMessageQueueNew(APP_RTOS_QUEUE_DEPTH, sizeof(App_RTOS_SampleTypeDef), NULL);
+    acq_thread = osThreadNew(App_RTOS_AcqThread, NULL, &acq_attr);
+    if (display_queue == NULL || log_queue == NULL || acq_thread == NULL ||
+        osThreadNew(App_RTOS_DisplayThread, NULL, &display_attr) == NULL ||
+        osThreadNew(App_RTOS_LoggerThread, NULL, &logger_attr) == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    osKernelStart();
+    return HAL_ERROR;
+}
+
+void App_RTOS_ReadCplt(DHT22_HandleTypeDef *dht22x, HAL_StatusTypeDef status)
+{
+    osThreadFlagsSet(acq_thread, APP_RTOS_FLAG_DONE);
+}
+
+void App_RTOS_GetStats(App_RTOS_StatsTypeDef *stats)
+{
+    *stats = app_stats;
+}
+
+/* Milliseconds counted before the kernel started, and the cycle count they
+ * end at. The kernel tick stays 0 until osKernelStart() and nothing drives
+ * uwTick, so start-up code (SystemClock_Config, MX_RTC_Init, LCD_Init, HAL
+ * I2C timeouts) would otherwise wait on a frozen tick forever. */
+static uint32_t app_bootTick;
+static uint32_t app_bootCycles;
+
+static uint8_t App_RTOS_KernelStarted(void)
+{
+    osKernelState_t state = osKernelGetState();
+    return (state == osKernelRunning || state == osKernelLocked || state == osKernelSuspended) ? 1U : 0U;
+}
+
+/* The kernel configures SysTick when it starts, HAL must not claim it. Until
+ * then the tick is counted on the DWT cycle counter at SystemCoreClock; HAL
+ * calls this again after every clock change. */
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    return HAL_OK;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    if (App_RTOS_KernelStarted())
+    {
+        // Carry on from the boot count, stored ticks stay comparable
+        return app_bootTick + osKernelGetTickCount();
+    }
+
+    // Whole milliseconds since the last call; callers poll far more often
+    // than the 59 s the 32-bit counter takes to wrap at 72 MHz
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t per_ms = SystemCoreClock / 1000U;
+    uint32_t ms = (DWT->CYCCNT - app_bootCycles) / per_ms;
+    app_bootTick += ms;
+    app_bootCycles += ms * per_ms;
+    uint32_t tick = app_bootTick;
+    __set_PRIMASK(primask);
+
+    return tick;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    if (App_RTOS_KernelStarted())
+    {
+        osDelay(Delay);
+        return;
+    }
+
+    // Busy-wait on the boot count: Timebase_Delay_us() falls back to
+    // HAL_Delay() itself while the timebase is not started
+    uint32_t start = HAL_GetTick();
+    if (Delay < HAL_MAX_DELAY)
+    {
+        Delay++; // At least the requested time, as the stock HAL_Delay()
+    }
+    while (HAL_GetTick() - start < Delay)
+        ;
+}
+
+#endif /* USE_CMSIS_RTOS2 */
@@ -0,0 +1,112 @@
+/**
+ ******************************************************************************
+ * @file           : App_RTOS.h
+ * @brief          : Header file for the CMSIS-RTOS2 application port.
+ *                   Runs DHT22 acquisition, display and logging as threads
+ *                   connected by message queues.
+ ******************************************************************************
+ * @attention
+ *
+ * Built only when USE_CMSIS_RTOS2 is set to 1 (main.h); the default firmware
+ * runs the same work on the cooperative Scheduler. The repository ships the
+ * CMSIS-RTOS2 API headers but no kernel: add a CMSIS-RTOS2 kernel (e.g.
+ * Keil RTX5 sources and RTX_Config.h) to the build before enabling the port.
+ * The kernel owns SysTick, SVC and PendSV; stm32f1xx_it.c drops its
+ * handlers and the HAL tick is taken from the kernel tick (1 kHz). Before
+ * osKernelStart() the HAL tick is counted on the DWT cycle counter, so the
+ * start-up timeouts and delays in main() still expire.
+ *
+ * Threads, highest priority first:
+ *  - acquisition (osPriorityRealtime): starts a DHT22 frame every
+ *    DHT22_MIN_INTERVAL_MS on an absolute schedule, waits for the capture
+ *    callback and posts the sample to both queues without blocking, so no
+ *    other thread can delay the start pulse or the frame deadline;
+ *  - display (osPriorityNormal): draws samples from its queue and services
+ *    the LCD transmit queue, never waiting on the sensor;
+ *  - logger (osPriorityLow): consumes every sample, successful or not.
+ *
+ * Example usage:
+ * @code
+ *   // after DHT22_Init_Async() and LCD_Init()
+ *   App_RTOS_Start(&dht22_1, &hlcd, DrawReading); // does not return
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _APP_RTOS_H_
+#define _APP_RTOS_H_
+
+#include "DHT22.h"
+#include "LCD_I2C.h"
+
+/* -------------------------------------------------------------------------- */
+/*                              App Constants                                 */
+/* -------------------------------------------------------------------------- */
+
+/* Samples each queue can hold before the oldest reader falls behind */
+#define APP_RTOS_QUEUE_DEPTH 4U
+
+/* Longest wait for a DHT22 frame once the start pulse is sent */
+#define APP_RTOS_FRAME_TIMEOUT_MS 10U
+
+/* Period at which the display thread services the LCD transmit queue */
+#define APP_RTOS_LCD_SERVICE_MS 1U
+
+/* -------------------------------------------------------------------------- */
+/*                               App Structs                                  */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  One acquisition result, as passed through the queues
+ */
+typedef struct
+{
+    DHT22_ReadingTypeDef reading; /*!< Reading, valid when status is HAL_OK */
+    uint32_t tick;                /*!< Kernel tick at the end of the read */
+    HAL_StatusTypeDef status;     /*!< Result of the read */
+    uint32_t error;               /*!< DHT22_GetError() for failed reads */
+} App_RTOS_SampleTypeDef;
+
+/**
+ * @brief  Counters kept by the logger thread
+ */
+typedef struct
+{
+    uint32_t ok;       /*!< Successful reads */
+    uint32_t failed;   /*!< Timed out or corrupted reads */
+    uint32_t lastTick; /*!< Tick of the last sample */
+} App_RTOS_StatsTypeDef;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Create the queues and threads and start the kernel.
+ * @param  dht22x: DHT22 handle set up with DHT22_Init_Async().
+ * @param  LCDx: Initialized LCD handle, used only by the display thread.
+ * @param  draw: Renders a reading into the LCD framebuffer.
+ * @retval HAL_ERROR if the kernel objects could not be created, otherwise
+ *         does not return.
+ */
+HAL_StatusTypeDef App_RTOS_Start(DHT22_HandleTypeDef *dht22x, LCD_HandleTypeDef *LCDx,
+                                 void (*draw)(LCD_HandleTypeDef *LCDx, const DHT22_ReadingTypeDef *reading));
+
+/**
+ * @brief  DHT22 read complete hook, call from the DHT22 ReadCpltCallback.
+ *         Wakes the acquisition thread.
+ * @param  dht22x: Pointer to DHT22 handle structure.
+ * @param  status: Result of the read.
+ * @retval None
+ */
+void App_RTOS_ReadCplt(DHT22_HandleTypeDef *dht22x, HAL_StatusTypeDef status);
+
+/**
+ * @brief  Snapshot of the logger counters.
+ * @param  stats: Pointer to receive the counters.
+ * @retval None
+ */
+void App_RTOS_GetStats(App_RTOS_StatsTypeDef *stats);
+
+#endif /* _APP_RTOS_H_ */
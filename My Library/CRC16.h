@@ -0,0 +1,42 @@
+/**
+ ******************************************************************************
+ * @file           : CRC16.h
+ * @brief          : Header file for the CRC-16/CCITT-FALSE checksum.
+ *                   Protects records and frames written to flash or sent
+ *                   over a link.
+ ******************************************************************************
+ * @attention
+ *
+ * Polynomial 0x1021, initial value 0xFFFF, no reflection, no final XOR; the
+ * check value of "123456789" is 0x29B1. The STM32F1 CRC unit only computes
+ * CRC-32 on whole words, so this is done in software with a 16-entry nibble
+ * table (32 bytes of flash). Depends only on <stdint.h> and <stddef.h>.
+ *
+ * Example usage:
+ * @code
+ *   uint16_t crc = CRC16_Update(CRC16_INIT, header, sizeof(header));
+ *   crc = CRC16_Update(crc, payload, len);   // continue over a second part
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _CRC16_H_
+#define _CRC16_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Initial value of a new checksum */
+#define CRC16_INIT 0xFFFFU
+
+/**
+ * @brief  Extend a checksum over a block of bytes.
+ * @param  crc: CRC16_INIT, or the result over the preceding bytes.
+ * @param  data: Bytes to add.
+ * @param  len: Number of bytes.
+ * @retval Updated checksum.
+ */
+uint16_t CRC16_Update(uint16_t crc, const void *data, size_t len);
+
+#endif /* _CRC16_H_ */
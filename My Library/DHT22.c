@@ -1,148 +1,293 @@
 #include "DHT22.h"
+#include "Profiler.h"
+#include "Timebase.h"
 
-static void delayMicroSeconds(DHT22_HandleTypeDef *dht22x, uint16_t us)
+/* Direct register access to the data pin, a few cycles each */
+#define DHT22_PIN_READ(__DHT22__) ((((__DHT22__)->dataPort->IDR) & (__DHT22__)->dataPin) != 0U)
+#define DHT22_PIN_LOW(__DHT22__) ((__DHT22__)->dataPort->BRR = (__DHT22__)->dataPin)
+#define DHT22_PIN_RELEASE(__DHT22__) ((__DHT22__)->dataPort->BSRR = (__DHT22__)->dataPin)
+
+/* CNF/MODE nibbles of a pin in CRL/CRH */
+#define DHT22_CR_OUTPUT_PP 0x2U /* General purpose push-pull output, 2 MHz */
+#define DHT22_CR_OUTPUT_OD 0x6U /* General purpose open-drain output, 2 MHz */
+#define DHT22_CR_INPUT_PU 0x8U  /* Input with pull-up/down (pull-up when ODR = 1) */
+
+static inline void DHT22_PinOutput(DHT22_HandleTypeDef *dht22x)
 {
-    __HAL_TIM_SET_COUNTER(dht22x->htim, 0);
-    HAL_TIM_Base_Start(dht22x->htim);
-    while (__HAL_TIM_GET_COUNTER(dht22x->htim) < us)
-        ;
-    HAL_TIM_Base_Stop(dht22x->htim);
+    MODIFY_REG(*dht22x->pinCR, dht22x->pinCRMask, dht22x->pinCROutput);
 }
 
-static void delayMilliSeconds(DHT22_HandleTypeDef *dht22x, uint16_t ms)
+static inline void DHT22_PinInput(DHT22_HandleTypeDef *dht22x)
 {
-    for (uint16_t i = 0; i < ms; i++)
-    {
-        delayMicroSeconds(dht22x, 1000);
-    }
+    MODIFY_REG(*dht22x->pinCR, dht22x->pinCRMask, dht22x->pinCRInput);
 }
 
 static void DHT22_Start(DHT22_HandleTypeDef *dht22x)
 {
     /* First, Pin configuration is OUTPUT */
-    GPIO_InitTypeDef GPIO_InitStruct = {0};
-    GPIO_InitStruct.Pin = dht22x->dataPin;
-    GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
-    GPIO_InitStruct.Pull = GPIO_NOPULL;
-    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
-    HAL_GPIO_Init(dht22x->dataPort, &GPIO_InitStruct);
+    DHT22_PIN_LOW(dht22x);
+    DHT22_PinOutput(dht22x);
 
     /* Pull the DATA pin down for at least 1 -> 10ms */
-    HAL_GPIO_WritePin(dht22x->dataPort, dht22x->dataPin, GPIO_PIN_RESET);
-    delayMilliSeconds(dht22x, 2);
+    Timebase_Delay_us(DHT22_START_LOW_US);
 
-    /* Pull the DATA pin up and wait 20 - 40us */
-    HAL_GPIO_WritePin(dht22x->dataPort, dht22x->dataPin, GPIO_PIN_SET);
-    delayMicroSeconds(dht22x, 30);
+    /* Release the DATA pin (ODR = 1 also selects the input pull-up) */
+    DHT22_PIN_RELEASE(dht22x);
+    dht22x->frameStart = Timebase_Now_us();
 
-    /* Then, Pin configuration is INPUT*/
-    GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
-    GPIO_InitStruct.Pull = GPIO_PULLUP;
-    HAL_GPIO_Init(dht22x->dataPort, &GPIO_InitStruct);
+    /* Then, Pin configuration is INPUT, the sensor answers 20 - 40us later */
+    DHT22_PinInput(dht22x);
 }
 
-static HAL_StatusTypeDef DHT22_CheckResponse(DHT22_HandleTypeDef *dht22x)
+/*
+ * Wait while the data pin stays at the given level. The frame starts when the
+ * start signal is released, so every wait is bounded both by its own phase
+ * budget and by the frame deadline.
+ */
+static HAL_StatusTypeDef DHT22_WaitWhile(DHT22_HandleTypeDef *dht22x, GPIO_PinState level, uint16_t budget_us,
+                                         uint16_t *elapsed_us)
 {
-    /* Wait 40us after sending start signal */
-    delayMicroSeconds(dht22x, 40);
+    uint16_t start = Timebase_Now_us();
 
-    /* DHT22 should pull low for 80us */
-    if (HAL_GPIO_ReadPin(dht22x->dataPort, dht22x->dataPin))
+    while (DHT22_PIN_READ(dht22x) == level)
     {
-        return HAL_ERROR; /* No response */
+        if (Timebase_Elapsed_us(start) > budget_us ||
+            Timebase_Elapsed_us(dht22x->frameStart) > DHT22_FRAME_TIMEOUT_US)
+        {
+            return HAL_TIMEOUT;
+        }
     }
 
-    delayMicroSeconds(dht22x, 80);
+    if (elapsed_us != NULL)
+    {
+        *elapsed_us = Timebase_Elapsed_us(start);
+    }
+
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef DHT22_CheckResponse(DHT22_HandleTypeDef *dht22x)
+{
+    /* DHT22 answers 20 - 40us after the release and pulls low for 80us */
+    if (DHT22_WaitWhile(dht22x, GPIO_PIN_SET, DHT22_TIMEOUT_RESPONSE_LOW_US, NULL) != HAL_OK ||
+        DHT22_WaitWhile(dht22x, GPIO_PIN_RESET, DHT22_TIMEOUT_RESPONSE_LOW_US, NULL) != HAL_OK)
+    {
+        dht22x->ErrorCode = DHT22_ERROR_TIMEOUT_RESPONSE_LOW;
+        return HAL_TIMEOUT;
+    }
 
     /* DHT22 should pull high for 80us */
-    if (!HAL_GPIO_ReadPin(dht22x->dataPort, dht22x->dataPin))
+    if (DHT22_WaitWhile(dht22x, GPIO_PIN_SET, DHT22_TIMEOUT_RESPONSE_HIGH_US, NULL) != HAL_OK)
+    {
+        dht22x->ErrorCode = DHT22_ERROR_TIMEOUT_RESPONSE_HIGH;
+        return HAL_TIMEOUT;
+    }
+
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef DHT22_ReadBit(DHT22_HandleTypeDef *dht22x, uint8_t *bit)
+{
+    uint16_t high_us = 0;
+
+    /* Every bit starts with a 50us low pulse */
+    if (DHT22_WaitWhile(dht22x, GPIO_PIN_RESET, DHT22_TIMEOUT_BIT_START_US, NULL) != HAL_OK)
+    {
+        dht22x->ErrorCode = DHT22_ERROR_TIMEOUT_BIT_START;
+        return HAL_TIMEOUT;
+    }
+
+    /* Then 26 - 28us high for '0' or 70us high for '1' */
+    if (DHT22_WaitWhile(dht22x, GPIO_PIN_SET, DHT22_TIMEOUT_BIT_END_US, &high_us) != HAL_OK)
     {
-        return HAL_ERROR; /* Invalid response */
+        dht22x->ErrorCode = DHT22_ERROR_TIMEOUT_BIT_END;
+        return HAL_TIMEOUT;
     }
 
-    while (HAL_GPIO_ReadPin(dht22x->dataPort, dht22x->dataPin))
-        ;
+    *bit = (high_us > DHT22_BIT_HIGH_THRESHOLD_US) ? 1 : 0;
 
     return HAL_OK;
 }
 
-static uint8_t DHT22_ReadBit(DHT22_HandleTypeDef *dht22x)
+static HAL_StatusTypeDef DHT22_ReadByte(DHT22_HandleTypeDef *dht22x, uint8_t *byte)
 {
-    uint8_t bit_value = 0;
+    uint8_t bit;
 
-    while (!(HAL_GPIO_ReadPin(dht22x->dataPort, dht22x->dataPin)))
-        ;
+    *byte = 0;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        if (DHT22_ReadBit(dht22x, &bit) != HAL_OK)
+        {
+            return HAL_TIMEOUT;
+        }
+        *byte = (*byte << 1) | bit;
+    }
+    return HAL_OK;
+}
 
-    delayMicroSeconds(dht22x, 50);
+static HAL_StatusTypeDef DHT22_Convert(const uint8_t data[5], DHT22_ReadingTypeDef *reading)
+{
+    int16_t raw_humi, raw_temp;
 
-    if (HAL_GPIO_ReadPin(dht22x->dataPort, dht22x->dataPin))
+    if (data[4] != (uint8_t)(data[0] + data[1] + data[2] + data[3]))
     {
-        bit_value = 1;
+        return HAL_ERROR;
     }
-    else
+
+    raw_humi = (data[0] << 8) | data[1];
+    raw_temp = (data[2] << 8) | data[3];
+
+    if (raw_temp & 0x8000)
     {
-        bit_value = 0;
+        raw_temp = -(raw_temp & 0x7FFF);
     }
 
-    while (HAL_GPIO_ReadPin(dht22x->dataPort, dht22x->dataPin))
-        ;
+    /* The sensor already reports tenths, no scaling needed */
+    reading->humidity = raw_humi;
+    reading->temperature = raw_temp;
 
-    return bit_value;
+    return HAL_OK;
 }
 
-static uint8_t DHT22_ReadByte(DHT22_HandleTypeDef *dht22x)
+/* Record the outcome of a sensor read in the handle's cache */
+static void DHT22_UpdateCache(DHT22_HandleTypeDef *dht22x, HAL_StatusTypeDef status)
 {
-    uint8_t byte = 0;
-    for (uint8_t i = 0; i < 8; i++)
+    dht22x->lastStatus = status;
+    if (status == HAL_OK)
     {
-        byte <<= 1;
-        byte |= DHT22_ReadBit(dht22x);
+        dht22x->validTick = HAL_GetTick();
+        dht22x->valid = 1;
     }
-    return byte;
 }
 
-HAL_StatusTypeDef DHT22_Read_Data(DHT22_HandleTypeDef *dht22x, float *humidity, float *temperature)
+HAL_StatusTypeDef DHT22_Read_Raw(DHT22_HandleTypeDef *dht22x, DHT22_ReadingTypeDef *reading)
 {
     uint8_t data[5] = {0};
-    int16_t raw_humi, raw_temp;
     HAL_StatusTypeDef status;
 
+    /* Same spacing as the other read paths, whichever of them triggered last */
+    if (dht22x->state == DHT22_STATE_START || dht22x->state == DHT22_STATE_BUSY ||
+        HAL_GetTick() - dht22x->readTick < DHT22_MIN_INTERVAL_MS)
+    {
+        return HAL_BUSY;
+    }
+
+    dht22x->readTick = HAL_GetTick();
+    dht22x->ErrorCode = DHT22_ERROR_NONE;
+
     DHT22_Start(dht22x);
 
     status = DHT22_CheckResponse(dht22x);
-    if (status != HAL_OK)
+
+    /* Humidity high/low, temperature high/low, checksum */
+    for (uint8_t i = 0; i < 5 && status == HAL_OK; i++)
     {
-        return status;
+        status = DHT22_ReadByte(dht22x, &data[i]);
     }
 
-    data[0] = DHT22_ReadByte(dht22x); /* Humidity high byte */
-    data[1] = DHT22_ReadByte(dht22x); /* Humidity low byte */
-    data[2] = DHT22_ReadByte(dht22x); /* Temperature high byte */
-    data[3] = DHT22_ReadByte(dht22x); /* Temperature low byte */
-    data[4] = DHT22_ReadByte(dht22x); /* Checksum */
+    if (status == HAL_OK)
+    {
+        status = DHT22_Convert(data, reading);
+        if (status != HAL_OK)
+        {
+            dht22x->ErrorCode = DHT22_ERROR_CHECKSUM;
+        }
+    }
 
-    if (data[4] != (uint8_t)(data[0] + data[1] + data[2] + data[3]))
+    if (status == HAL_OK)
     {
-        return HAL_ERROR;
+        dht22x->reading = *reading;
     }
+    DHT22_UpdateCache(dht22x, status);
 
-    raw_humi = (data[0] << 8) | data[1];
-    raw_temp = (data[2] << 8) | data[3];
+    return status;
+}
 
-    if (raw_temp & 0x8000)
+HAL_StatusTypeDef DHT22_Read_Data(DHT22_HandleTypeDef *dht22x, float *humidity, float *temperature)
+{
+    PROFILER_SCOPE("DHT22_Read_Data");
+    DHT22_ReadingTypeDef reading;
+    HAL_StatusTypeDef status = DHT22_Read_Raw(dht22x, &reading);
+
+    if (status == HAL_OK)
     {
-        raw_temp = -(raw_temp & 0x7FFF);
+        *humidity = reading.humidity / 10.0f;
+        *temperature = reading.temperature / 10.0f;
+    }
+
+    return status;
+}
+
+HAL_StatusTypeDef DHT22_Get_Cached(DHT22_HandleTypeDef *dht22x, DHT22_ReadingTypeDef *reading, uint32_t *age_ms)
+{
+    if (!dht22x->valid)
+    {
+        return (dht22x->lastStatus == HAL_OK) ? HAL_ERROR : dht22x->lastStatus;
     }
 
-    *humidity = raw_humi / 10.0f;
-    *temperature = raw_temp / 10.0f;
+    *reading = dht22x->reading;
+    if (age_ms != NULL)
+    {
+        *age_ms = HAL_GetTick() - dht22x->validTick;
+    }
 
     return HAL_OK;
 }
 
+HAL_StatusTypeDef DHT22_Read_Cached(DHT22_HandleTypeDef *dht22x, DHT22_ReadingTypeDef *reading, uint32_t *age_ms)
+{
+    DHT22_ReadingTypeDef fresh;
+
+    /* Inside the cooldown the read returns HAL_BUSY without touching the line */
+    (void)DHT22_Read_Raw(dht22x, &fresh);
+
+    return DHT22_Get_Cached(dht22x, reading, age_ms);
+}
+
+uint8_t DHT22_FormatDeci(char *buf, int16_t value)
+{
+    char digits[5];
+    uint8_t len = 0, n = 0;
+    uint16_t magnitude = (value < 0) ? (uint16_t)(-value) : (uint16_t)value;
+
+    if (value < 0)
+    {
+        buf[len++] = '-';
+    }
+
+    /* Integer part digits in reverse, at least one */
+    uint16_t whole = magnitude / 10U;
+    do
+    {
+        digits[n++] = '0' + (whole % 10U);
+        whole /= 10U;
+    } while (whole != 0U);
+
+    while (n > 0)
+    {
+        buf[len++] = digits[--n];
+    }
+
+    buf[len++] = '.';
+    buf[len++] = '0' + (magnitude % 10U);
+    buf[len] = '\0';
+
+    return len;
+}
+
+uint32_t DHT22_GetError(DHT22_HandleTypeDef *dht22x)
+{
+    return dht22x->ErrorCode;
+}
+
 HAL_StatusTypeDef DHT22_Init(DHT22_HandleTypeDef *dht22x, TIM_HandleTypeDef *htim, GPIO_TypeDef *dataPort, uint16_t dataPin)
 {
-    if (dht22x == NULL || htim == NULL)
+    if (dht22x == NULL || htim == NULL || dataPort == NULL || dataPin == 0U)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Timebase_Init(htim) != HAL_OK)
     {
         return HAL_ERROR;
     }
@@ -151,5 +296,206 @@ HAL_StatusTypeDef DHT22_Init(DHT22_HandleTypeDef *dht22x, TIM_HandleTypeDef *hti
     dht22x->dataPort = dataPort;
     dht22x->dataPin = dataPin;
 
+    /* Precompute the pin direction switch: pins 0-7 live in CRL, 8-15 in CRH */
+    uint32_t position = POSITION_VAL(dataPin);
+    uint32_t shift = (position & 0x7U) * 4U;
+
+    dht22x->pinCR = (position < 8U) ? &dataPort->CRL : &dataPort->CRH;
+    dht22x->pinCRMask = 0xFU << shift;
+#if DHT22_USE_OPEN_DRAIN
+    /* The line is only ever pulled low or released, the direction never changes */
+    dht22x->pinCROutput = DHT22_CR_OUTPUT_OD << shift;
+    dht22x->pinCRInput = DHT22_CR_OUTPUT_OD << shift;
+#else
+    dht22x->pinCROutput = DHT22_CR_OUTPUT_PP << shift;
+    dht22x->pinCRInput = DHT22_CR_INPUT_PU << shift;
+#endif
+
+    DHT22_PIN_RELEASE(dht22x);
+    DHT22_PinInput(dht22x);
+
+    dht22x->htim_ic = NULL;
+    dht22x->state = DHT22_STATE_RESET;
+    dht22x->ErrorCode = DHT22_ERROR_NONE;
+
+    /* Empty cache, first read allowed right away */
+    dht22x->readTick = HAL_GetTick() - DHT22_MIN_INTERVAL_MS;
+    dht22x->lastStatus = HAL_OK;
+    dht22x->valid = 0;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef DHT22_ProcessCaptures(DHT22_HandleTypeDef *dht22x)
+{
+    PROFILER_SCOPE("DHT22_ProcessCaptures");
+    uint8_t data[5] = {0};
+    HAL_StatusTypeDef status;
+
+    if (dht22x->captureCount < DHT22_CAPTURE_EDGES)
+    {
+        /* The number of edges seen tells in which phase the frame stopped */
+        if (dht22x->captureCount == 0)
+        {
+            dht22x->ErrorCode = DHT22_ERROR_TIMEOUT_RESPONSE_LOW;
+        }
+        else if (dht22x->captureCount == 1)
+        {
+            dht22x->ErrorCode = DHT22_ERROR_TIMEOUT_RESPONSE_HIGH;
+        }
+        else
+        {
+            dht22x->ErrorCode = DHT22_ERROR_TIMEOUT_BIT_END;
+        }
+        DHT22_UpdateCache(dht22x, HAL_TIMEOUT);
+        return HAL_TIMEOUT;
+    }
+
+    switch (DHT22_Decode(dht22x->captures, dht22x->captureCount, data))
+    {
+    case DHT22_DECODE_OK:
+        status = DHT22_Convert(data, &dht22x->reading);
+        break;
+    case DHT22_DECODE_CHECKSUM:
+        dht22x->ErrorCode = DHT22_ERROR_CHECKSUM;
+        status = HAL_ERROR;
+        break;
+    default:
+        dht22x->ErrorCode = DHT22_ERROR_FRAME;
+        status = HAL_ERROR;
+        break;
+    }
+
+    DHT22_UpdateCache(dht22x, status);
+
+    return status;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                          DMA-driven acquisition                            */
+/* -------------------------------------------------------------------------- */
+
+/* DMA handle of a capture channel: TIM_DMA_ID_CCx is x, TIM_CHANNEL_x is 4 * (x - 1) */
+static DMA_HandleTypeDef *DHT22_CaptureDMA(TIM_HandleTypeDef *htim, uint32_t channel)
+{
+    return htim->hdma[TIM_DMA_ID_CC1 + (channel >> 2)];
+}
+
+static void DHT22_CompleteAsync(DHT22_HandleTypeDef *dht22x, HAL_StatusTypeDef status)
+{
+    DMA_HandleTypeDef *hdma = DHT22_CaptureDMA(dht22x->htim_ic, dht22x->icChannel);
+
+    /* Edges still pending in the DMA counter were never seen */
+    dht22x->captureCount = DHT22_CAPTURE_EDGES - __HAL_DMA_GET_COUNTER(hdma);
+
+    HAL_TIM_IC_Stop_DMA(dht22x->htim_ic, dht22x->icChannel);
+    HAL_TIM_Base_Stop_IT(dht22x->htim_ic);
+
+    if (status != HAL_ERROR)
+    {
+        status = DHT22_ProcessCaptures(dht22x);
+    }
+
+    dht22x->state = DHT22_STATE_READY;
+
+    if (dht22x->ReadCpltCallback != NULL)
+    {
+        dht22x->ReadCpltCallback(dht22x, status);
+    }
+}
+
+HAL_StatusTypeDef DHT22_Init_Async(DHT22_HandleTypeDef *dht22x, TIM_HandleTypeDef *htim_ic, uint32_t channel,
+                                   void (*callback)(DHT22_HandleTypeDef *dht22x, HAL_StatusTypeDef status))
+{
+    if (dht22x == NULL || htim_ic == NULL || DHT22_CaptureDMA(htim_ic, channel) == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    dht22x->htim_ic = htim_ic;
+    dht22x->icChannel = channel;
+    dht22x->ReadCpltCallback = callback;
+    dht22x->captureCount = 0;
+    dht22x->state = DHT22_STATE_READY;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef DHT22_StartAsync(DHT22_HandleTypeDef *dht22x)
+{
+    if (dht22x->state == DHT22_STATE_RESET)
+    {
+        return HAL_ERROR;
+    }
+    if (dht22x->state != DHT22_STATE_READY || HAL_GetTick() - dht22x->readTick < DHT22_MIN_INTERVAL_MS)
+    {
+        return HAL_BUSY;
+    }
+
+    dht22x->readTick = HAL_GetTick();
+    dht22x->state = DHT22_STATE_START;
+    dht22x->captureCount = 0;
+    dht22x->ErrorCode = DHT22_ERROR_NONE;
+
+    /* Pull the DATA pin down; the timer update event ends the start signal */
+    DHT22_PIN_LOW(dht22x);
+    DHT22_PinOutput(dht22x);
+
+    __HAL_TIM_SET_COUNTER(dht22x->htim_ic, __HAL_TIM_GET_AUTORELOAD(dht22x->htim_ic) - DHT22_START_LOW_US);
+    __HAL_TIM_CLEAR_FLAG(dht22x->htim_ic, TIM_FLAG_UPDATE);
+
+    if (HAL_TIM_Base_Start_IT(dht22x->htim_ic) != HAL_OK)
+    {
+        DHT22_PIN_RELEASE(dht22x);
+        DHT22_PinInput(dht22x);
+        dht22x->state = DHT22_STATE_READY;
+        return HAL_ERROR;
+    }
+
     return HAL_OK;
+}
+
+void DHT22_TIM_PeriodElapsedCallback(DHT22_HandleTypeDef *dht22x, TIM_HandleTypeDef *htim)
+{
+    if (htim != dht22x->htim_ic)
+    {
+        return;
+    }
+
+    if (dht22x->state == DHT22_STATE_START)
+    {
+        /* Release the line and let the sensor drive it */
+        DHT22_PIN_RELEASE(dht22x);
+        DHT22_PinInput(dht22x);
+
+        /* Next update event marks the end of the frame budget */
+        __HAL_TIM_SET_COUNTER(htim, __HAL_TIM_GET_AUTORELOAD(htim) - DHT22_FRAME_TIMEOUT_US);
+        dht22x->state = DHT22_STATE_BUSY;
+
+        if (HAL_TIM_IC_Start_DMA(htim, dht22x->icChannel, (uint32_t *)dht22x->captures,
+                                 DHT22_CAPTURE_EDGES) != HAL_OK)
+        {
+            DHT22_CompleteAsync(dht22x, HAL_ERROR);
+        }
+    }
+    else if (dht22x->state == DHT22_STATE_BUSY)
+    {
+        DHT22_CompleteAsync(dht22x, HAL_TIMEOUT);
+    }
+}
+
+void DHT22_TIM_IC_CaptureCallback(DHT22_HandleTypeDef *dht22x, TIM_HandleTypeDef *htim)
+{
+    if (htim != dht22x->htim_ic || dht22x->state != DHT22_STATE_BUSY)
+    {
+        return;
+    }
+
+    /* TIM_CHANNEL_x is 4 * (x - 1), HAL_TIM_ACTIVE_CHANNEL_x is 1 << (x - 1) */
+    if (htim->Channel != (HAL_TIM_ActiveChannel)(1U << (dht22x->icChannel >> 2)))
+    {
+        return;
+    }
+
+    DHT22_CompleteAsync(dht22x, HAL_OK);
 }
\ No newline at end of file
@@ -16,9 +16,31 @@
  *   DHT22_HandleTypeDef dht22;
  *   DHT22_Init(&dht22, &htim2, GPIOA, GPIO_PIN_0);
  *
- *   float temperature, humidity;
- *   if (DHT22_Read_Data(&dht22, &humidity, &temperature) == HAL_OK) {
- *       // Data read successfully
+ *   DHT22_ReadingTypeDef reading;
+ *   if (DHT22_Read_Raw(&dht22, &reading) == HAL_OK) {
+ *       char text[DHT22_FORMAT_SIZE];
+ *       DHT22_FormatDeci(text, reading.temperature); // e.g. "-12.3"
+ *   }
+ * @endcode
+ *
+ * Readings are fixed-point tenths, exactly as sent by the sensor, so the
+ * Cortex-M3 never needs soft-float. DHT22_Read_Data() still returns floats
+ * for existing callers; it is dropped by the linker when unused.
+ *
+ * Non-blocking acquisition uses a timer channel in input capture mode on the
+ * data pin with a DMA channel linked to it. The timer must tick at 1 MHz with
+ * a 0xFFFF period; every falling edge of the frame is written to the handle's
+ * capture buffer by DMA and the frame is decoded once, on transfer complete.
+ * The HAL timer callbacks must be forwarded to the driver:
+ * @code
+ *   DHT22_Init_Async(&dht22, &htim2, TIM_CHANNEL_1, DHT22_ReadCplt);
+ *   DHT22_StartAsync(&dht22);
+ *
+ *   void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim) {
+ *       DHT22_TIM_IC_CaptureCallback(&dht22, htim);
+ *   }
+ *   void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+ *       DHT22_TIM_PeriodElapsedCallback(&dht22, htim);
  *   }
  * @endcode
  *
@@ -29,19 +51,119 @@
 #define _DHT22_H_
 
 #include "stm32f1xx_hal.h"
+#include "DHT22_Decode.h"
+
+/* -------------------------------------------------------------------------- */
+/*                              DHT22 Constants                               */
+/* -------------------------------------------------------------------------- */
+
+/*
+ * Set to 1 to drive the data pin as open-drain output permanently instead of
+ * switching it between push-pull output and pull-up input. Requires an
+ * external pull-up resistor on DATA (fitted on most DHT22 modules).
+ */
+#ifndef DHT22_USE_OPEN_DRAIN
+#define DHT22_USE_OPEN_DRAIN 0
+#endif
+
+/* The sensor must not be triggered more often than this */
+#ifndef DHT22_MIN_INTERVAL_MS
+#define DHT22_MIN_INTERVAL_MS 2000U
+#endif
+
+/* Host start signal: hold DATA low for at least 1 ms */
+#define DHT22_START_LOW_US 1100U
+
+/*
+ * Budget for a whole frame after the start signal is released. An all-ones
+ * frame lasts ~5 ms, so a read never takes longer than
+ * DHT22_START_LOW_US + DHT22_FRAME_TIMEOUT_US (~6.3 ms).
+ */
+#ifndef DHT22_FRAME_TIMEOUT_US
+#define DHT22_FRAME_TIMEOUT_US 5200U
+#endif
+
+/* Per-phase wait budgets of the blocking reader, in microseconds */
+#ifndef DHT22_TIMEOUT_RESPONSE_LOW_US
+#define DHT22_TIMEOUT_RESPONSE_LOW_US 100U /* Sensor answer delay, then its 80us low pulse */
+#endif
+#ifndef DHT22_TIMEOUT_RESPONSE_HIGH_US
+#define DHT22_TIMEOUT_RESPONSE_HIGH_US 100U /* 80us high pulse before the first bit */
+#endif
+#ifndef DHT22_TIMEOUT_BIT_START_US
+#define DHT22_TIMEOUT_BIT_START_US 75U /* 50us low pulse starting every bit */
+#endif
+#ifndef DHT22_TIMEOUT_BIT_END_US
+#define DHT22_TIMEOUT_BIT_END_US 100U /* 26-28us ('0') or 70us ('1') high pulse */
+#endif
+
+/* High pulse length separating a '0' from a '1' */
+#define DHT22_BIT_HIGH_THRESHOLD_US 48U
+
+/* DHT22 error codes, see DHT22_GetError() */
+#define DHT22_ERROR_NONE                   0x00U /*!< No error */
+#define DHT22_ERROR_TIMEOUT_RESPONSE_LOW   0x01U /*!< No answer, or response low pulse too long */
+#define DHT22_ERROR_TIMEOUT_RESPONSE_HIGH  0x02U /*!< Response high pulse too long */
+#define DHT22_ERROR_TIMEOUT_BIT_START      0x04U /*!< Bit low pulse too long */
+#define DHT22_ERROR_TIMEOUT_BIT_END        0x08U /*!< Bit high pulse too long */
+#define DHT22_ERROR_CHECKSUM               0x10U /*!< Checksum mismatch */
+#define DHT22_ERROR_FRAME                  0x20U /*!< Captured pulse widths out of range */
+
+/* Buffer size for DHT22_FormatDeci(): "-3276.8" plus terminator */
+#define DHT22_FORMAT_SIZE 8U
 
 /* -------------------------------------------------------------------------- */
 /*                            DHT22 Handle Struct                             */
 /* -------------------------------------------------------------------------- */
 
 /**
- * @brief  DHT22 handle structure definition
+ * @brief  DHT22 reading in fixed-point deci-units
  */
 typedef struct
 {
-    TIM_HandleTypeDef *htim; /*!< Pointer to timer handler for microsecond delays */
+    int16_t humidity;    /*!< Relative humidity in 0.1 % */
+    int16_t temperature; /*!< Temperature in 0.1 degree Celsius */
+} DHT22_ReadingTypeDef;
+
+/**
+ * @brief  DHT22 asynchronous acquisition state
+ */
+typedef enum
+{
+    DHT22_STATE_RESET = 0x00U, /*!< Asynchronous mode not configured */
+    DHT22_STATE_READY = 0x01U, /*!< Idle, ready to start a frame */
+    DHT22_STATE_START = 0x02U, /*!< Host start signal in progress */
+    DHT22_STATE_BUSY = 0x03U   /*!< Capturing the sensor frame by DMA */
+} DHT22_StateTypeDef;
+
+/**
+ * @brief  DHT22 handle structure definition
+ */
+typedef struct __DHT22_HandleTypeDef
+{
+    TIM_HandleTypeDef *htim; /*!< Pointer to timer handler of the shared microsecond timebase */
     GPIO_TypeDef *dataPort;  /*!< Pointer to GPIO port for data pin */
     uint16_t dataPin;        /*!< GPIO pin for data communication */
+
+    volatile uint32_t *pinCR; /*!< CRL or CRH register holding the data pin configuration */
+    uint32_t pinCRMask;       /*!< CNF/MODE bits of the data pin in pinCR */
+    uint32_t pinCROutput;     /*!< pinCR value driving the line */
+    uint32_t pinCRInput;      /*!< pinCR value releasing the line to the sensor */
+    uint16_t frameStart;      /*!< Timebase timestamp of the start signal release */
+
+    TIM_HandleTypeDef *htim_ic;                 /*!< Timer in input capture mode on the data pin */
+    uint32_t icChannel;                         /*!< Capture channel (TIM_CHANNEL_x) */
+    uint16_t captures[DHT22_CAPTURE_EDGES];     /*!< DMA target for the frame's falling edges */
+    uint8_t captureCount;                       /*!< Number of edges captured in the last frame */
+    volatile DHT22_StateTypeDef state;          /*!< Asynchronous acquisition state */
+    uint32_t ErrorCode;                         /*!< DHT22_ERROR_x of the last read */
+    DHT22_ReadingTypeDef reading;               /*!< Last good reading (cache) */
+    uint32_t validTick;                         /*!< HAL tick of the last good reading */
+    uint32_t readTick;                          /*!< HAL tick of the last sensor trigger */
+    HAL_StatusTypeDef lastStatus;               /*!< Status of the last sensor read */
+    uint8_t valid;                              /*!< Non-zero once reading holds a good value */
+    void (*ReadCpltCallback)(struct __DHT22_HandleTypeDef *dht22x,
+                             HAL_StatusTypeDef status); /*!< Asynchronous read complete callback */
 } DHT22_HandleTypeDef;
 
 /* -------------------------------------------------------------------------- */
@@ -49,23 +171,130 @@ typedef struct
 /* -------------------------------------------------------------------------- */
 
 /**
- * @brief  Initialize the DHT22 sensor.
+ * @brief  Initialize the DHT22 sensor and precompute the data pin direction
+ *         switch, so reads never go through HAL_GPIO_Init().
  * @param  dht22x: Pointer to DHT22 handle structure.
- * @param  htim: Pointer to timer handler for precise timing.
+ * @param  htim: Pointer to timer handler for precise timing. It is started as
+ *               the shared free-running timebase (see Timebase.h).
  * @param  dataPort: Pointer to GPIO port for data pin.
- * @param  dataPin: GPIO pin number for data communication.
+ * @param  dataPin: GPIO pin number for data communication (a single GPIO_PIN_x).
  * @retval HAL status
  */
 HAL_StatusTypeDef DHT22_Init(DHT22_HandleTypeDef *dht22x, TIM_HandleTypeDef *htim,
                              GPIO_TypeDef *dataPort, uint16_t dataPin);
 
 /**
- * @brief  Read temperature and humidity data from DHT22 sensor.
+ * @brief  Read temperature and humidity from DHT22 sensor in fixed point.
+ * @param  dht22x: Pointer to DHT22 handle structure.
+ * @param  reading: Pointer to store humidity and temperature in tenths.
+ * @retval HAL status (HAL_OK if successful, HAL_TIMEOUT if a phase exceeded its
+ *         budget, HAL_ERROR if checksum fails). DHT22_GetError() tells which.
+ *         HAL_BUSY without triggering the sensor within DHT22_MIN_INTERVAL_MS
+ *         of the last trigger, by any read path, or while an asynchronous
+ *         read runs.
+ * @note   Blocks for at most DHT22_START_LOW_US + DHT22_FRAME_TIMEOUT_US.
+ *         The outcome goes to the cache read by DHT22_Get_Cached().
+ */
+HAL_StatusTypeDef DHT22_Read_Raw(DHT22_HandleTypeDef *dht22x, DHT22_ReadingTypeDef *reading);
+
+/**
+ * @brief  Read temperature and humidity data from DHT22 sensor as floats.
+ *         Wrapper over DHT22_Read_Raw() that pulls in soft-float division.
  * @param  dht22x: Pointer to DHT22 handle structure.
  * @param  humidity: Pointer to store humidity value (percentage).
  * @param  temperature: Pointer to store temperature value (Celsius).
- * @retval HAL status (HAL_OK if successful, HAL_ERROR if checksum fails or no response)
+ * @retval HAL status, see DHT22_Read_Raw()
  */
 HAL_StatusTypeDef DHT22_Read_Data(DHT22_HandleTypeDef *dht22x, float *humidity, float *temperature);
 
+/**
+ * @brief  Return the cached reading, triggering a blocking read only when the
+ *         minimum interval (DHT22_MIN_INTERVAL_MS) has elapsed since the last
+ *         one. Inside the cooldown this returns instantly.
+ * @param  dht22x: Pointer to DHT22 handle structure.
+ * @param  reading: Pointer to store the last good reading.
+ * @param  age_ms: Pointer to store the age of that reading, may be NULL.
+ * @retval HAL_OK if a reading is available (check age_ms for staleness),
+ *         otherwise the status of the last read attempt.
+ */
+HAL_StatusTypeDef DHT22_Read_Cached(DHT22_HandleTypeDef *dht22x, DHT22_ReadingTypeDef *reading, uint32_t *age_ms);
+
+/**
+ * @brief  Return the cached reading without ever touching the sensor. Any
+ *         number of consumers may call it at any rate.
+ * @param  dht22x: Pointer to DHT22 handle structure.
+ * @param  reading: Pointer to store the last good reading.
+ * @param  age_ms: Pointer to store the age of that reading, may be NULL.
+ * @retval HAL_OK if a reading is available, otherwise the status of the
+ *         last read attempt.
+ */
+HAL_StatusTypeDef DHT22_Get_Cached(DHT22_HandleTypeDef *dht22x, DHT22_ReadingTypeDef *reading, uint32_t *age_ms);
+
+/**
+ * @brief  Format a deci-unit value as a decimal string without floats.
+ * @param  buf: Output buffer of at least DHT22_FORMAT_SIZE bytes.
+ * @param  value: Value in tenths (e.g. 273 -> "27.3", -5 -> "-0.5").
+ * @retval Number of characters written, excluding the terminator
+ */
+uint8_t DHT22_FormatDeci(char *buf, int16_t value);
+
+/**
+ * @brief  Return the error code of the last read.
+ * @param  dht22x: Pointer to DHT22 handle structure.
+ * @retval DHT22_ERROR_x code
+ */
+uint32_t DHT22_GetError(DHT22_HandleTypeDef *dht22x);
+
+/**
+ * @brief  Decode the frame held in the capture buffer of the handle and store
+ *         the result in its reading field. Used by the DMA
+ *         reader and by DHT22_Group after the edges have been captured.
+ * @param  dht22x: Pointer to DHT22 handle structure with captures and
+ *                 captureCount filled in.
+ * @retval HAL status (HAL_TIMEOUT if the frame is incomplete, HAL_ERROR on a
+ *         malformed frame), the reason is available from DHT22_GetError().
+ */
+HAL_StatusTypeDef DHT22_ProcessCaptures(DHT22_HandleTypeDef *dht22x);
+
+/**
+ * @brief  Configure the DHT22 for DMA-driven acquisition.
+ * @param  dht22x: Pointer to DHT22 handle structure.
+ * @param  htim_ic: Timer whose capture channel is wired to the data pin
+ *                  (1 MHz tick, falling edge polarity, 0xFFFF period) and
+ *                  linked to a half-word, normal mode DMA channel.
+ * @param  channel: Capture channel (TIM_CHANNEL_1 ... TIM_CHANNEL_4).
+ * @param  callback: Called from interrupt context when a frame completes.
+ * @retval HAL status
+ */
+HAL_StatusTypeDef DHT22_Init_Async(DHT22_HandleTypeDef *dht22x, TIM_HandleTypeDef *htim_ic, uint32_t channel,
+                                   void (*callback)(DHT22_HandleTypeDef *dht22x, HAL_StatusTypeDef status));
+
+/**
+ * @brief  Start a non-blocking read. The CPU is free while the frame is
+ *         captured; the result is reported through the completion callback
+ *         and stored in the reading field of the handle.
+ * @param  dht22x: Pointer to DHT22 handle structure.
+ * @retval HAL status (HAL_BUSY if a read is already in progress or the last
+ *         one started less than DHT22_MIN_INTERVAL_MS ago)
+ */
+HAL_StatusTypeDef DHT22_StartAsync(DHT22_HandleTypeDef *dht22x);
+
+/**
+ * @brief  Capture complete handler, call from HAL_TIM_IC_CaptureCallback().
+ *         Runs once per frame, when the DMA transfer completes.
+ * @param  dht22x: Pointer to DHT22 handle structure.
+ * @param  htim: Timer handle passed to the HAL callback.
+ * @retval None
+ */
+void DHT22_TIM_IC_CaptureCallback(DHT22_HandleTypeDef *dht22x, TIM_HandleTypeDef *htim);
+
+/**
+ * @brief  Timer update handler, call from HAL_TIM_PeriodElapsedCallback().
+ *         Ends the start signal and detects frame timeouts.
+ * @param  dht22x: Pointer to DHT22 handle structure.
+ * @param  htim: Timer handle passed to the HAL callback.
+ * @retval None
+ */
+void DHT22_TIM_PeriodElapsedCallback(DHT22_HandleTypeDef *dht22x, TIM_HandleTypeDef *htim);
+
 #endif /* _DHT22_H_ */
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "DHT22_Decode.h"
+
+DHT22_DecodeResultTypeDef DHT22_Decode(const uint16_t *captures, uint8_t count, uint8_t data[5])
+{
+    uint16_t period;
+
+    if (count < DHT22_CAPTURE_EDGES)
+    {
+        return DHT22_DECODE_SHORT;
+    }
+
+    /* Response: 80us low + 80us high before the first bit starts */
+    period = (uint16_t)(captures[1] - captures[0]);
+    if (period < DHT22_RESPONSE_MIN_US || period > DHT22_RESPONSE_MAX_US)
+    {
+        return DHT22_DECODE_RESPONSE;
+    }
+
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        data[i] = 0;
+    }
+
+    for (uint8_t i = 0; i < 40; i++)
+    {
+        /* Each bit is 50us low followed by 26-28us ('0') or 70us ('1') high */
+        period = (uint16_t)(captures[i + 2] - captures[i + 1]);
+        if (period < DHT22_BIT_MIN_US || period > DHT22_BIT_MAX_US)
+        {
+            return DHT22_DECODE_BIT;
+        }
+
+        data[i / 8] <<= 1;
+        data[i / 8] |= (period > DHT22_BIT_THRESHOLD_US) ? 1 : 0;
+    }
+
+    if (data[4] != (uint8_t)(data[0] + data[1] + data[2] + data[3]))
+    {
+        return DHT22_DECODE_CHECKSUM;
+    }
+
+    return DHT22_DECODE_OK;
+}
@@ -0,0 +1,77 @@
+/**
+ ******************************************************************************
+ * @file           : DHT22_Decode.h
+ * @brief          : Header file for the DHT22 frame decoder.
+ *                   Turns the captured edge timestamps of one DHT22 frame
+ *                   into the 5 data bytes sent by the sensor.
+ ******************************************************************************
+ * @attention
+ *
+ * The decoder is a pure function over a timestamp array and depends only on
+ * <stdint.h>, so it can be compiled and exercised on a host machine with
+ * synthetic captures.
+ *
+ * Example usage:
+ * @code
+ *   uint16_t captures[DHT22_CAPTURE_EDGES];   // 1 us falling-edge timestamps
+ *   uint8_t data[5];
+ *   if (DHT22_Decode(captures, DHT22_CAPTURE_EDGES, data) == DHT22_DECODE_OK) {
+ *       // data[0..1] humidity, data[2..3] temperature, data[4] checksum
+ *   }
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _DHT22_DECODE_H_
+#define _DHT22_DECODE_H_
+
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+/*                           DHT22 Frame Constants                            */
+/* -------------------------------------------------------------------------- */
+
+/* Falling edges in one frame: response, 40 bit starts, end of transmission */
+#define DHT22_CAPTURE_EDGES 42U
+
+/* Falling-to-falling period of a bit: ~76 us for '0', ~120 us for '1' */
+#define DHT22_BIT_THRESHOLD_US 100U
+
+/* Accepted falling-to-falling periods in microseconds */
+#define DHT22_RESPONSE_MIN_US 120U
+#define DHT22_RESPONSE_MAX_US 200U
+#define DHT22_BIT_MIN_US 60U
+#define DHT22_BIT_MAX_US 160U
+
+/* -------------------------------------------------------------------------- */
+/*                              Decoder Result                                */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  DHT22 decoder result
+ */
+typedef enum
+{
+    DHT22_DECODE_OK = 0x00U,       /*!< Frame decoded and checksum valid */
+    DHT22_DECODE_SHORT = 0x01U,    /*!< Fewer edges than a complete frame */
+    DHT22_DECODE_RESPONSE = 0x02U, /*!< Response pulse out of range */
+    DHT22_DECODE_BIT = 0x03U,      /*!< Bit period out of range */
+    DHT22_DECODE_CHECKSUM = 0x04U  /*!< Checksum mismatch */
+} DHT22_DecodeResultTypeDef;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Decode a DHT22 frame from its falling-edge timestamps.
+ * @param  captures: Free-running 1 MHz timestamps of the frame's falling
+ *                   edges (16-bit wrap-around is handled).
+ * @param  count: Number of valid entries in captures.
+ * @param  data: Output buffer for the 5 frame bytes.
+ * @retval Decoder result
+ */
+DHT22_DecodeResultTypeDef DHT22_Decode(const uint16_t *captures, uint8_t count, uint8_t data[5]);
+
+#endif /* _DHT22_DECODE_H_ */
@@ -0,0 +1,144 @@
+#include "DHT22_Group.h"
+#include "Timebase.h"
+
+HAL_StatusTypeDef DHT22_Group_Init(DHT22_GroupTypeDef *group, GPIO_TypeDef *dataPort)
+{
+    if (group == NULL || dataPort == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    group->dataPort = dataPort;
+    group->pinMask = 0;
+    group->count = 0;
+    group->crlMask = group->crlOutput = group->crlInput = 0;
+    group->crhMask = group->crhOutput = group->crhInput = 0;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef DHT22_Group_Add(DHT22_GroupTypeDef *group, DHT22_HandleTypeDef *dht22x)
+{
+    if (group->count >= DHT22_GROUP_MAX_SENSORS || dht22x->dataPort != group->dataPort ||
+        (group->pinMask & dht22x->dataPin) != 0U)
+    {
+        return HAL_ERROR;
+    }
+
+    group->pinSlot[POSITION_VAL(dht22x->dataPin)] = group->count;
+    group->sensors[group->count++] = dht22x;
+    group->pinMask |= dht22x->dataPin;
+
+    /* Merge the sensor's precomputed direction switch into the port-wide one */
+    if (dht22x->pinCR == &group->dataPort->CRL)
+    {
+        group->crlMask |= dht22x->pinCRMask;
+        group->crlOutput |= dht22x->pinCROutput;
+        group->crlInput |= dht22x->pinCRInput;
+    }
+    else
+    {
+        group->crhMask |= dht22x->pinCRMask;
+        group->crhOutput |= dht22x->pinCROutput;
+        group->crhInput |= dht22x->pinCRInput;
+    }
+
+    return HAL_OK;
+}
+
+static void DHT22_Group_PinsOutput(DHT22_GroupTypeDef *group)
+{
+    MODIFY_REG(group->dataPort->CRL, group->crlMask, group->crlOutput);
+    MODIFY_REG(group->dataPort->CRH, group->crhMask, group->crhOutput);
+}
+
+static void DHT22_Group_PinsInput(DHT22_GroupTypeDef *group)
+{
+    MODIFY_REG(group->dataPort->CRL, group->crlMask, group->crlInput);
+    MODIFY_REG(group->dataPort->CRH, group->crhMask, group->crhInput);
+}
+
+HAL_StatusTypeDef DHT22_Group_Read(DHT22_GroupTypeDef *group)
+{
+    GPIO_TypeDef *port = group->dataPort;
+    uint16_t pending = group->pinMask;
+    uint16_t previous, level, falling, frame_start, now;
+    HAL_StatusTypeDef result = HAL_OK;
+
+    if (group->count == 0)
+    {
+        return HAL_ERROR;
+    }
+
+    /* Every sensor must be out of its cooldown before the group is triggered */
+    for (uint8_t i = 0; i < group->count; i++)
+    {
+        if (HAL_GetTick() - group->sensors[i]->readTick < DHT22_MIN_INTERVAL_MS)
+        {
+            return HAL_BUSY;
+        }
+    }
+
+    for (uint8_t i = 0; i < group->count; i++)
+    {
+        group->sensors[i]->readTick = HAL_GetTick();
+        group->sensors[i]->captureCount = 0;
+        group->sensors[i]->ErrorCode = DHT22_ERROR_NONE;
+    }
+
+    /* Start signal on every pin at once */
+    port->BRR = group->pinMask;
+    DHT22_Group_PinsOutput(group);
+    Timebase_Delay_us(DHT22_START_LOW_US);
+
+    /* Bit periods of ~76 us ('0') and ~120 us ('1') sit ~20 us either side of
+     * the decoder threshold and this loop is the only timestamp source: keep
+     * handlers out of it from the release on. The start pulse may stretch. */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    port->BSRR = group->pinMask;
+    DHT22_Group_PinsInput(group);
+
+    frame_start = Timebase_Now_us();
+    previous = group->pinMask;
+
+    /* Timestamp every falling edge until all frames are complete */
+    while (pending != 0U)
+    {
+        level = port->IDR & group->pinMask;
+        now = Timebase_Now_us();
+        falling = previous & ~level & pending;
+        previous = level;
+
+        while (falling != 0U)
+        {
+            uint16_t pin = falling & (uint16_t)(-falling);
+            DHT22_HandleTypeDef *dht22x = group->sensors[group->pinSlot[POSITION_VAL(pin)]];
+
+            dht22x->captures[dht22x->captureCount++] = now;
+            if (dht22x->captureCount >= DHT22_CAPTURE_EDGES)
+            {
+                pending &= ~pin;
+            }
+            falling &= ~pin;
+        }
+
+        if ((uint16_t)(now - frame_start) > DHT22_FRAME_TIMEOUT_US)
+        {
+            break;
+        }
+    }
+
+    __set_PRIMASK(primask);
+
+    for (uint8_t i = 0; i < group->count; i++)
+    {
+        group->status[i] = DHT22_ProcessCaptures(group->sensors[i]);
+        if (group->status[i] != HAL_OK)
+        {
+            result = HAL_ERROR;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,102 @@
+/**
+ ******************************************************************************
+ * @file           : DHT22_Group.h
+ * @brief          : Header file for reading several DHT22 sensors at once.
+ *                   Starts all sensors of a group together and decodes their
+ *                   frames in parallel from one GPIO port sampling stream.
+ ******************************************************************************
+ * @attention
+ *
+ * All sensors of a group must have their data pins on the same GPIO port and
+ * be initialized with DHT22_Init() first. A group read costs about as much
+ * as a single blocking read (~6 ms), whatever the number of sensors: the
+ * start signal is driven on every pin with one BRR/BSRR write, then the
+ * port's IDR is sampled in a tight loop and each falling edge is timestamped
+ * into the capture buffer of the matching handle. Frames are decoded with the
+ * same decoder as the DMA reader once every sensor is done or the frame
+ * budget is spent.
+ *
+ * Interrupts are masked from the release of the start signal until the
+ * frames are in (at most DHT22_FRAME_TIMEOUT_US). The decoder tells bits
+ * apart with ~20 us of margin, which one long handler at a higher priority
+ * would eat. Handlers pending meanwhile run right after; the HAL tick keeps
+ * a single pending SysTick, so it may fall up to ~5 ms behind per group
+ * read.
+ *
+ * Example usage:
+ * @code
+ *   DHT22_GroupTypeDef group;
+ *   DHT22_Group_Init(&group, GPIOA);
+ *   DHT22_Group_Add(&group, &dht22_1);
+ *   DHT22_Group_Add(&group, &dht22_2);
+ *
+ *   if (DHT22_Group_Read(&group) == HAL_OK) {
+ *       // dht22_1.reading.humidity, dht22_2.reading.temperature, ...
+ *   }
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _DHT22_GROUP_H_
+#define _DHT22_GROUP_H_
+
+#include "DHT22.h"
+
+/* -------------------------------------------------------------------------- */
+/*                           DHT22 Group Constants                            */
+/* -------------------------------------------------------------------------- */
+
+/* Maximum number of sensors in one group */
+#define DHT22_GROUP_MAX_SENSORS 8U
+
+/* -------------------------------------------------------------------------- */
+/*                             DHT22 Group Struct                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  DHT22 group structure definition
+ */
+typedef struct
+{
+    GPIO_TypeDef *dataPort;                              /*!< Port shared by all data pins */
+    uint16_t pinMask;                                    /*!< Data pins of all sensors */
+    uint8_t count;                                       /*!< Number of sensors in the group */
+    DHT22_HandleTypeDef *sensors[DHT22_GROUP_MAX_SENSORS]; /*!< Sensor handles */
+    HAL_StatusTypeDef status[DHT22_GROUP_MAX_SENSORS];   /*!< Result of the last read, per sensor */
+    uint8_t pinSlot[16];                                 /*!< Sensor index of each port pin */
+    uint32_t crlMask, crlOutput, crlInput;               /*!< Combined CRL direction switch */
+    uint32_t crhMask, crhOutput, crhInput;               /*!< Combined CRH direction switch */
+} DHT22_GroupTypeDef;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Initialize an empty sensor group.
+ * @param  group: Pointer to DHT22 group structure.
+ * @param  dataPort: GPIO port carrying the data pins of every sensor.
+ * @retval HAL status
+ */
+HAL_StatusTypeDef DHT22_Group_Init(DHT22_GroupTypeDef *group, GPIO_TypeDef *dataPort);
+
+/**
+ * @brief  Add an initialized sensor to the group.
+ * @param  group: Pointer to DHT22 group structure.
+ * @param  dht22x: Pointer to a DHT22 handle set up with DHT22_Init().
+ * @retval HAL status (HAL_ERROR if the group is full, the pin is on another
+ *         port or already used)
+ */
+HAL_StatusTypeDef DHT22_Group_Add(DHT22_GroupTypeDef *group, DHT22_HandleTypeDef *dht22x);
+
+/**
+ * @brief  Read every sensor of the group concurrently (blocking).
+ * @param  group: Pointer to DHT22 group structure.
+ * @retval HAL_OK if every sensor was read, HAL_BUSY if a sensor is still in
+ *         its DHT22_MIN_INTERVAL_MS cooldown, HAL_ERROR otherwise. Per-sensor
+ *         results are in group->status[] and DHT22_GetError().
+ */
+HAL_StatusTypeDef DHT22_Group_Read(DHT22_GroupTypeDef *group);
+
+#endif /* _DHT22_GROUP_H_ */
@@ -0,0 +1,252 @@
+#include "DHT22_History.h"
+#include <stddef.h>
+
+#define DHT22_HISTORY_MASK (DHT22_HISTORY_CAPACITY - 1U)
+
+#if (DHT22_HISTORY_CAPACITY & DHT22_HISTORY_MASK) != 0U || DHT22_HISTORY_CAPACITY > 32768U
+#error "DHT22_HISTORY_CAPACITY must be a power of two up to 32768"
+#endif
+
+#if DHT22_HISTORY_WINDOW_MAX > DHT22_HISTORY_CAPACITY
+#error "DHT22_HISTORY_WINDOW_MAX must not exceed DHT22_HISTORY_CAPACITY"
+#endif
+
+/* Value of a sample number still in the buffer; the low 16 bits are enough */
+static inline int16_t DHT22_History_Value(const DHT22_HistoryTypeDef *hist, uint16_t seq, uint8_t channel)
+{
+    return hist->samples[seq & DHT22_HISTORY_MASK][channel];
+}
+
+static inline uint16_t DHT22_History_Slot(uint16_t first, uint16_t offset)
+{
+    uint16_t slot = first + offset;
+    return (slot >= DHT22_HISTORY_WINDOW_MAX) ? (uint16_t)(slot - DHT22_HISTORY_WINDOW_MAX) : slot;
+}
+
+static inline uint16_t DHT22_History_Front(const DHT22_History_DequeTypeDef *q)
+{
+    return q->seq[q->first];
+}
+
+/*
+ * Append sample seq, first dropping the entries it dominates from the back:
+ * a later sample that is at least as small (min) or as large (max) outlives
+ * them in every window, they can never be the answer again.
+ */
+static void DHT22_History_DequePush(const DHT22_HistoryTypeDef *hist, DHT22_History_DequeTypeDef *q, uint16_t seq,
+                                    uint8_t channel, uint8_t is_max)
+{
+    int16_t value = DHT22_History_Value(hist, seq, channel);
+
+    while (q->count > 0U)
+    {
+        int16_t back = DHT22_History_Value(hist, q->seq[DHT22_History_Slot(q->first, q->count - 1U)], channel);
+        if (is_max ? (back > value) : (back < value))
+        {
+            break;
+        }
+        q->count--;
+    }
+
+    q->seq[DHT22_History_Slot(q->first, q->count)] = seq;
+    q->count++;
+}
+
+/* Drop the front entry once it has left a window of the given length */
+static void DHT22_History_DequeExpire(DHT22_History_DequeTypeDef *q, uint16_t newest, uint16_t length)
+{
+    if (q->count > 0U && (uint16_t)(newest - DHT22_History_Front(q)) >= length)
+    {
+        q->first = DHT22_History_Slot(q->first, 1U);
+        q->count--;
+    }
+}
+
+static void DHT22_History_Finish(DHT22_History_StatsTypeDef *stats, uint16_t count, int32_t sum, uint64_t sum_sq)
+{
+    stats->count = count;
+    if (count == 0U)
+    {
+        stats->min = 0;
+        stats->max = 0;
+        stats->mean = 0;
+        stats->variance = 0;
+        return;
+    }
+
+    int32_t half = (int32_t)(count / 2U);
+    stats->mean = (int16_t)((sum >= 0) ? (sum + half) / (int32_t)count : (sum - half) / (int32_t)count);
+
+    if (count < 2U)
+    {
+        stats->variance = 0;
+        return;
+    }
+
+    // (n * sum(x^2) - sum(x)^2) / (n * (n - 1)), exact in 64 bits
+    int64_t num = (int64_t)count * (int64_t)sum_sq - (int64_t)sum * sum;
+    stats->variance = (uint32_t)(num / ((int64_t)count * (count - 1U)));
+}
+
+void DHT22_History_Init(DHT22_HistoryTypeDef *hist)
+{
+    hist->total = 0;
+    for (uint8_t w = 0; w < DHT22_HISTORY_WINDOWS; w++)
+    {
+        hist->windows[w].length = 0;
+    }
+}
+
+int8_t DHT22_History_AddWindow(DHT22_HistoryTypeDef *hist, uint16_t length)
+{
+    if (length == 0U || length > DHT22_HISTORY_WINDOW_MAX)
+    {
+        return -1;
+    }
+
+    for (uint8_t w = 0; w < DHT22_HISTORY_WINDOWS; w++)
+    {
+        DHT22_History_WindowTypeDef *win = &hist->windows[w];
+        if (win->length != 0U)
+        {
+            continue;
+        }
+
+        for (uint8_t ch = 0; ch < DHT22_HISTORY_CHANNELS; ch++)
+        {
+            win->sum[ch] = 0;
+            win->sumSq[ch] = 0;
+            win->minq[ch].first = 0;
+            win->minq[ch].count = 0;
+            win->maxq[ch].first = 0;
+            win->maxq[ch].count = 0;
+        }
+        win->length = length;
+        return (int8_t)w;
+    }
+    return -1;
+}
+
+void DHT22_History_Push(DHT22_HistoryTypeDef *hist, int16_t humidity, int16_t temperature)
+{
+    uint32_t total = hist->total;
+    uint16_t seq = (uint16_t)total;
+    int16_t *slot = hist->samples[total & DHT22_HISTORY_MASK];
+
+    // Retire the samples leaving each window while they are still stored:
+    // with a window as long as the buffer, the slot about to be overwritten
+    // holds exactly that sample
+    for (uint8_t w = 0; w < DHT22_HISTORY_WINDOWS; w++)
+    {
+        DHT22_History_WindowTypeDef *win = &hist->windows[w];
+        if (win->length == 0U || total < win->length)
+        {
+            continue;
+        }
+        for (uint8_t ch = 0; ch < DHT22_HISTORY_CHANNELS; ch++)
+        {
+            int32_t old = DHT22_History_Value(hist, (uint16_t)(seq - win->length), ch);
+            win->sum[ch] -= old;
+            win->sumSq[ch] -= (uint64_t)(old * old);
+        }
+    }
+
+    slot[DHT22_HISTORY_HUMIDITY] = humidity;
+    slot[DHT22_HISTORY_TEMPERATURE] = temperature;
+    hist->total = total + 1U;
+
+    for (uint8_t w = 0; w < DHT22_HISTORY_WINDOWS; w++)
+    {
+        DHT22_History_WindowTypeDef *win = &hist->windows[w];
+        if (win->length == 0U)
+        {
+            continue;
+        }
+        for (uint8_t ch = 0; ch < DHT22_HISTORY_CHANNELS; ch++)
+        {
+            int32_t value = slot[ch];
+            win->sum[ch] += value;
+            win->sumSq[ch] += (uint64_t)(value * value);
+
+            // One sample enters and at most one leaves: expiring the front
+            // once keeps each deque within the window
+            DHT22_History_DequeExpire(&win->minq[ch], seq, win->length);
+            DHT22_History_DequeExpire(&win->maxq[ch], seq, win->length);
+            DHT22_History_DequePush(hist, &win->minq[ch], seq, ch, 0U);
+            DHT22_History_DequePush(hist, &win->maxq[ch], seq, ch, 1U);
+        }
+    }
+}
+
+uint16_t DHT22_History_Count(const DHT22_HistoryTypeDef *hist)
+{
+    return (hist->total < DHT22_HISTORY_CAPACITY) ? (uint16_t)hist->total : (uint16_t)DHT22_HISTORY_CAPACITY;
+}
+
+uint8_t DHT22_History_Get(const DHT22_HistoryTypeDef *hist, uint16_t age, uint8_t channel, int16_t *value)
+{
+    if (age >= DHT22_History_Count(hist) || channel >= DHT22_HISTORY_CHANNELS)
+    {
+        return 0;
+    }
+
+    *value = DHT22_History_Value(hist, (uint16_t)(hist->total - 1U - age), channel);
+    return 1;
+}
+
+uint16_t DHT22_History_GetStats(const DHT22_HistoryTypeDef *hist, int8_t window, uint8_t channel,
+                                DHT22_History_StatsTypeDef *stats)
+{
+    if (window < 0 || window >= (int8_t)DHT22_HISTORY_WINDOWS || hist->windows[window].length == 0U ||
+        channel >= DHT22_HISTORY_CHANNELS)
+    {
+        DHT22_History_Finish(stats, 0, 0, 0);
+        return 0;
+    }
+
+    const DHT22_History_WindowTypeDef *win = &hist->windows[window];
+    uint16_t count = (hist->total < win->length) ? (uint16_t)hist->total : win->length;
+
+    DHT22_History_Finish(stats, count, win->sum[channel], win->sumSq[channel]);
+    if (count > 0U)
+    {
+        stats->min = DHT22_History_Value(hist, DHT22_History_Front(&win->minq[channel]), channel);
+        stats->max = DHT22_History_Value(hist, DHT22_History_Front(&win->maxq[channel]), channel);
+    }
+    return count;
+}
+
+uint16_t DHT22_History_Compute(const DHT22_HistoryTypeDef *hist, uint16_t span, uint8_t channel,
+                               DHT22_History_StatsTypeDef *stats)
+{
+    uint16_t count = DHT22_History_Count(hist);
+    if (span < count)
+    {
+        count = span;
+    }
+    if (channel >= DHT22_HISTORY_CHANNELS)
+    {
+        count = 0;
+    }
+
+    int32_t sum = 0;
+    uint64_t sum_sq = 0;
+    int16_t min = INT16_MAX;
+    int16_t max = INT16_MIN;
+    for (uint16_t age = 0; age < count; age++)
+    {
+        int32_t value = DHT22_History_Value(hist, (uint16_t)(hist->total - 1U - age), channel);
+        sum += value;
+        sum_sq += (uint64_t)(value * value);
+        min = (value < min) ? (int16_t)value : min;
+        max = (value > max) ? (int16_t)value : max;
+    }
+
+    DHT22_History_Finish(stats, count, sum, sum_sq);
+    if (count > 0U)
+    {
+        stats->min = min;
+        stats->max = max;
+    }
+    return count;
+}
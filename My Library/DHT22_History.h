@@ -0,0 +1,191 @@
+/**
+ ******************************************************************************
+ * @file           : DHT22_History.h
+ * @brief          : Header file for the DHT22 sample history.
+ *                   Keeps the latest readings in a fixed ring buffer and
+ *                   maintains min/max/mean/variance over sliding windows.
+ ******************************************************************************
+ * @attention
+ *
+ * Samples are stored as packed int16_t humidity/temperature pairs in the
+ * driver's deci-units, 4 bytes each. The capacity is fixed at compile time;
+ * the default of 512 samples covers about 17 minutes at the 2 s sampling
+ * interval in 2 KB. A full day at 2 s (43200 samples, ~170 KB) does not fit
+ * in the 20 KB of RAM of the STM32F103C8: longer trends need decimated
+ * samples or flash storage.
+ *
+ * Each window follows the newest N samples. Its statistics are updated in
+ * O(1) amortized time per sample: running sum and sum of squares for mean and
+ * variance, and a monotonic deque of sample numbers per channel for the
+ * minimum and the maximum, so a query never rescans the buffer. A deque never
+ * holds more entries than its window length, at most DHT22_HISTORY_WINDOW_MAX.
+ *
+ * DHT22_History_Compute() rescans the newest samples instead and is the
+ * batch reference for the incremental values. Like the CMSIS-DSP
+ * arm_mean_q15/arm_var_q15 kernels it returns the sample variance (N - 1
+ * denominator), but keeps integer deci-units instead of q15 fractions.
+ *
+ * The module depends only on <stdint.h> and can be exercised on a host.
+ * Push from one context only (e.g. the main loop).
+ *
+ * Example usage:
+ * @code
+ *   DHT22_HistoryTypeDef history;
+ *   DHT22_History_Init(&history);
+ *   int8_t last_minute = DHT22_History_AddWindow(&history, 30);
+ *
+ *   DHT22_History_Push(&history, reading.humidity, reading.temperature);
+ *
+ *   DHT22_History_StatsTypeDef t;
+ *   DHT22_History_GetStats(&history, last_minute, DHT22_HISTORY_TEMPERATURE, &t);
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _DHT22_HISTORY_H_
+#define _DHT22_HISTORY_H_
+
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+/*                          DHT22 History Constants                           */
+/* -------------------------------------------------------------------------- */
+
+/* Samples kept, a power of two up to 32768 */
+#ifndef DHT22_HISTORY_CAPACITY
+#define DHT22_HISTORY_CAPACITY 512U
+#endif
+
+/* Sliding windows per history */
+#ifndef DHT22_HISTORY_WINDOWS
+#define DHT22_HISTORY_WINDOWS 2U
+#endif
+
+/* Longest window in samples, at most DHT22_HISTORY_CAPACITY */
+#ifndef DHT22_HISTORY_WINDOW_MAX
+#define DHT22_HISTORY_WINDOW_MAX 150U
+#endif
+
+/* Channels of a sample */
+#define DHT22_HISTORY_HUMIDITY 0U
+#define DHT22_HISTORY_TEMPERATURE 1U
+#define DHT22_HISTORY_CHANNELS 2U
+
+/* -------------------------------------------------------------------------- */
+/*                           DHT22 History Structs                            */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Statistics of one channel over a span of samples, in deci-units
+ */
+typedef struct
+{
+    uint16_t count;    /*!< Samples covered, 0 if the span is empty */
+    int16_t min;       /*!< Smallest value */
+    int16_t max;       /*!< Largest value */
+    int16_t mean;      /*!< Mean, rounded to nearest */
+    uint32_t variance; /*!< Sample variance in squared deci-units */
+} DHT22_History_StatsTypeDef;
+
+/**
+ * @brief  Monotonic deque of sample numbers (low 16 bits)
+ */
+typedef struct
+{
+    uint16_t seq[DHT22_HISTORY_WINDOW_MAX]; /*!< Ring of sample numbers */
+    uint16_t first;                         /*!< Index of the front entry */
+    uint16_t count;                         /*!< Entries in use */
+} DHT22_History_DequeTypeDef;
+
+/**
+ * @brief  Sliding window over the newest samples
+ */
+typedef struct
+{
+    uint16_t length;                                         /*!< Window length, 0 for an unused slot */
+    int32_t sum[DHT22_HISTORY_CHANNELS];                     /*!< Sum of the samples in the window */
+    uint64_t sumSq[DHT22_HISTORY_CHANNELS];                  /*!< Sum of their squares */
+    DHT22_History_DequeTypeDef minq[DHT22_HISTORY_CHANNELS]; /*!< Increasing values, front is the minimum */
+    DHT22_History_DequeTypeDef maxq[DHT22_HISTORY_CHANNELS]; /*!< Decreasing values, front is the maximum */
+} DHT22_History_WindowTypeDef;
+
+/**
+ * @brief  DHT22 history structure definition
+ */
+typedef struct
+{
+    int16_t samples[DHT22_HISTORY_CAPACITY][DHT22_HISTORY_CHANNELS]; /*!< Humidity/temperature pairs */
+    uint32_t total;                                                  /*!< Samples pushed since init */
+    DHT22_History_WindowTypeDef windows[DHT22_HISTORY_WINDOWS];      /*!< Sliding windows */
+} DHT22_HistoryTypeDef;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Initialize an empty history without windows.
+ * @param  hist: Pointer to history structure.
+ * @retval None
+ */
+void DHT22_History_Init(DHT22_HistoryTypeDef *hist);
+
+/**
+ * @brief  Add a sliding window. Samples already stored are not included,
+ *         add windows before the first push.
+ * @param  hist: Pointer to history structure.
+ * @param  length: Window length in samples, 1..DHT22_HISTORY_WINDOW_MAX.
+ * @retval Window id, or -1 if the length is invalid or no slot is free.
+ */
+int8_t DHT22_History_AddWindow(DHT22_HistoryTypeDef *hist, uint16_t length);
+
+/**
+ * @brief  Store a reading and update every window.
+ * @param  hist: Pointer to history structure.
+ * @param  humidity: Relative humidity in 0.1 %.
+ * @param  temperature: Temperature in 0.1 degree Celsius.
+ * @retval None
+ */
+void DHT22_History_Push(DHT22_HistoryTypeDef *hist, int16_t humidity, int16_t temperature);
+
+/**
+ * @brief  Number of samples currently stored.
+ * @param  hist: Pointer to history structure.
+ * @retval Stored samples, up to DHT22_HISTORY_CAPACITY.
+ */
+uint16_t DHT22_History_Count(const DHT22_HistoryTypeDef *hist);
+
+/**
+ * @brief  Read back a stored sample.
+ * @param  hist: Pointer to history structure.
+ * @param  age: 0 for the newest sample, 1 for the one before, ...
+ * @param  channel: DHT22_HISTORY_HUMIDITY or DHT22_HISTORY_TEMPERATURE.
+ * @param  value: Pointer to receive the value.
+ * @retval 1 if the sample exists, 0 otherwise.
+ */
+uint8_t DHT22_History_Get(const DHT22_HistoryTypeDef *hist, uint16_t age, uint8_t channel, int16_t *value);
+
+/**
+ * @brief  Statistics of a sliding window, in O(1).
+ * @param  hist: Pointer to history structure.
+ * @param  window: Window id returned by DHT22_History_AddWindow().
+ * @param  channel: DHT22_HISTORY_HUMIDITY or DHT22_HISTORY_TEMPERATURE.
+ * @param  stats: Pointer to receive the statistics.
+ * @retval Samples in the window, fewer than its length while filling.
+ */
+uint16_t DHT22_History_GetStats(const DHT22_HistoryTypeDef *hist, int8_t window, uint8_t channel,
+                                DHT22_History_StatsTypeDef *stats);
+
+/**
+ * @brief  Statistics of the newest samples by rescanning them, in O(span).
+ * @param  hist: Pointer to history structure.
+ * @param  span: Samples to cover, clipped to the stored count.
+ * @param  channel: DHT22_HISTORY_HUMIDITY or DHT22_HISTORY_TEMPERATURE.
+ * @param  stats: Pointer to receive the statistics.
+ * @retval Samples covered.
+ */
+uint16_t DHT22_History_Compute(const DHT22_HistoryTypeDef *hist, uint16_t span, uint8_t channel,
+                               DHT22_History_StatsTypeDef *stats);
+
+#endif /* _DHT22_HISTORY_H_ */
@@ -0,0 +1,387 @@
+#include "FlashLog.h"
+#include "CRC16.h"
+#include <stddef.h>
+
+/* First half-word of a committed page header */
+#define FLASHLOG_MAGIC 0x4C47U
+
+#define FLASHLOG_RECORD_WORDS (FLASHLOG_RECORD_BYTES / 2U)
+
+static inline uint32_t FlashLog_PageOffset(const FlashLog_HandleTypeDef *hlog, uint8_t page)
+{
+    return (uint32_t)page * hlog->flash->pageSize;
+}
+
+static inline uint16_t FlashLog_Read16(const FlashLog_HandleTypeDef *hlog, uint32_t offset)
+{
+    const uint8_t *p = hlog->flash->mem + offset;
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t FlashLog_Read32(const FlashLog_HandleTypeDef *hlog, uint32_t offset)
+{
+    return FlashLog_Read16(hlog, offset) | ((uint32_t)FlashLog_Read16(hlog, offset + 2U) << 16);
+}
+
+/* Page index of the k-th valid page, 0 being the oldest */
+static inline uint8_t FlashLog_PageAt(const FlashLog_HandleTypeDef *hlog, uint8_t k)
+{
+    return (uint8_t)((hlog->oldest + k) % hlog->flash->pageCount);
+}
+
+/* Position of a page in the ring, 0 for the oldest, >= used if not valid */
+static inline uint8_t FlashLog_PageRank(const FlashLog_HandleTypeDef *hlog, uint8_t page)
+{
+    return (uint8_t)((page + hlog->flash->pageCount - hlog->oldest) % hlog->flash->pageCount);
+}
+
+/* CRC over little-endian 32-bit and 16-bit fields, as they sit in flash */
+static uint16_t FlashLog_Crc(const uint16_t *words, uint8_t count)
+{
+    uint8_t bytes[8];
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        bytes[2U * i] = (uint8_t)words[i];
+        bytes[2U * i + 1U] = (uint8_t)(words[i] >> 8);
+    }
+    return CRC16_Update(CRC16_INIT, bytes, 2U * count);
+}
+
+static uint8_t FlashLog_HeaderValid(const FlashLog_HandleTypeDef *hlog, uint8_t page, uint32_t *seq, uint32_t *time)
+{
+    uint32_t base = FlashLog_PageOffset(hlog, page);
+    uint16_t words[5];
+
+    if (FlashLog_Read16(hlog, base) != FLASHLOG_MAGIC)
+    {
+        return 0;
+    }
+    for (uint8_t i = 0; i < 5U; i++)
+    {
+        words[i] = FlashLog_Read16(hlog, base + 2U + 2U * i);
+    }
+    if (FlashLog_Crc(words, 4) != words[4])
+    {
+        return 0;
+    }
+
+    *seq = words[0] | ((uint32_t)words[1] << 16);
+    *time = words[2] | ((uint32_t)words[3] << 16);
+    return 1;
+}
+
+static inline uint32_t FlashLog_HeaderTime(const FlashLog_HandleTypeDef *hlog, uint8_t page)
+{
+    return FlashLog_Read32(hlog, FlashLog_PageOffset(hlog, page) + 6U);
+}
+
+static uint8_t FlashLog_SlotBlank(const FlashLog_HandleTypeDef *hlog, uint8_t page, uint16_t offset)
+{
+    uint32_t base = FlashLog_PageOffset(hlog, page) + offset;
+
+    for (uint8_t i = 0; i < FLASHLOG_RECORD_WORDS; i++)
+    {
+        if (FlashLog_Read16(hlog, base + 2U * i) != 0xFFFFU)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static uint8_t FlashLog_RecordRead(const FlashLog_HandleTypeDef *hlog, uint8_t page, uint16_t offset,
+                                   FlashLog_RecordTypeDef *record)
+{
+    uint32_t base = FlashLog_PageOffset(hlog, page) + offset;
+    uint16_t words[FLASHLOG_RECORD_WORDS];
+
+    for (uint8_t i = 0; i < FLASHLOG_RECORD_WORDS; i++)
+    {
+        words[i] = FlashLog_Read16(hlog, base + 2U * i);
+    }
+    if (FlashLog_Crc(words, 4) != words[4])
+    {
+        return 0;
+    }
+
+    record->time = words[0] | ((uint32_t)words[1] << 16);
+    record->humidity = (int16_t)words[2];
+    record->temperature = (int16_t)words[3];
+    return 1;
+}
+
+static inline uint8_t FlashLog_SlotFits(const FlashLog_HandleTypeDef *hlog, uint16_t offset)
+{
+    return (uint32_t)offset + FLASHLOG_RECORD_BYTES <= hlog->flash->pageSize;
+}
+
+/* Recycle the page after the newest one and commit a fresh header on it */
+static FlashLog_StatusTypeDef FlashLog_OpenPage(FlashLog_HandleTypeDef *hlog, uint32_t time)
+{
+    uint8_t count = hlog->flash->pageCount;
+    uint8_t page = (hlog->used == 0U) ? 0U : FlashLog_PageAt(hlog, hlog->used);
+
+    if (hlog->used == count)
+    {
+        // The ring is full: the page to erase is the oldest one
+        hlog->oldest = FlashLog_PageAt(hlog, 1);
+        hlog->used--;
+    }
+
+    uint32_t base = FlashLog_PageOffset(hlog, page);
+    if (hlog->flash->Erase(base) != FLASHLOG_OK)
+    {
+        return FLASHLOG_ERROR;
+    }
+
+    uint32_t seq = hlog->seq + 1U;
+    uint16_t words[5] = {(uint16_t)seq, (uint16_t)(seq >> 16), (uint16_t)time, (uint16_t)(time >> 16), 0};
+    words[4] = FlashLog_Crc(words, 4);
+
+    // Magic last: until it is programmed the page does not count
+    uint16_t magic = FLASHLOG_MAGIC;
+    if (hlog->flash->Program(base + 2U, words, 5) != FLASHLOG_OK || hlog->flash->Program(base, &magic, 1) != FLASHLOG_OK)
+    {
+        return FLASHLOG_ERROR;
+    }
+
+    if (hlog->used == 0U)
+    {
+        hlog->oldest = page;
+    }
+    hlog->used++;
+    hlog->seq = seq;
+    hlog->writeOffset = FLASHLOG_HEADER_BYTES;
+    return FLASHLOG_OK;
+}
+
+FlashLog_StatusTypeDef FlashLog_Init(FlashLog_HandleTypeDef *hlog, const FlashLog_FlashTypeDef *flash)
+{
+    if (hlog == NULL || flash == NULL || flash->mem == NULL || flash->Erase == NULL || flash->Program == NULL ||
+        flash->pageCount < 2U || flash->pageCount > FLASHLOG_MAX_PAGES ||
+        flash->pageSize < FLASHLOG_HEADER_BYTES + FLASHLOG_RECORD_BYTES)
+    {
+        return FLASHLOG_ERROR;
+    }
+
+    hlog->flash = flash;
+    hlog->oldest = 0;
+    hlog->used = 0;
+    hlog->seq = 0;
+    hlog->writeOffset = 0;
+    hlog->lastTime = 0;
+    hlog->corrupted = 0;
+    hlog->pendingCount = 0;
+
+    uint8_t valid[FLASHLOG_MAX_PAGES];
+    uint32_t seqs[FLASHLOG_MAX_PAGES];
+    uint32_t time;
+    uint8_t newest = 0;
+    for (uint8_t p = 0; p < flash->pageCount; p++)
+    {
+        valid[p] = FlashLog_HeaderValid(hlog, p, &seqs[p], &time);
+        if (valid[p] && (hlog->used == 0U || seqs[p] > seqs[newest]))
+        {
+            newest = p;
+            hlog->used = 1;
+        }
+    }
+    if (hlog->used == 0U)
+    {
+        return FLASHLOG_OK;
+    }
+
+    // Walk back from the newest page while the sequence numbers follow on;
+    // anything else is left over from an older ring or an interrupted erase
+    uint8_t oldest = newest;
+    while (hlog->used < flash->pageCount)
+    {
+        uint8_t prev = (uint8_t)((oldest + flash->pageCount - 1U) % flash->pageCount);
+        if (!valid[prev] || seqs[prev] != seqs[oldest] - 1U)
+        {
+            break;
+        }
+        oldest = prev;
+        hlog->used++;
+    }
+    hlog->oldest = oldest;
+    hlog->seq = seqs[newest];
+    hlog->lastTime = FlashLog_HeaderTime(hlog, newest);
+
+    // Records are programmed in order: the first blank slot is the write
+    // position, a torn record before it is counted and stepped over
+    uint16_t offset = FLASHLOG_HEADER_BYTES;
+    FlashLog_RecordTypeDef record;
+    while (FlashLog_SlotFits(hlog, offset) && !FlashLog_SlotBlank(hlog, newest, offset))
+    {
+        if (FlashLog_RecordRead(hlog, newest, offset, &record))
+        {
+            hlog->lastTime = record.time;
+        }
+        else
+        {
+            hlog->corrupted++;
+        }
+        offset += FLASHLOG_RECORD_BYTES;
+    }
+    hlog->writeOffset = offset;
+
+    return FLASHLOG_OK;
+}
+
+FlashLog_StatusTypeDef FlashLog_Format(FlashLog_HandleTypeDef *hlog)
+{
+    for (uint8_t p = 0; p < hlog->flash->pageCount; p++)
+    {
+        if (hlog->flash->Erase(FlashLog_PageOffset(hlog, p)) != FLASHLOG_OK)
+        {
+            return FLASHLOG_ERROR;
+        }
+    }
+
+    hlog->oldest = 0;
+    hlog->used = 0;
+    hlog->writeOffset = 0;
+    hlog->lastTime = 0;
+    hlog->pendingCount = 0;
+    return FLASHLOG_OK;
+}
+
+FlashLog_StatusTypeDef FlashLog_Append(FlashLog_HandleTypeDef *hlog, uint32_t time, int16_t humidity,
+                                       int16_t temperature)
+{
+    if (time < hlog->lastTime)
+    {
+        return FLASHLOG_ERROR;
+    }
+
+    FlashLog_RecordTypeDef *record = &hlog->pending[hlog->pendingCount++];
+    record->time = time;
+    record->humidity = humidity;
+    record->temperature = temperature;
+    hlog->lastTime = time;
+
+    return (hlog->pendingCount == FLASHLOG_BATCH) ? FlashLog_Flush(hlog) : FLASHLOG_OK;
+}
+
+FlashLog_StatusTypeDef FlashLog_Flush(FlashLog_HandleTypeDef *hlog)
+{
+    uint16_t words[FLASHLOG_BATCH * FLASHLOG_RECORD_WORDS];
+    FlashLog_StatusTypeDef status = FLASHLOG_OK;
+    uint8_t done = 0;
+
+    while (done < hlog->pendingCount)
+    {
+        if (hlog->used == 0U || !FlashLog_SlotFits(hlog, hlog->writeOffset))
+        {
+            status = FlashLog_OpenPage(hlog, hlog->pending[done].time);
+            if (status != FLASHLOG_OK)
+            {
+                break;
+            }
+        }
+
+        // As many records as the page still takes, in one programming run
+        uint8_t n = 0;
+        uint16_t offset = hlog->writeOffset;
+        while (done + n < hlog->pendingCount && FlashLog_SlotFits(hlog, offset))
+        {
+            const FlashLog_RecordTypeDef *record = &hlog->pending[done + n];
+            uint16_t *w = &words[n * FLASHLOG_RECORD_WORDS];
+            w[0] = (uint16_t)record->time;
+            w[1] = (uint16_t)(record->time >> 16);
+            w[2] = (uint16_t)record->humidity;
+            w[3] = (uint16_t)record->temperature;
+            w[4] = FlashLog_Crc(w, 4);
+            n++;
+            offset += FLASHLOG_RECORD_BYTES;
+        }
+
+        uint32_t base = FlashLog_PageOffset(hlog, FlashLog_PageAt(hlog, hlog->used - 1U));
+        status = hlog->flash->Program(base + hlog->writeOffset, words, (uint16_t)(n * FLASHLOG_RECORD_WORDS));
+        // Even a failed run may have programmed part of the slots: never reuse them
+        hlog->writeOffset = offset;
+        done += n;
+        if (status != FLASHLOG_OK)
+        {
+            break;
+        }
+    }
+
+    // Records that could not be written are dropped, not retried forever
+    hlog->pendingCount = 0;
+    return status;
+}
+
+FlashLog_StatusTypeDef FlashLog_Seek(FlashLog_HandleTypeDef *hlog, uint32_t time, FlashLog_CursorTypeDef *cursor)
+{
+    if (hlog->used == 0U)
+    {
+        cursor->page = 0;
+        cursor->offset = 0;
+        return FLASHLOG_END;
+    }
+
+    // Header timestamps rise along the ring: binary search for the last page
+    // starting at or before the time
+    uint8_t lo = 0;
+    uint8_t hi = hlog->used - 1U;
+    while (lo < hi)
+    {
+        uint8_t mid = (uint8_t)((lo + hi + 1U) / 2U);
+        if (FlashLog_HeaderTime(hlog, FlashLog_PageAt(hlog, mid)) <= time)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1U;
+        }
+    }
+
+    cursor->page = FlashLog_PageAt(hlog, lo);
+    cursor->offset = FLASHLOG_HEADER_BYTES;
+
+    FlashLog_RecordTypeDef record;
+    while (FlashLog_SlotFits(hlog, cursor->offset) && !FlashLog_SlotBlank(hlog, cursor->page, cursor->offset))
+    {
+        if (FlashLog_RecordRead(hlog, cursor->page, cursor->offset, &record) && record.time >= time)
+        {
+            break;
+        }
+        cursor->offset += FLASHLOG_RECORD_BYTES;
+    }
+    return FLASHLOG_OK;
+}
+
+FlashLog_StatusTypeDef FlashLog_Next(FlashLog_HandleTypeDef *hlog, FlashLog_CursorTypeDef *cursor,
+                                     FlashLog_RecordTypeDef *record)
+{
+    while (FlashLog_PageRank(hlog, cursor->page) < hlog->used)
+    {
+        if (FlashLog_SlotFits(hlog, cursor->offset) && !FlashLog_SlotBlank(hlog, cursor->page, cursor->offset))
+        {
+            uint16_t offset = cursor->offset;
+            cursor->offset += FLASHLOG_RECORD_BYTES;
+            if (FlashLog_RecordRead(hlog, cursor->page, offset, record))
+            {
+                return FLASHLOG_OK;
+            }
+            continue;
+        }
+
+        if (FlashLog_PageRank(hlog, cursor->page) == hlog->used - 1U)
+        {
+            break;
+        }
+        cursor->page = (uint8_t)((cursor->page + 1U) % hlog->flash->pageCount);
+        cursor->offset = FLASHLOG_HEADER_BYTES;
+    }
+    return FLASHLOG_END;
+}
+
+uint32_t FlashLog_LastTime(const FlashLog_HandleTypeDef *hlog)
+{
+    return hlog->lastTime;
+}
@@ -0,0 +1,205 @@
+/**
+ ******************************************************************************
+ * @file           : FlashLog.h
+ * @brief          : Header file for the persistent sample log.
+ *                   Appends timestamped readings to a ring of flash pages
+ *                   that survives resets and power loss.
+ ******************************************************************************
+ * @attention
+ *
+ * The log owns a few erase pages used in rotation: records are appended to
+ * the newest page; when it is full the page after it, the oldest one, is
+ * erased and becomes the newest. Every page is erased once per trip around
+ * the ring, which spreads wear evenly.
+ *
+ * Page layout, half-word aligned:
+ *  - header (12 bytes): magic, 32-bit page sequence number, timestamp of the
+ *    first record, CRC-16 of sequence and timestamp. The magic is programmed
+ *    last and commits the header;
+ *  - records (10 bytes each): timestamp, humidity, temperature, CRC-16.
+ *
+ * Power loss is handled at start-up by FlashLog_Init(): a page whose header
+ * is incomplete or corrupted (interrupted erase or header write) is ignored
+ * and erased again when its turn comes; a record cut short fails its CRC and
+ * is skipped, the next record goes after it. No page is ever rewritten in
+ * place, so a reset can at worst lose the page being recycled and the
+ * records still buffered in RAM.
+ *
+ * Records are buffered in RAM and programmed FLASHLOG_BATCH at a time in one
+ * sequence of half-word writes. Timestamps are caller-defined (e.g. seconds)
+ * and must not decrease. The page headers form an index: FlashLog_Seek()
+ * picks the page from the header timestamps and only scans that one.
+ *
+ * Flash access goes through FlashLog_FlashTypeDef: the firmware uses the HAL
+ * port in FlashLog_HAL.h, the host simulation passes Sim_Flash, an array in
+ * RAM with power-loss injection (Sim/Inc/Sim_Flash.h). The module itself
+ * depends only on <stdint.h> and CRC16.
+ *
+ * Example usage:
+ * @code
+ *   FlashLog_HandleTypeDef hlog;
+ *   FlashLog_Init(&hlog, &FlashLog_HAL_Flash);
+ *
+ *   FlashLog_Append(&hlog, seconds, reading.humidity, reading.temperature);
+ *
+ *   FlashLog_CursorTypeDef cur;
+ *   FlashLog_RecordTypeDef rec;
+ *   FlashLog_Seek(&hlog, seconds - 3600, &cur);
+ *   while (FlashLog_Next(&hlog, &cur, &rec) == FLASHLOG_OK) {
+ *       // rec.time, rec.humidity, rec.temperature
+ *   }
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _FLASHLOG_H_
+#define _FLASHLOG_H_
+
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+/*                             FlashLog Constants                             */
+/* -------------------------------------------------------------------------- */
+
+/* Records buffered in RAM before they are programmed */
+#ifndef FLASHLOG_BATCH
+#define FLASHLOG_BATCH 4U
+#endif
+
+/* Pages of the ring, at least 2 */
+#define FLASHLOG_MAX_PAGES 16U
+
+/* Sizes on flash */
+#define FLASHLOG_HEADER_BYTES 12U
+#define FLASHLOG_RECORD_BYTES 10U
+
+/* -------------------------------------------------------------------------- */
+/*                              FlashLog Structs                              */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  FlashLog result
+ */
+typedef enum
+{
+    FLASHLOG_OK = 0x00U,    /*!< Done */
+    FLASHLOG_ERROR = 0x01U, /*!< Invalid argument or flash operation failed */
+    FLASHLOG_END = 0x02U    /*!< No (more) records */
+} FlashLog_StatusTypeDef;
+
+/**
+ * @brief  Flash region holding the log and its operations. The region is
+ *         readable as memory at mem; Erase and Program take byte offsets from
+ *         its start.
+ */
+typedef struct
+{
+    const uint8_t *mem;                                                                     /*!< Region start */
+    uint16_t pageSize;                                                                      /*!< Erase page size */
+    uint8_t pageCount;                                                                      /*!< Pages, 2..16 */
+    FlashLog_StatusTypeDef (*Erase)(uint32_t offset);                                       /*!< Erase a page */
+    FlashLog_StatusTypeDef (*Program)(uint32_t offset, const uint16_t *data, uint16_t count); /*!< Program half-words */
+} FlashLog_FlashTypeDef;
+
+/**
+ * @brief  One logged reading
+ */
+typedef struct
+{
+    uint32_t time;       /*!< Caller timestamp */
+    int16_t humidity;    /*!< Relative humidity in 0.1 % */
+    int16_t temperature; /*!< Temperature in 0.1 degree Celsius */
+} FlashLog_RecordTypeDef;
+
+/**
+ * @brief  Read position
+ */
+typedef struct
+{
+    uint8_t page;    /*!< Page index in the region */
+    uint16_t offset; /*!< Byte offset of the next record in the page */
+} FlashLog_CursorTypeDef;
+
+/**
+ * @brief  FlashLog handle structure definition
+ */
+typedef struct
+{
+    const FlashLog_FlashTypeDef *flash;             /*!< Flash region and operations */
+    uint8_t oldest;                                 /*!< Oldest valid page */
+    uint8_t used;                                   /*!< Valid pages, 0 for an empty log */
+    uint32_t seq;                                   /*!< Sequence number of the newest page */
+    uint16_t writeOffset;                           /*!< Next record offset in the newest page */
+    uint32_t lastTime;                              /*!< Timestamp of the newest record */
+    uint32_t corrupted;                             /*!< Torn or invalid records found at start-up */
+    FlashLog_RecordTypeDef pending[FLASHLOG_BATCH]; /*!< Records not yet programmed */
+    uint8_t pendingCount;                           /*!< Entries used in pending */
+} FlashLog_HandleTypeDef;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Open the log: find the valid pages, the newest record and the
+ *         write position, skipping whatever a power loss left behind.
+ * @param  hlog: Pointer to FlashLog handle structure.
+ * @param  flash: Flash region of the log.
+ * @retval FLASHLOG_ERROR if the region description is invalid.
+ */
+FlashLog_StatusTypeDef FlashLog_Init(FlashLog_HandleTypeDef *hlog, const FlashLog_FlashTypeDef *flash);
+
+/**
+ * @brief  Erase every page of the log.
+ * @param  hlog: Pointer to FlashLog handle structure.
+ * @retval FlashLog status
+ */
+FlashLog_StatusTypeDef FlashLog_Format(FlashLog_HandleTypeDef *hlog);
+
+/**
+ * @brief  Queue a record, programming the batch once it is full.
+ * @param  hlog: Pointer to FlashLog handle structure.
+ * @param  time: Timestamp, not lower than the previous one.
+ * @param  humidity: Relative humidity in 0.1 %.
+ * @param  temperature: Temperature in 0.1 degree Celsius.
+ * @retval FLASHLOG_ERROR if the timestamp goes backwards or programming failed.
+ */
+FlashLog_StatusTypeDef FlashLog_Append(FlashLog_HandleTypeDef *hlog, uint32_t time, int16_t humidity,
+                                       int16_t temperature);
+
+/**
+ * @brief  Program the buffered records now (e.g. before a planned reset).
+ * @param  hlog: Pointer to FlashLog handle structure.
+ * @retval FlashLog status
+ */
+FlashLog_StatusTypeDef FlashLog_Flush(FlashLog_HandleTypeDef *hlog);
+
+/**
+ * @brief  Position a cursor on the first programmed record at or after a time.
+ * @param  hlog: Pointer to FlashLog handle structure.
+ * @param  time: Timestamp to look for, 0 for the oldest record.
+ * @param  cursor: Pointer to the cursor to set.
+ * @retval FLASHLOG_END if the log is empty.
+ */
+FlashLog_StatusTypeDef FlashLog_Seek(FlashLog_HandleTypeDef *hlog, uint32_t time, FlashLog_CursorTypeDef *cursor);
+
+/**
+ * @brief  Read the record at the cursor and advance it. Records that fail
+ *         their CRC are skipped.
+ * @param  hlog: Pointer to FlashLog handle structure.
+ * @param  cursor: Cursor set by FlashLog_Seek().
+ * @param  record: Pointer to receive the record.
+ * @retval FLASHLOG_END after the newest programmed record.
+ */
+FlashLog_StatusTypeDef FlashLog_Next(FlashLog_HandleTypeDef *hlog, FlashLog_CursorTypeDef *cursor,
+                                     FlashLog_RecordTypeDef *record);
+
+/**
+ * @brief  Timestamp of the newest record, buffered or programmed.
+ * @param  hlog: Pointer to FlashLog handle structure.
+ * @retval Timestamp, 0 if the log is empty.
+ */
+uint32_t FlashLog_LastTime(const FlashLog_HandleTypeDef *hlog);
+
+#endif /* _FLASHLOG_H_ */
@@ -0,0 +1,40 @@
+#include "FlashLog_HAL.h"
+
+static FlashLog_StatusTypeDef FlashLog_HAL_Erase(uint32_t offset)
+{
+    FLASH_EraseInitTypeDef erase = {0};
+    uint32_t page_error = 0;
+
+    erase.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase.PageAddress = FLASHLOG_HAL_BASE + offset;
+    erase.NbPages = 1;
+
+    HAL_FLASH_Unlock();
+    HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &page_error);
+    HAL_FLASH_Lock();
+
+    return (status == HAL_OK) ? FLASHLOG_OK : FLASHLOG_ERROR;
+}
+
+static FlashLog_StatusTypeDef FlashLog_HAL_Program(uint32_t offset, const uint16_t *data, uint16_t count)
+{
+    HAL_StatusTypeDef status = HAL_OK;
+
+    // One unlock for the whole run: the batch is the unit of programming
+    HAL_FLASH_Unlock();
+    for (uint16_t i = 0; i < count && status == HAL_OK; i++)
+    {
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, FLASHLOG_HAL_BASE + offset + 2U * i, data[i]);
+    }
+    HAL_FLASH_Lock();
+
+    return (status == HAL_OK) ? FLASHLOG_OK : FLASHLOG_ERROR;
+}
+
+const FlashLog_FlashTypeDef FlashLog_HAL_Flash = {
+    .mem = (const uint8_t *)FLASHLOG_HAL_BASE,
+    .pageSize = FLASH_PAGE_SIZE,
+    .pageCount = FLASHLOG_HAL_PAGES,
+    .Erase = FlashLog_HAL_Erase,
+    .Program = FlashLog_HAL_Program,
+};
@@ -0,0 +1,44 @@
+/**
+ ******************************************************************************
+ * @file           : FlashLog_HAL.h
+ * @brief          : Header file for the on-chip flash port of FlashLog.
+ *                   Describes the log pages at the top of the STM32F103C8
+ *                   flash and erases/programs them through the HAL.
+ ******************************************************************************
+ * @attention
+ *
+ * The log occupies the last FLASHLOG_HAL_PAGES pages of the 64 KB flash
+ * (pages 60 to 63, 0x0800F000 to 0x0800FFFF by default). The linker script
+ * ends the FLASH region below them so code never lands there; keep both in
+ * step when changing the page count.
+ *
+ * The CPU stalls while a page is erased (~20 ms) or a half-word programmed
+ * (~50 us) since it fetches its code from the same bank. DMA transfers keep
+ * running, interrupt handlers are delayed: flush the log from the main loop,
+ * not from an interrupt or a timing-critical section.
+ *
+ ******************************************************************************
+ */
+
+#ifndef _FLASHLOG_HAL_H_
+#define _FLASHLOG_HAL_H_
+
+#include "FlashLog.h"
+#include "stm32f1xx_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/*                          FlashLog HAL Constants                            */
+/* -------------------------------------------------------------------------- */
+
+/* Pages reserved for the log at the top of flash */
+#ifndef FLASHLOG_HAL_PAGES
+#define FLASHLOG_HAL_PAGES 4U
+#endif
+
+/* First byte of the log region */
+#define FLASHLOG_HAL_BASE (FLASH_BASE + 0x10000U - FLASHLOG_HAL_PAGES * FLASH_PAGE_SIZE)
+
+/* On-chip flash region for FlashLog_Init() */
+extern const FlashLog_FlashTypeDef FlashLog_HAL_Flash;
+
+#endif /* _FLASHLOG_HAL_H_ */
@@ -0,0 +1,906 @@
+#include "I2C_Bus.h"
+#include "Timebase.h"
+#include <string.h>
+
+const I2C_Bus_ProfileTypeDef I2C_Bus_Standard = {100000U, I2C_DUTYCYCLE_2};
+const I2C_Bus_ProfileTypeDef I2C_Bus_Fast = {400000U, I2C_DUTYCYCLE_2};
+
+static uint8_t I2C_Bus_SameProfile(const I2C_Bus_ProfileTypeDef *a, const I2C_Bus_ProfileTypeDef *b)
+{
+    return (a->ClockSpeed == b->ClockSpeed) && (a->DutyCycle == b->DutyCycle);
+}
+
+static uint8_t I2C_Bus_ValidProfile(const I2C_Bus_ProfileTypeDef *profile)
+{
+    return IS_I2C_CLOCK_SPEED(profile->ClockSpeed) && IS_I2C_DUTY_CYCLE(profile->DutyCycle);
+}
+
+HAL_StatusTypeDef I2C_Bus_Init(I2C_Bus_HandleTypeDef *hbus, I2C_HandleTypeDef *hi2c)
+{
+    if (hbus == NULL || hi2c == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    hbus->hi2c = hi2c;
+    hbus->defaultProfile.ClockSpeed = hi2c->Init.ClockSpeed;
+    hbus->defaultProfile.DutyCycle = hi2c->Init.DutyCycle;
+    hbus->active = hbus->defaultProfile;
+    hbus->deviceCount = 0;
+    hbus->queue = NULL;
+    hbus->current = NULL;
+    hbus->hung = 0;
+    hbus->memPhase = 0;
+    hbus->needsRecovery = 0;
+    hbus->direct.pending = 0;
+    hbus->sclPort = NULL;
+    hbus->sdaPort = NULL;
+    I2C_Bus_ResetStats(hbus);
+
+    return HAL_OK;
+}
+
+void I2C_Bus_SetPins(I2C_Bus_HandleTypeDef *hbus, GPIO_TypeDef *sclPort, uint16_t sclPin, GPIO_TypeDef *sdaPort,
+                     uint16_t sdaPin)
+{
+    hbus->sclPort = sclPort;
+    hbus->sclPin = sclPin;
+    hbus->sdaPort = sdaPort;
+    hbus->sdaPin = sdaPin;
+}
+
+HAL_StatusTypeDef I2C_Bus_SetProfile(I2C_Bus_HandleTypeDef *hbus, uint8_t addr, const I2C_Bus_ProfileTypeDef *profile)
+{
+    if (profile == NULL || !I2C_Bus_ValidProfile(profile))
+    {
+        return HAL_ERROR;
+    }
+
+    uint8_t i = 0;
+    while (i < hbus->deviceCount && hbus->deviceAddr[i] != addr)
+    {
+        i++;
+    }
+    if (i == I2C_BUS_MAX_DEVICES)
+    {
+        return HAL_ERROR;
+    }
+    if (i == hbus->deviceCount)
+    {
+        hbus->deviceAddr[i] = addr;
+        hbus->deviceCount++;
+    }
+    hbus->profile[i] = *profile;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef I2C_Bus_Select(I2C_Bus_HandleTypeDef *hbus, uint8_t addr)
+{
+    const I2C_Bus_ProfileTypeDef *profile = &hbus->defaultProfile;
+
+    for (uint8_t i = 0; i < hbus->deviceCount; i++)
+    {
+        if (hbus->deviceAddr[i] == addr)
+        {
+            profile = &hbus->profile[i];
+            break;
+        }
+    }
+
+    if (I2C_Bus_SameProfile(profile, &hbus->active))
+    {
+        return HAL_OK;
+    }
+    return I2C_Bus_Apply(hbus, profile);
+}
+
+/* Wait for the stop condition of the previous transfer to leave the bus.
+ * Returns 0 if a line is still low after I2C_BUS_STOP_WAIT_US */
+static uint8_t I2C_Bus_WaitIdle(I2C_HandleTypeDef *hi2c)
+{
+    uint16_t start = Timebase_Now_us();
+
+    while (READ_BIT(hi2c->Instance->SR2, I2C_SR2_BUSY) != 0U)
+    {
+        if (Timebase_Elapsed_us(start) >= I2C_BUS_STOP_WAIT_US)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+HAL_StatusTypeDef I2C_Bus_Apply(I2C_Bus_HandleTypeDef *hbus, const I2C_Bus_ProfileTypeDef *profile)
+{
+    I2C_HandleTypeDef *hi2c = hbus->hi2c;
+    uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+
+    if (!I2C_Bus_ValidProfile(profile) || I2C_MIN_PCLK_FREQ(pclk1, profile->ClockSpeed))
+    {
+        return HAL_ERROR;
+    }
+
+    // Only retime between transfers
+    if (hi2c->State != HAL_I2C_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    // The completion interrupt comes before the stop condition has left the
+    // bus: give it a few bit times. The queue checks the flag itself before
+    // it gets here, so only a direct call ever waits
+    if (!I2C_Bus_WaitIdle(hi2c))
+    {
+        return HAL_BUSY;
+    }
+
+    uint32_t freqrange = I2C_FREQRANGE(pclk1);
+
+    // CCR and TRISE may only be written with the peripheral disabled
+    __HAL_I2C_DISABLE(hi2c);
+    MODIFY_REG(hi2c->Instance->TRISE, I2C_TRISE_TRISE, I2C_RISE_TIME(freqrange, profile->ClockSpeed));
+    MODIFY_REG(hi2c->Instance->CCR, (I2C_CCR_FS | I2C_CCR_DUTY | I2C_CCR_CCR),
+               I2C_SPEED(pclk1, profile->ClockSpeed, profile->DutyCycle));
+    __HAL_I2C_ENABLE(hi2c);
+
+    hi2c->Init.ClockSpeed = profile->ClockSpeed;
+    hi2c->Init.DutyCycle = profile->DutyCycle;
+    hbus->active = *profile;
+
+    return HAL_OK;
+}
+
+/* Drive a recovery line and hold it for half a clock period */
+static void I2C_Bus_Drive(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState level)
+{
+    HAL_GPIO_WritePin(port, pin, level);
+    Timebase_Delay_us(I2C_BUS_RECOVERY_HALF_US);
+}
+
+HAL_StatusTypeDef I2C_Bus_Recover(I2C_Bus_HandleTypeDef *hbus)
+{
+    I2C_HandleTypeDef *hi2c = hbus->hi2c;
+    HAL_StatusTypeDef status = HAL_OK;
+
+    hbus->recoveries++;
+
+    // Stops the DMA channels and returns the pins to plain inputs
+    HAL_I2C_DeInit(hi2c);
+
+    if (hbus->sclPort != NULL)
+    {
+        GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+        // Released before they become outputs, so no edge is made here
+        HAL_GPIO_WritePin(hbus->sclPort, hbus->sclPin, GPIO_PIN_SET);
+        HAL_GPIO_WritePin(hbus->sdaPort, hbus->sdaPin, GPIO_PIN_SET);
+        GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
+        GPIO_InitStruct.Pull = GPIO_NOPULL;
+        GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+        GPIO_InitStruct.Pin = hbus->sclPin;
+        HAL_GPIO_Init(hbus->sclPort, &GPIO_InitStruct);
+        GPIO_InitStruct.Pin = hbus->sdaPin;
+        HAL_GPIO_Init(hbus->sdaPort, &GPIO_InitStruct);
+        Timebase_Delay_us(I2C_BUS_RECOVERY_HALF_US);
+
+        // A slave holding SDA shifts out the rest of its byte, then sees no
+        // acknowledge and lets go
+        for (uint8_t i = 0; i < I2C_BUS_RECOVERY_CLOCKS; i++)
+        {
+            if (HAL_GPIO_ReadPin(hbus->sdaPort, hbus->sdaPin) == GPIO_PIN_SET)
+            {
+                break;
+            }
+            I2C_Bus_Drive(hbus->sclPort, hbus->sclPin, GPIO_PIN_RESET);
+            I2C_Bus_Drive(hbus->sclPort, hbus->sclPin, GPIO_PIN_SET);
+        }
+
+        // Start then stop with SCL high: every slave goes back to idle
+        I2C_Bus_Drive(hbus->sdaPort, hbus->sdaPin, GPIO_PIN_RESET);
+        I2C_Bus_Drive(hbus->sdaPort, hbus->sdaPin, GPIO_PIN_SET);
+
+        if (HAL_GPIO_ReadPin(hbus->sclPort, hbus->sclPin) == GPIO_PIN_RESET ||
+            HAL_GPIO_ReadPin(hbus->sdaPort, hbus->sdaPin) == GPIO_PIN_RESET)
+        {
+            status = HAL_ERROR;
+        }
+    }
+
+    // The MSP gives the pins back to the peripheral. HAL_I2C_Init() pulses
+    // SWRST, which also ends the reset the HAL's bus error handler leaves set
+    // and clears a BUSY flag locked by a glitch; Init holds the active profile
+    if (HAL_I2C_Init(hi2c) != HAL_OK)
+    {
+        status = HAL_ERROR;
+    }
+    return status;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                          Transfers and statistics                          */
+/* -------------------------------------------------------------------------- */
+
+/* Record of an address, or NULL; with claim set a free slot is taken */
+static I2C_Bus_StatsTypeDef *I2C_Bus_FindStats(I2C_Bus_HandleTypeDef *hbus, uint8_t addr, uint8_t claim)
+{
+    for (uint8_t i = 0; i < hbus->statsCount; i++)
+    {
+        if (hbus->statsAddr[i] == addr)
+        {
+            return &hbus->stats[i];
+        }
+    }
+    if (!claim)
+    {
+        return NULL;
+    }
+    if (hbus->statsCount == I2C_BUS_STATS_SLOTS)
+    {
+        return &hbus->otherStats;
+    }
+
+    I2C_Bus_StatsTypeDef *stats = &hbus->stats[hbus->statsCount];
+    memset(stats, 0, sizeof(*stats));
+    stats->latencyMin = UINT32_MAX;
+    hbus->statsAddr[hbus->statsCount++] = addr;
+    return stats;
+}
+
+/* Microseconds since a start stamp; the 16-bit timebase wraps after 65 ms,
+ * longer transfers (HAL timeouts) are counted on the millisecond tick */
+static uint32_t I2C_Bus_Elapsed(uint16_t start, uint32_t tick)
+{
+    uint32_t ms = HAL_GetTick() - tick;
+
+    if (ms >= 60U)
+    {
+        return ms * 1000U;
+    }
+    return Timebase_Elapsed_us(start);
+}
+
+/* Account for a finished transfer, or for a start refused with HAL_BUSY */
+static void I2C_Bus_Account(I2C_Bus_HandleTypeDef *hbus, uint8_t addr, HAL_StatusTypeDef status, uint32_t error,
+                            uint16_t size, uint32_t latency)
+{
+    // Starts may come from the main loop and from completion callbacks
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    I2C_Bus_StatsTypeDef *stats = I2C_Bus_FindStats(hbus, addr, 1);
+    if (status == HAL_BUSY)
+    {
+        stats->busyWaits++;
+        __set_PRIMASK(primask);
+        return;
+    }
+
+    stats->transactions++;
+    if (status == HAL_OK)
+    {
+        stats->bytes += size;
+    }
+    else if ((error & HAL_I2C_ERROR_AF) != 0U)
+    {
+        stats->nacks++;
+    }
+    else if (status == HAL_TIMEOUT || (error & HAL_I2C_ERROR_TIMEOUT) != 0U)
+    {
+        stats->timeouts++;
+    }
+    else
+    {
+        stats->errors++;
+    }
+
+    stats->latencyLast = latency;
+    stats->busyTime += latency;
+    if (latency < stats->latencyMin)
+    {
+        stats->latencyMin = latency;
+    }
+    if (latency > stats->latencyMax)
+    {
+        stats->latencyMax = latency;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+/* First frame of a MEM operation: the register address, most significant
+ * byte first, and no stop. I2C_Bus_Complete() sends the payload */
+static HAL_StatusTypeDef I2C_Bus_LaunchRegister(I2C_Bus_HandleTypeDef *hbus, I2C_Bus_TransactionTypeDef *xfer)
+{
+    uint16_t len = (xfer->memAddrSize == I2C_MEMADD_SIZE_16BIT) ? 2U : 1U;
+
+    hbus->memAddr[0] = (len == 2U) ? (uint8_t)(xfer->memAddr >> 8) : (uint8_t)xfer->memAddr;
+    hbus->memAddr[1] = (uint8_t)xfer->memAddr;
+
+    // Set first, the completion interrupt may come before the call returns
+    hbus->memPhase = 1;
+    HAL_StatusTypeDef status =
+        HAL_I2C_Master_Seq_Transmit_IT(hbus->hi2c, (uint16_t)(xfer->addr << 1), hbus->memAddr, len, I2C_FIRST_FRAME);
+    if (status != HAL_OK)
+    {
+        hbus->memPhase = 0;
+    }
+    return status;
+}
+
+/* Put a transaction on the wire: profile, start stamp, HAL call by kind */
+static HAL_StatusTypeDef I2C_Bus_Launch(I2C_Bus_HandleTypeDef *hbus, I2C_Bus_TransactionTypeDef *xfer, uint8_t dma)
+{
+    I2C_HandleTypeDef *hi2c = hbus->hi2c;
+    uint16_t addr = (uint16_t)(xfer->addr << 1);
+
+    HAL_StatusTypeDef status = I2C_Bus_Select(hbus, xfer->addr);
+    if (status != HAL_OK)
+    {
+        return status;
+    }
+
+    // Address, register address and restart, then the payload: 9 clocks a
+    // byte. Twice that plus a margin before I2C_Bus_Process() calls it hung
+    uint64_t clocks = (uint64_t)(xfer->size + 4U) * 9U;
+    hbus->xferBudget = (uint32_t)(clocks * 2000000U / hbus->active.ClockSpeed) + I2C_BUS_HANG_MARGIN_US;
+
+    // Stamp before starting, the completion interrupt may come first
+    hbus->xferStart = Timebase_Now_us();
+    hbus->xferTick = HAL_GetTick();
+
+    switch (xfer->op)
+    {
+    case I2C_BUS_OP_WRITE:
+        return dma ? HAL_I2C_Master_Seq_Transmit_DMA(hi2c, addr, xfer->pData, xfer->size, I2C_FIRST_AND_LAST_FRAME)
+                   : HAL_I2C_Master_Seq_Transmit_IT(hi2c, addr, xfer->pData, xfer->size, I2C_FIRST_AND_LAST_FRAME);
+    case I2C_BUS_OP_READ:
+        return dma ? HAL_I2C_Master_Seq_Receive_DMA(hi2c, addr, xfer->pData, xfer->size, I2C_FIRST_AND_LAST_FRAME)
+                   : HAL_I2C_Master_Seq_Receive_IT(hi2c, addr, xfer->pData, xfer->size, I2C_FIRST_AND_LAST_FRAME);
+    case I2C_BUS_OP_MEM_WRITE:
+    case I2C_BUS_OP_MEM_READ:
+        return I2C_Bus_LaunchRegister(hbus, xfer);
+    default:
+        return HAL_ERROR;
+    }
+}
+
+/* DMA when the handle has a channel in the transaction's direction */
+static uint8_t I2C_Bus_UseDMA(I2C_Bus_HandleTypeDef *hbus, const I2C_Bus_TransactionTypeDef *xfer)
+{
+    uint8_t receive = (xfer->op == I2C_BUS_OP_READ) || (xfer->op == I2C_BUS_OP_MEM_READ);
+    return receive ? (hbus->hi2c->hdmarx != NULL) : (hbus->hi2c->hdmatx != NULL);
+}
+
+/* Second frame of a MEM operation, from the completion of the first: the
+ * payload goes on after the register address, a read after a repeated
+ * start. No flag is polled, so this is safe in the interrupt */
+static HAL_StatusTypeDef I2C_Bus_LaunchData(I2C_Bus_HandleTypeDef *hbus, I2C_Bus_TransactionTypeDef *xfer)
+{
+    I2C_HandleTypeDef *hi2c = hbus->hi2c;
+    uint16_t addr = (uint16_t)(xfer->addr << 1);
+    uint8_t dma = I2C_Bus_UseDMA(hbus, xfer);
+
+    if (xfer->op == I2C_BUS_OP_MEM_READ)
+    {
+        return dma ? HAL_I2C_Master_Seq_Receive_DMA(hi2c, addr, xfer->pData, xfer->size, I2C_LAST_FRAME)
+                   : HAL_I2C_Master_Seq_Receive_IT(hi2c, addr, xfer->pData, xfer->size, I2C_LAST_FRAME);
+    }
+    return dma ? HAL_I2C_Master_Seq_Transmit_DMA(hi2c, addr, xfer->pData, xfer->size, I2C_LAST_FRAME)
+               : HAL_I2C_Master_Seq_Transmit_IT(hi2c, addr, xfer->pData, xfer->size, I2C_LAST_FRAME);
+}
+
+/* Close a descriptor and tell its owner */
+static void I2C_Bus_Done(I2C_Bus_TransactionTypeDef *xfer, HAL_StatusTypeDef status, uint32_t error)
+{
+    xfer->status = status;
+    xfer->error = error;
+    xfer->pending = 0;
+    if (xfer->done != NULL)
+    {
+        xfer->done(xfer);
+    }
+}
+
+/* Put a transaction back at the front of its priority level */
+static void I2C_Bus_Requeue(I2C_Bus_HandleTypeDef *hbus, I2C_Bus_TransactionTypeDef *xfer)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    I2C_Bus_TransactionTypeDef **link = (I2C_Bus_TransactionTypeDef **)&hbus->queue;
+    while (*link != NULL && (*link)->priority < xfer->priority)
+    {
+        link = &(*link)->next;
+    }
+    xfer->next = *link;
+    *link = xfer;
+    __set_PRIMASK(primask);
+}
+
+/* The millisecond tick catches waits that outlived the 16-bit microsecond counter */
+static uint8_t I2C_Bus_BackoffOver(const I2C_Bus_TransactionTypeDef *xfer)
+{
+    return (xfer->backoffUs == 0U) || (Timebase_Elapsed_us(xfer->backoffStart) >= xfer->backoffUs) ||
+           ((HAL_GetTick() - xfer->backoffTick) > (xfer->backoffUs / 1000U) + 1U);
+}
+
+/* Close a failed transfer, or queue it again after a backoff when it has
+ * retries left and the failure was on the wire */
+static void I2C_Bus_Fail(I2C_Bus_HandleTypeDef *hbus, I2C_Bus_TransactionTypeDef *xfer, HAL_StatusTypeDef status,
+                         uint32_t error)
+{
+    const uint32_t retry_on = HAL_I2C_ERROR_AF | HAL_I2C_ERROR_BERR | HAL_I2C_ERROR_ARLO | HAL_I2C_ERROR_TIMEOUT;
+
+    if (xfer == &hbus->direct || (error & retry_on) == 0U || xfer->attempt >= xfer->retries)
+    {
+        I2C_Bus_Done(xfer, status, error);
+        return;
+    }
+
+    xfer->attempt++;
+    xfer->error = error;
+    xfer->backoffUs = (uint16_t)(I2C_BUS_BACKOFF_US << (xfer->attempt - 1U));
+    xfer->backoffStart = Timebase_Now_us();
+    xfer->backoffTick = HAL_GetTick();
+    I2C_Bus_Requeue(hbus, xfer);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    I2C_Bus_FindStats(hbus, xfer->addr, 1)->retries++;
+    __set_PRIMASK(primask);
+}
+
+/* A slave holding SDA low keeps BUSY set, and the HAL would poll it for 25 ms
+ * before refusing a start. The flag is read once: no waiting here either */
+static uint8_t I2C_Bus_LineBusy(I2C_HandleTypeDef *hi2c)
+{
+    return (hi2c->State == HAL_I2C_STATE_READY) && (READ_BIT(hi2c->Instance->SR2, I2C_SR2_BUSY) != 0U);
+}
+
+/* Leave the end of current to I2C_Bus_Settle(): the bus stays claimed until
+ * then. status is HAL_OK for a transaction that has not started yet */
+static void I2C_Bus_Defer(I2C_Bus_HandleTypeDef *hbus, HAL_StatusTypeDef status, uint32_t error)
+{
+    hbus->recoverStatus = status;
+    hbus->recoverError = error;
+    hbus->needsRecovery = 1;
+}
+
+/* Start the first queued transaction that is not backing off, unless a
+ * transfer is running or the bus waits for I2C_Bus_Settle() */
+static void I2C_Bus_Run(I2C_Bus_HandleTypeDef *hbus)
+{
+    for (;;)
+    {
+        // Main loop and completion interrupt both get here: claim with IRQs masked
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        if (hbus->current != NULL || hbus->needsRecovery)
+        {
+            __set_PRIMASK(primask);
+            return;
+        }
+        I2C_Bus_TransactionTypeDef **link = (I2C_Bus_TransactionTypeDef **)&hbus->queue;
+        while (*link != NULL && !I2C_Bus_BackoffOver(*link))
+        {
+            link = &(*link)->next;
+        }
+        I2C_Bus_TransactionTypeDef *xfer = *link;
+        if (xfer == NULL)
+        {
+            __set_PRIMASK(primask);
+            return;
+        }
+        *link = xfer->next;
+        xfer->backoffUs = 0;
+        hbus->current = xfer;
+        __set_PRIMASK(primask);
+
+        // Stop condition still on the wire, or a stuck slave: this may be the
+        // completion interrupt, I2C_Bus_Process() waits and starts it
+        if (I2C_Bus_LineBusy(hbus->hi2c))
+        {
+            I2C_Bus_Defer(hbus, HAL_OK, HAL_I2C_ERROR_NONE);
+            return;
+        }
+
+        HAL_StatusTypeDef status = I2C_Bus_Launch(hbus, xfer, I2C_Bus_UseDMA(hbus, xfer));
+        if (status == HAL_OK)
+        {
+            return;
+        }
+        hbus->current = NULL;
+
+        if (status == HAL_BUSY)
+        {
+            // A blocking transfer owns the peripheral: back to the front of
+            // its level, I2C_Bus_Transmit() or I2C_Bus_Process() restarts it
+            I2C_Bus_Requeue(hbus, xfer);
+            I2C_Bus_Account(hbus, xfer->addr, HAL_BUSY, HAL_I2C_ERROR_NONE, xfer->size, 0);
+            return;
+        }
+
+        // Refused outright (parameters, profile): fail it and go on
+        I2C_Bus_Done(xfer, status, HAL_I2C_GetError(hbus->hi2c));
+    }
+}
+
+/* A bus error, lost arbitration or timeout may leave a slave holding SDA */
+static uint8_t I2C_Bus_HardError(uint32_t error)
+{
+    return (error & (HAL_I2C_ERROR_BERR | HAL_I2C_ERROR_ARLO | HAL_I2C_ERROR_TIMEOUT)) != 0U;
+}
+
+/* After a NACK the HAL has sent the stop condition; anything else, or a stop
+ * that does not leave the bus, needs a recovery. Waits: thread context only */
+static uint8_t I2C_Bus_NeedsRecovery(I2C_HandleTypeDef *hi2c, uint32_t error)
+{
+    return I2C_Bus_HardError(error) || !I2C_Bus_WaitIdle(hi2c);
+}
+
+/* End of the running transfer: completion or error interrupt, or a hang
+ * detected by I2C_Bus_Process() */
+static void I2C_Bus_Finish(I2C_Bus_HandleTypeDef *hbus, I2C_Bus_TransactionTypeDef *xfer, HAL_StatusTypeDef status,
+                           uint32_t error)
+{
+    I2C_Bus_Account(hbus, xfer->addr, status, error, xfer->size, I2C_Bus_Elapsed(hbus->xferStart, hbus->xferTick));
+
+    // A recovery is far too long for the interrupt: keep the bus claimed and
+    // leave it, and the transfer's resend, to I2C_Bus_Process()
+    if (status != HAL_OK && (I2C_Bus_HardError(error) || I2C_Bus_LineBusy(hbus->hi2c)))
+    {
+        I2C_Bus_Defer(hbus, status, error);
+        return;
+    }
+
+    // Free the bus before the hook, which may submit again
+    hbus->current = NULL;
+    hbus->hung = 0;
+    hbus->memPhase = 0;
+    if (status == HAL_OK)
+    {
+        I2C_Bus_Done(xfer, status, error);
+    }
+    else
+    {
+        I2C_Bus_Fail(hbus, xfer, status, error);
+    }
+    I2C_Bus_Run(hbus);
+}
+
+/* End of a deferred transfer, in thread context: wait for the stop
+ * condition, free a stuck bus, then close the transfer or queue it again */
+static void I2C_Bus_Settle(I2C_Bus_HandleTypeDef *hbus)
+{
+    if (!hbus->needsRecovery)
+    {
+        return;
+    }
+
+    I2C_Bus_TransactionTypeDef *xfer = hbus->current;
+    HAL_StatusTypeDef status = hbus->recoverStatus;
+    uint32_t error = hbus->recoverError;
+
+    if (I2C_Bus_NeedsRecovery(hbus->hi2c, error) && I2C_Bus_Recover(hbus) != HAL_OK && status == HAL_OK)
+    {
+        // Stuck bus that would not recover before the start: fail it, the
+        // others would only recover it again
+        status = HAL_ERROR;
+        error = HAL_I2C_ERROR_TIMEOUT;
+    }
+
+    hbus->current = NULL;
+    hbus->hung = 0;
+    hbus->memPhase = 0;
+    hbus->needsRecovery = 0;
+    if (xfer == NULL)
+    {
+        return;
+    }
+    if (status == HAL_OK)
+    {
+        I2C_Bus_Requeue(hbus, xfer);
+    }
+    else
+    {
+        I2C_Bus_Fail(hbus, xfer, status, error);
+    }
+}
+
+/* Completion or error interrupt of the running transfer */
+static void I2C_Bus_Complete(I2C_Bus_HandleTypeDef *hbus, I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status)
+{
+    I2C_Bus_TransactionTypeDef *xfer = hbus->current;
+
+    if (hi2c != hbus->hi2c || xfer == NULL || hbus->hung || hbus->needsRecovery)
+    {
+        return;
+    }
+
+    if (status == HAL_OK && hbus->memPhase)
+    {
+        // Register address sent and the bus still held: now the payload.
+        // A refused frame leaves the bus held, Finish() has it recovered
+        hbus->memPhase = 0;
+        status = I2C_Bus_LaunchData(hbus, xfer);
+        if (status == HAL_OK)
+        {
+            return;
+        }
+        I2C_Bus_Finish(hbus, xfer, HAL_ERROR, HAL_I2C_GetError(hi2c));
+        return;
+    }
+
+    uint32_t error = (status == HAL_OK) ? HAL_I2C_ERROR_NONE : HAL_I2C_GetError(hi2c);
+    I2C_Bus_Finish(hbus, xfer, status, error);
+}
+
+HAL_StatusTypeDef I2C_Bus_Transmit(I2C_Bus_HandleTypeDef *hbus, uint8_t addr, uint8_t *pData, uint16_t Size,
+                                   uint32_t Timeout)
+{
+    I2C_HandleTypeDef *hi2c = hbus->hi2c;
+
+    // Blocking, so never in an interrupt: end a deferred transfer first
+    I2C_Bus_Settle(hbus);
+
+    // Same check as the queue: never leave the HAL polling a stuck BUSY flag
+    if (hi2c->State == HAL_I2C_STATE_READY && !I2C_Bus_WaitIdle(hi2c) && I2C_Bus_Recover(hbus) != HAL_OK)
+    {
+        I2C_Bus_Account(hbus, addr, HAL_TIMEOUT, HAL_I2C_ERROR_TIMEOUT, Size, 0);
+        return HAL_TIMEOUT;
+    }
+
+    HAL_StatusTypeDef status = I2C_Bus_Select(hbus, addr);
+    uint16_t start = Timebase_Now_us();
+    uint32_t tick = HAL_GetTick();
+
+    if (status == HAL_OK)
+    {
+        status = HAL_I2C_Master_Transmit(hi2c, (uint16_t)(addr << 1), pData, Size, Timeout);
+    }
+    else if (status != HAL_BUSY)
+    {
+        return status; // Profile rejected, nothing went on the bus
+    }
+
+    uint32_t error = HAL_I2C_GetError(hi2c);
+    I2C_Bus_Account(hbus, addr, status, error, Size, I2C_Bus_Elapsed(start, tick));
+
+    if ((status == HAL_ERROR || status == HAL_TIMEOUT) && I2C_Bus_NeedsRecovery(hi2c, error))
+    {
+        I2C_Bus_Recover(hbus);
+    }
+
+    // Queued transactions may have found the peripheral taken meanwhile
+    I2C_Bus_Run(hbus);
+
+    return status;
+}
+
+static HAL_StatusTypeDef I2C_Bus_TransmitAsync(I2C_Bus_HandleTypeDef *hbus, uint8_t addr, uint8_t *pData,
+                                               uint16_t Size, uint8_t dma)
+{
+    I2C_Bus_TransactionTypeDef *xfer = &hbus->direct;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (hbus->current != NULL || hbus->needsRecovery)
+    {
+        __set_PRIMASK(primask);
+        I2C_Bus_Account(hbus, addr, HAL_BUSY, HAL_I2C_ERROR_NONE, Size, 0);
+        return HAL_BUSY;
+    }
+
+    // Possibly called from an interrupt: no waiting, I2C_Bus_Process()
+    // settles the bus for the next call
+    if (I2C_Bus_LineBusy(hbus->hi2c))
+    {
+        I2C_Bus_Defer(hbus, HAL_OK, HAL_I2C_ERROR_NONE);
+        __set_PRIMASK(primask);
+        I2C_Bus_Account(hbus, addr, HAL_BUSY, HAL_I2C_ERROR_NONE, Size, 0);
+        return HAL_BUSY;
+    }
+    hbus->current = xfer;
+    __set_PRIMASK(primask);
+
+    xfer->addr = addr;
+    xfer->op = I2C_BUS_OP_WRITE;
+    xfer->pData = pData;
+    xfer->size = Size;
+    xfer->done = NULL;
+    xfer->pending = 1;
+
+    HAL_StatusTypeDef status = I2C_Bus_Launch(hbus, xfer, dma);
+    if (status != HAL_OK)
+    {
+        hbus->current = NULL;
+        xfer->pending = 0;
+        if (status == HAL_BUSY)
+        {
+            I2C_Bus_Account(hbus, addr, HAL_BUSY, HAL_I2C_ERROR_NONE, Size, 0);
+        }
+    }
+    return status;
+}
+
+HAL_StatusTypeDef I2C_Bus_Transmit_IT(I2C_Bus_HandleTypeDef *hbus, uint8_t addr, uint8_t *pData, uint16_t Size)
+{
+    return I2C_Bus_TransmitAsync(hbus, addr, pData, Size, 0);
+}
+
+HAL_StatusTypeDef I2C_Bus_Transmit_DMA(I2C_Bus_HandleTypeDef *hbus, uint8_t addr, uint8_t *pData, uint16_t Size)
+{
+    return I2C_Bus_TransmitAsync(hbus, addr, pData, Size, 1);
+}
+
+HAL_StatusTypeDef I2C_Bus_Submit(I2C_Bus_HandleTypeDef *hbus, I2C_Bus_TransactionTypeDef *xfer)
+{
+    if (xfer == NULL || xfer->pData == NULL || xfer->size == 0U || xfer->op > I2C_BUS_OP_MEM_READ)
+    {
+        return HAL_ERROR;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (xfer->pending)
+    {
+        __set_PRIMASK(primask);
+        return HAL_BUSY;
+    }
+    xfer->pending = 1;
+    xfer->status = HAL_BUSY;
+    xfer->error = HAL_I2C_ERROR_NONE;
+    xfer->attempt = 0;
+    xfer->backoffUs = 0;
+
+    // Behind every transaction of the same or a more urgent level
+    I2C_Bus_TransactionTypeDef **link = (I2C_Bus_TransactionTypeDef **)&hbus->queue;
+    while (*link != NULL && (*link)->priority <= xfer->priority)
+    {
+        link = &(*link)->next;
+    }
+    xfer->next = *link;
+    *link = xfer;
+    __set_PRIMASK(primask);
+
+    I2C_Bus_Run(hbus);
+    return HAL_OK;
+}
+
+void I2C_Bus_Process(I2C_Bus_HandleTypeDef *hbus)
+{
+    // A slave stretching SCL forever stops the transfer without an interrupt.
+    // It stays current, so nothing else starts, while the recovery resets the
+    // peripheral under it; a completion that comes meanwhile is ignored
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    I2C_Bus_TransactionTypeDef *xfer = hbus->current;
+    if (xfer == NULL || hbus->needsRecovery || I2C_Bus_Elapsed(hbus->xferStart, hbus->xferTick) <= hbus->xferBudget)
+    {
+        xfer = NULL;
+    }
+    else
+    {
+        hbus->hung = 1;
+    }
+    __set_PRIMASK(primask);
+
+    if (xfer != NULL)
+    {
+        I2C_Bus_Finish(hbus, xfer, HAL_TIMEOUT, HAL_I2C_ERROR_TIMEOUT);
+    }
+
+    // Waits and recoveries the interrupts left, then what is due
+    I2C_Bus_Settle(hbus);
+    I2C_Bus_Run(hbus);
+}
+
+void I2C_Bus_MasterTxCpltCallback(I2C_Bus_HandleTypeDef *hbus, I2C_HandleTypeDef *hi2c)
+{
+    I2C_Bus_Complete(hbus, hi2c, HAL_OK);
+}
+
+void I2C_Bus_MasterRxCpltCallback(I2C_Bus_HandleTypeDef *hbus, I2C_HandleTypeDef *hi2c)
+{
+    I2C_Bus_Complete(hbus, hi2c, HAL_OK);
+}
+
+void I2C_Bus_MemTxCpltCallback(I2C_Bus_HandleTypeDef *hbus, I2C_HandleTypeDef *hi2c)
+{
+    I2C_Bus_Complete(hbus, hi2c, HAL_OK);
+}
+
+void I2C_Bus_MemRxCpltCallback(I2C_Bus_HandleTypeDef *hbus, I2C_HandleTypeDef *hi2c)
+{
+    I2C_Bus_Complete(hbus, hi2c, HAL_OK);
+}
+
+void I2C_Bus_ErrorCallback(I2C_Bus_HandleTypeDef *hbus, I2C_HandleTypeDef *hi2c)
+{
+    I2C_Bus_Complete(hbus, hi2c, HAL_ERROR);
+}
+
+HAL_StatusTypeDef I2C_Bus_GetStats(I2C_Bus_HandleTypeDef *hbus, uint8_t addr, I2C_Bus_StatsTypeDef *stats)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    I2C_Bus_StatsTypeDef *record = I2C_Bus_FindStats(hbus, addr, 0);
+    if (record != NULL)
+    {
+        *stats = *record;
+    }
+    __set_PRIMASK(primask);
+
+    if (record == NULL)
+    {
+        return HAL_ERROR;
+    }
+    if (stats->latencyMin == UINT32_MAX)
+    {
+        stats->latencyMin = 0; // Only refused starts so far
+    }
+    return HAL_OK;
+}
+
+void I2C_Bus_GetTotals(I2C_Bus_HandleTypeDef *hbus, I2C_Bus_StatsTypeDef *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->latencyMin = UINT32_MAX;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint8_t i = 0; i <= hbus->statsCount; i++)
+    {
+        const I2C_Bus_StatsTypeDef *record = (i < hbus->statsCount) ? &hbus->stats[i] : &hbus->otherStats;
+        stats->transactions += record->transactions;
+        stats->bytes += record->bytes;
+        stats->nacks += record->nacks;
+        stats->timeouts += record->timeouts;
+        stats->errors += record->errors;
+        stats->busyWaits += record->busyWaits;
+        stats->retries += record->retries;
+        stats->busyTime += record->busyTime;
+        if (record->transactions != 0U && record->latencyMin < stats->latencyMin)
+        {
+            stats->latencyMin = record->latencyMin;
+        }
+        if (record->latencyMax > stats->latencyMax)
+        {
+            stats->latencyMax = record->latencyMax;
+        }
+    }
+    __set_PRIMASK(primask);
+
+    if (stats->latencyMin == UINT32_MAX)
+    {
+        stats->latencyMin = 0;
+    }
+}
+
+uint16_t I2C_Bus_Utilisation(I2C_Bus_HandleTypeDef *hbus)
+{
+    I2C_Bus_StatsTypeDef totals;
+    uint32_t elapsed_ms = HAL_GetTick() - hbus->statsTick;
+
+    I2C_Bus_GetTotals(hbus, &totals);
+    if (elapsed_ms == 0U)
+    {
+        return 0;
+    }
+
+    // Busy microseconds per elapsed millisecond is already per mille
+    uint32_t permille = totals.busyTime / elapsed_ms;
+    return (uint16_t)((permille > 1000U) ? 1000U : permille);
+}
+
+void I2C_Bus_ResetStats(I2C_Bus_HandleTypeDef *hbus)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    hbus->statsCount = 0;
+    memset(&hbus->otherStats, 0, sizeof(hbus->otherStats));
+    hbus->otherStats.latencyMin = UINT32_MAX;
+    hbus->statsTick = HAL_GetTick();
+    hbus->recoveries = 0;
+    __set_PRIMASK(primask);
+}
@@ -0,0 +1,449 @@
+/**
+ ******************************************************************************
+ * @file           : I2C_Bus.h
+ * @brief          : Header file for the shared I2C bus layer.
+ *                   Keeps a clock profile per device address, retimes the
+ *                   peripheral before each transaction that needs another one
+ *                   and runs the transactions of several drivers by priority.
+ ******************************************************************************
+ * @attention
+ *
+ * Devices on one bus do not all run at the same speed: most sensors take
+ * Fast Mode while the PCF8574 LCD backpack is only rated for 100 kHz (some
+ * modules keep up at 400 kHz, main.c opts in with LCD_FAST_MODE).
+ * The bus starts with the profile of the HAL handle (MX_I2C1_Init) as the
+ * default for unregistered addresses. Before a transfer the driver calls
+ * I2C_Bus_Select() with the target address; the SCL timing registers are only
+ * rewritten when the profile actually changes, which takes a few cycles with
+ * the peripheral briefly disabled and the bus idle.
+ *
+ * At PCLK1 = 36 MHz, Fast Mode uses I2C_DUTYCYCLE_2 (CCR = 30, exactly
+ * 400 kHz). I2C_DUTYCYCLE_16_9 needs PCLK1 to be a multiple of 10 MHz and
+ * would round down to 360 kHz here.
+ *
+ * Transfers made through I2C_Bus_Transmit(), its _IT/_DMA variants and the
+ * queue also select the profile, and are counted per device address:
+ * transactions, bytes, NACKs, timeouts, other errors, starts refused because
+ * the bus was busy, resends, and the latency from the start to completion,
+ * measured on the shared microsecond timebase (Timebase_Init() must have
+ * run). The summed latency over the time since I2C_Bus_ResetStats() gives
+ * the bus utilisation. For everything but the blocking transfers the HAL completion
+ * callbacks must be forwarded to the I2C_Bus_xxxCallback() hooks.
+ *
+ * Drivers sharing the bus do not start transfers themselves: they fill an
+ * I2C_Bus_TransactionTypeDef they own and hand it to I2C_Bus_Submit(). The
+ * queue is ordered by priority, first come first served within one level.
+ * Each completion interrupt calls the finished transaction's done hook and
+ * starts the head of the queue at once, by DMA when the handle has a channel
+ * for that direction and by interrupt otherwise. A transaction is never cut
+ * short: a sensor read submitted while the display streams waits for the
+ * running transfer only, then goes ahead of the display's next one. Nothing
+ * on the way blocks; the caller polls the descriptor or waits for the hook.
+ * The HAL's register calls (HAL_I2C_Mem_Read_DMA() and the like) poll the
+ * start, the address and the register address with tick timeouts before
+ * they hand over to the DMA, which would stall the completion interrupt and
+ * spin for good there if SCL stalls (the tick does not advance under it).
+ * A MEM operation is therefore sent as two sequential frames: the register
+ * address by interrupt without a stop, then from its completion the payload,
+ * after a repeated start for a read, by DMA or interrupt as above.
+ *
+ * A failed queued transaction is sent again up to its retries count, after
+ * a backoff of I2C_BUS_BACKOFF_US that doubles with each attempt; other
+ * transactions use the bus meanwhile. A NACK only costs the address byte:
+ * the HAL ends it with a stop condition right away. A bus error, lost
+ * arbitration, a transfer that outlives its expected duration or a bus
+ * still busy before a start means a slave may be holding SDA low:
+ * I2C_Bus_Recover() then releases the peripheral, clocks SCL by hand until
+ * SDA is free (at most 9 clocks, one byte and its acknowledge), sends a stop
+ * condition and initializes the peripheral again with the active profile.
+ * That takes about 150 us, against the 25 ms the HAL spends polling a stuck
+ * BUSY flag before it gives up. The pins are set with I2C_Bus_SetPins();
+ * without them only the peripheral is reset. A transfer that never ends
+ * (SCL stretched forever) raises no interrupt, I2C_Bus_Process() catches
+ * it, so keep calling that while transactions are pending.
+ *
+ * Neither the recovery nor the wait for a stop condition runs in the
+ * completion interrupt: it reads BUSY once, and when a recovery may be due
+ * or the line is still busy it keeps the bus claimed for I2C_Bus_Process(),
+ * which waits, recovers in thread context and then resends or starts the
+ * transaction. The blocking I2C_Bus_Transmit() does the same itself.
+ *
+ * Example usage:
+ * @code
+ *   I2C_Bus_HandleTypeDef hbus1;
+ *   I2C_Bus_Init(&hbus1, &hi2c1);
+ *   I2C_Bus_SetPins(&hbus1, GPIOB, GPIO_PIN_6, GPIOB, GPIO_PIN_7);
+ *   I2C_Bus_SetProfile(&hbus1, 0x44, &I2C_Bus_Fast);
+ *
+ *   static uint8_t raw[6];
+ *   static I2C_Bus_TransactionTypeDef sht3x = {
+ *       .addr = 0x44, .op = I2C_BUS_OP_MEM_READ, .priority = I2C_BUS_PRIORITY_SENSOR,
+ *       .memAddr = 0xE000, .memAddrSize = I2C_MEMADD_SIZE_16BIT, .pData = raw, .size = sizeof(raw),
+ *       .retries = I2C_BUS_RETRIES};
+ *   I2C_Bus_Submit(&hbus1, &sht3x);
+ *   ...
+ *   if (!sht3x.pending && sht3x.status == HAL_OK) { ... }
+ *
+ *   I2C_Bus_StatsTypeDef stats;
+ *   I2C_Bus_GetStats(&hbus1, LCD_ADDR, &stats);
+ *   uint16_t load = I2C_Bus_Utilisation(&hbus1); // Per mille
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _I2C_BUS_H_
+#define _I2C_BUS_H_
+
+#include "stm32f1xx_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/*                             I2C Bus Constants                              */
+/* -------------------------------------------------------------------------- */
+
+/* Devices with their own profile on one bus */
+#define I2C_BUS_MAX_DEVICES 4U
+
+/* Addresses with their own statistics; the rest share one record */
+#ifndef I2C_BUS_STATS_SLOTS
+#define I2C_BUS_STATS_SLOTS 4U
+#endif
+
+/* Queue priorities, lower runs first */
+#define I2C_BUS_PRIORITY_SENSOR 0U  /* Measurements with a deadline */
+#define I2C_BUS_PRIORITY_DEFAULT 1U /* Configuration, EEPROM */
+#define I2C_BUS_PRIORITY_DISPLAY 2U /* Screen updates, resent on the next redraw */
+
+/* Longest wait for the stop condition of the previous transfer before retiming */
+#define I2C_BUS_STOP_WAIT_US 50U
+
+/* Resends of a failed transaction, a sensible value for its retries field */
+#define I2C_BUS_RETRIES 3U
+
+/* Wait before the first resend, doubled for each further one */
+#define I2C_BUS_BACKOFF_US 250U
+
+/* Half period of the recovery clock; the timebase rounds down by up to 1 us,
+ * so SCL stays low for the 4.7 us Standard Mode needs */
+#define I2C_BUS_RECOVERY_HALF_US 6U
+
+/* Clocks that free a slave stuck anywhere in a byte and its acknowledge */
+#define I2C_BUS_RECOVERY_CLOCKS 9U
+
+/* Time a transfer may run past twice its duration on the wire before it is
+ * declared hung */
+#define I2C_BUS_HANG_MARGIN_US 1000U
+
+/* -------------------------------------------------------------------------- */
+/*                               I2C Bus Structs                              */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Kind of a queued transaction
+ */
+typedef enum
+{
+    I2C_BUS_OP_WRITE = 0x00U,     /*!< Send pData */
+    I2C_BUS_OP_READ = 0x01U,      /*!< Receive into pData */
+    I2C_BUS_OP_MEM_WRITE = 0x02U, /*!< Send the register address, then pData */
+    I2C_BUS_OP_MEM_READ = 0x03U   /*!< Send the register address, restart, receive into pData */
+} I2C_Bus_OpTypeDef;
+
+struct __I2C_Bus_TransactionTypeDef;
+
+/**
+ * @brief  Completion hook of a transaction, called from the I2C interrupt
+ */
+typedef void (*I2C_Bus_DoneFunc)(struct __I2C_Bus_TransactionTypeDef *xfer);
+
+/**
+ * @brief  Transaction descriptor, owned by the submitting driver
+ */
+typedef struct __I2C_Bus_TransactionTypeDef
+{
+    uint8_t addr;           /*!< 7-bit device address */
+    uint8_t op;             /*!< I2C_Bus_OpTypeDef */
+    uint8_t priority;       /*!< I2C_BUS_PRIORITY_xxx, lower runs first */
+    uint16_t memAddr;       /*!< Register address of the MEM operations */
+    uint16_t memAddrSize;   /*!< I2C_MEMADD_SIZE_8BIT or I2C_MEMADD_SIZE_16BIT */
+    uint8_t *pData;         /*!< Bytes to send or receive, kept until done */
+    uint16_t size;          /*!< Number of bytes */
+    I2C_Bus_DoneFunc done;  /*!< Completion hook, may be NULL */
+    void *ctx;              /*!< Owner's context for the hook */
+    uint8_t retries;        /*!< Resends after a NACK or bus error, 0 to fail at once */
+
+    volatile uint8_t pending;                  /*!< Queued or running */
+    volatile HAL_StatusTypeDef status;         /*!< Result once pending is clear */
+    uint32_t error;                            /*!< HAL_I2C_GetError() of a failed transfer */
+    uint8_t attempt;                           /*!< Failed attempts so far */
+    uint16_t backoffUs;                        /*!< Wait before the next attempt, 0 if none */
+    uint16_t backoffStart;                     /*!< Timebase_Now_us() when the wait began */
+    uint32_t backoffTick;                      /*!< HAL_GetTick() when the wait began */
+    struct __I2C_Bus_TransactionTypeDef *next; /*!< Queue link */
+} I2C_Bus_TransactionTypeDef;
+
+/**
+ * @brief  SCL timing of a bus profile
+ */
+typedef struct
+{
+    uint32_t ClockSpeed; /*!< SCL frequency in Hz, up to 400000 */
+    uint32_t DutyCycle;  /*!< Fast Mode duty cycle, I2C_DUTYCYCLE_2 or I2C_DUTYCYCLE_16_9 */
+} I2C_Bus_ProfileTypeDef;
+
+/**
+ * @brief  Transaction statistics of one device address
+ */
+typedef struct
+{
+    uint32_t transactions; /*!< Transfers that completed or failed */
+    uint32_t bytes;        /*!< Payload bytes of the transfers that completed */
+    uint32_t nacks;        /*!< Transfers ended by an acknowledge failure */
+    uint32_t timeouts;     /*!< Transfers ended by the HAL timeout */
+    uint32_t errors;       /*!< Transfers ended by any other error */
+    uint32_t busyWaits;    /*!< Starts refused because a transfer was in progress */
+    uint32_t retries;      /*!< Failed transfers scheduled to be sent again */
+    uint32_t latencyMin;   /*!< Shortest start-to-completion time in us */
+    uint32_t latencyMax;   /*!< Longest start-to-completion time in us */
+    uint32_t latencyLast;  /*!< Latest start-to-completion time in us */
+    uint32_t busyTime;     /*!< Sum of the start-to-completion times in us */
+} I2C_Bus_StatsTypeDef;
+
+/**
+ * @brief  I2C bus handle structure definition
+ */
+typedef struct
+{
+    I2C_HandleTypeDef *hi2c;                             /*!< Pointer to I2C handler */
+    I2C_Bus_ProfileTypeDef defaultProfile;               /*!< Profile for unregistered addresses */
+    I2C_Bus_ProfileTypeDef active;                       /*!< Profile the peripheral runs now */
+    uint8_t deviceCount;                                 /*!< Registered devices */
+    uint8_t deviceAddr[I2C_BUS_MAX_DEVICES];             /*!< 7-bit device addresses */
+    I2C_Bus_ProfileTypeDef profile[I2C_BUS_MAX_DEVICES]; /*!< Profile of each device */
+
+    uint8_t statsCount;                              /*!< Addresses with their own statistics */
+    uint8_t statsAddr[I2C_BUS_STATS_SLOTS];          /*!< 7-bit addresses of the records */
+    I2C_Bus_StatsTypeDef stats[I2C_BUS_STATS_SLOTS]; /*!< Statistics of each address */
+    I2C_Bus_StatsTypeDef otherStats;                 /*!< Addresses beyond the slots */
+    uint32_t statsTick;                              /*!< HAL tick of the last reset */
+    uint32_t recoveries;                             /*!< Bus recoveries since the last reset */
+
+    GPIO_TypeDef *sclPort; /*!< SCL pin for bus recovery, NULL if not set */
+    uint16_t sclPin;       /*!< GPIO_PIN_x of SCL */
+    GPIO_TypeDef *sdaPort; /*!< SDA pin for bus recovery */
+    uint16_t sdaPin;       /*!< GPIO_PIN_x of SDA */
+
+    I2C_Bus_TransactionTypeDef *volatile queue;   /*!< Waiting transactions, by priority */
+    I2C_Bus_TransactionTypeDef *volatile current; /*!< Running interrupt or DMA transfer */
+    I2C_Bus_TransactionTypeDef direct;            /*!< Descriptor of the I2C_Bus_Transmit_IT/_DMA calls */
+    uint16_t xferStart;                           /*!< Timebase_Now_us() when current started */
+    uint32_t xferTick;                            /*!< HAL_GetTick() when current started */
+    uint32_t xferBudget;                          /*!< Microseconds current may run before it is hung */
+    volatile uint8_t hung;                        /*!< Set while I2C_Bus_Process() aborts current */
+    uint8_t memAddr[2];                           /*!< Register address frame of a MEM operation */
+    volatile uint8_t memPhase;                    /*!< Set while that frame is on the wire */
+    volatile uint8_t needsRecovery;               /*!< Set while the bus waits for I2C_Bus_Process() */
+    HAL_StatusTypeDef recoverStatus;              /*!< End of current meanwhile, HAL_OK if not started */
+    uint32_t recoverError;                        /*!< HAL_I2C_ERROR_x of that end */
+} I2C_Bus_HandleTypeDef;
+
+/* Standard Mode, 100 kHz */
+extern const I2C_Bus_ProfileTypeDef I2C_Bus_Standard;
+
+/* Fast Mode, 400 kHz */
+extern const I2C_Bus_ProfileTypeDef I2C_Bus_Fast;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Initialize the bus layer over an initialized I2C handle. Its
+ *         current timing becomes the default profile.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  hi2c: Pointer to I2C handle (e.g. &hi2c1).
+ * @retval HAL status
+ */
+HAL_StatusTypeDef I2C_Bus_Init(I2C_Bus_HandleTypeDef *hbus, I2C_HandleTypeDef *hi2c);
+
+/**
+ * @brief  Give the bus layer the SCL and SDA pins, so that recovery can clock
+ *         a stuck slave free. They are GPIO outputs only while recovering.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  sclPort: GPIO port of SCL (e.g. GPIOB).
+ * @param  sclPin: GPIO_PIN_x of SCL.
+ * @param  sdaPort: GPIO port of SDA.
+ * @param  sdaPin: GPIO_PIN_x of SDA.
+ * @retval None
+ */
+void I2C_Bus_SetPins(I2C_Bus_HandleTypeDef *hbus, GPIO_TypeDef *sclPort, uint16_t sclPin, GPIO_TypeDef *sdaPort,
+                     uint16_t sdaPin);
+
+/**
+ * @brief  Assign a profile to a device address, replacing a previous one.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  addr: 7-bit device address.
+ * @param  profile: Profile used for every transaction with this device.
+ * @retval HAL_ERROR if the profile is invalid or the table is full.
+ */
+HAL_StatusTypeDef I2C_Bus_SetProfile(I2C_Bus_HandleTypeDef *hbus, uint8_t addr, const I2C_Bus_ProfileTypeDef *profile);
+
+/**
+ * @brief  Retime the bus for the next transaction with a device.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  addr: 7-bit device address.
+ * @retval HAL_OK when the bus runs the device's profile, HAL_BUSY if a
+ *         transfer is in progress and the profile could not be changed.
+ */
+HAL_StatusTypeDef I2C_Bus_Select(I2C_Bus_HandleTypeDef *hbus, uint8_t addr);
+
+/**
+ * @brief  Program a profile into the peripheral. The bus must be idle.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  profile: Profile to apply.
+ * @retval HAL_OK, HAL_BUSY if a transfer is in progress, HAL_ERROR if the
+ *         profile is invalid for the current PCLK1.
+ */
+HAL_StatusTypeDef I2C_Bus_Apply(I2C_Bus_HandleTypeDef *hbus, const I2C_Bus_ProfileTypeDef *profile);
+
+/**
+ * @brief  Free a stuck bus: de-initialize the peripheral, clock SCL until
+ *         SDA is released, send a stop condition and initialize the
+ *         peripheral again with the active profile. I2C_Bus_Process() runs
+ *         it by itself after bus errors. It takes ~150 us: thread context
+ *         only, with no transfer in progress.
+ * @param  hbus: Pointer to bus handle structure.
+ * @retval HAL_OK, HAL_ERROR if a line is still held low or the peripheral
+ *         did not initialize.
+ */
+HAL_StatusTypeDef I2C_Bus_Recover(I2C_Bus_HandleTypeDef *hbus);
+
+/**
+ * @brief  Blocking write to a device, with its profile and statistics.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  addr: 7-bit device address.
+ * @param  pData: Bytes to send.
+ * @param  Size: Number of bytes.
+ * @param  Timeout: HAL timeout in milliseconds. A bus error or timeout
+ *         recovers the bus, the write is not repeated.
+ * @retval HAL status of the transfer
+ */
+HAL_StatusTypeDef I2C_Bus_Transmit(I2C_Bus_HandleTypeDef *hbus, uint8_t addr, uint8_t *pData, uint16_t Size,
+                                   uint32_t Timeout);
+
+/**
+ * @brief  Start an interrupt-driven write to a device.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  addr: 7-bit device address.
+ * @param  pData: Bytes to send, valid until completion.
+ * @param  Size: Number of bytes.
+ * @retval HAL_OK if started, HAL_BUSY if the bus is in use.
+ */
+HAL_StatusTypeDef I2C_Bus_Transmit_IT(I2C_Bus_HandleTypeDef *hbus, uint8_t addr, uint8_t *pData, uint16_t Size);
+
+/**
+ * @brief  Start a DMA write to a device.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  addr: 7-bit device address.
+ * @param  pData: Bytes to send, valid until completion.
+ * @param  Size: Number of bytes.
+ * @retval HAL_OK if started, HAL_BUSY if the bus is in use.
+ */
+HAL_StatusTypeDef I2C_Bus_Transmit_DMA(I2C_Bus_HandleTypeDef *hbus, uint8_t addr, uint8_t *pData, uint16_t Size);
+
+/**
+ * @brief  Queue a transaction. It runs when the bus is free and no
+ *         transaction of a higher priority is waiting.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  xfer: Descriptor to run, untouched by the caller until pending
+ *         clears. Its status is HAL_OK or HAL_ERROR then, after up to
+ *         retries resends.
+ * @retval HAL_OK if queued, HAL_BUSY if it is still pending, HAL_ERROR if
+ *         it is incomplete.
+ */
+HAL_StatusTypeDef I2C_Bus_Submit(I2C_Bus_HandleTypeDef *hbus, I2C_Bus_TransactionTypeDef *xfer);
+
+/**
+ * @brief  Start the head of the queue if the bus is free. Completions do this
+ *         themselves; call it from the main loop to resume a queue whose
+ *         start found the peripheral taken by a blocking transfer, to start
+ *         resends whose backoff ran out, to abort a hung transfer and to run
+ *         the stop waits and bus recoveries the interrupts left. Never call
+ *         it from an interrupt.
+ * @param  hbus: Pointer to bus handle structure.
+ * @retval None
+ */
+void I2C_Bus_Process(I2C_Bus_HandleTypeDef *hbus);
+
+/**
+ * @brief  Statistics of one device address since the last reset.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  addr: 7-bit device address.
+ * @param  stats: Receives a consistent copy.
+ * @retval HAL_ERROR if the address has no transfer on record.
+ */
+HAL_StatusTypeDef I2C_Bus_GetStats(I2C_Bus_HandleTypeDef *hbus, uint8_t addr, I2C_Bus_StatsTypeDef *stats);
+
+/**
+ * @brief  Statistics of every address added together.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  stats: Receives the totals.
+ * @retval None
+ */
+void I2C_Bus_GetTotals(I2C_Bus_HandleTypeDef *hbus, I2C_Bus_StatsTypeDef *stats);
+
+/**
+ * @brief  Share of the time since the last reset that transfers were running.
+ * @param  hbus: Pointer to bus handle structure.
+ * @retval Utilisation in per mille
+ */
+uint16_t I2C_Bus_Utilisation(I2C_Bus_HandleTypeDef *hbus);
+
+/**
+ * @brief  Clear the statistics and start a new measurement period.
+ * @param  hbus: Pointer to bus handle structure.
+ * @retval None
+ */
+void I2C_Bus_ResetStats(I2C_Bus_HandleTypeDef *hbus);
+
+/**
+ * @brief  Finish a transfer and start the next one. Call from HAL_I2C_MasterTxCpltCallback.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  hi2c: I2C handle of the callback.
+ * @retval None
+ */
+void I2C_Bus_MasterTxCpltCallback(I2C_Bus_HandleTypeDef *hbus, I2C_HandleTypeDef *hi2c);
+
+/**
+ * @brief  Finish a transfer and start the next one. Call from HAL_I2C_MasterRxCpltCallback.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  hi2c: I2C handle of the callback.
+ * @retval None
+ */
+void I2C_Bus_MasterRxCpltCallback(I2C_Bus_HandleTypeDef *hbus, I2C_HandleTypeDef *hi2c);
+
+/**
+ * @brief  Finish a transfer and start the next one. Call from HAL_I2C_MemTxCpltCallback.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  hi2c: I2C handle of the callback.
+ * @retval None
+ */
+void I2C_Bus_MemTxCpltCallback(I2C_Bus_HandleTypeDef *hbus, I2C_HandleTypeDef *hi2c);
+
+/**
+ * @brief  Finish a transfer and start the next one. Call from HAL_I2C_MemRxCpltCallback.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  hi2c: I2C handle of the callback.
+ * @retval None
+ */
+void I2C_Bus_MemRxCpltCallback(I2C_Bus_HandleTypeDef *hbus, I2C_HandleTypeDef *hi2c);
+
+/**
+ * @brief  Fail a transfer and start the next one. Call from HAL_I2C_ErrorCallback.
+ * @param  hbus: Pointer to bus handle structure.
+ * @param  hi2c: I2C handle of the callback.
+ * @retval None
+ */
+void I2C_Bus_ErrorCallback(I2C_Bus_HandleTypeDef *hbus, I2C_HandleTypeDef *hi2c);
+
+#endif /* _I2C_BUS_H_ */
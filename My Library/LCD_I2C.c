@@ -1,23 +1,300 @@
 #include "LCD_I2C.h"
+#include "Profiler.h"
+#include "Timebase.h"
 #include <string.h>
 
-/* Function send 4-bit data */
-static void LCD_Send4Bits(LCD_HandleTypeDef *LCDx, uint8_t data, uint8_t mode)
+#define LCD_TX_MASK (LCD_TX_BUFFER_SIZE - 1U)
+#define LCD_HOLD_MASK (LCD_HOLD_DEPTH - 1U)
+
+#if (LCD_TX_BUFFER_SIZE & LCD_TX_MASK) != 0U
+#error "LCD_TX_BUFFER_SIZE must be a power of two"
+#endif
+#if (LCD_HOLD_DEPTH & LCD_HOLD_MASK) != 0U
+#error "LCD_HOLD_DEPTH must be a power of two"
+#endif
+
+/* Hold the queue for us, counted from now */
+static void LCD_HoldStart(LCD_HandleTypeDef *LCDx, uint16_t us)
+{
+    LCDx->holdStart = Timebase_Now_us();
+    LCDx->holdTick = HAL_GetTick();
+    LCDx->holdUs = us;
+    LCDx->holdActive = 1;
+}
+
+/* The millisecond tick catches holds that outlived the 16-bit microsecond counter */
+static uint8_t LCD_HoldExpired(LCD_HandleTypeDef *LCDx)
+{
+    return (Timebase_Elapsed_us(LCDx->holdStart) >= LCDx->holdUs) ||
+           ((HAL_GetTick() - LCDx->holdTick) > (LCDx->holdUs / 1000U) + 1U);
+}
+
+/* Bytes waiting in the queue, including the running transfer */
+static inline uint16_t LCD_TxUsed(LCD_HandleTypeDef *LCDx)
+{
+    return (uint16_t)((LCDx->txHead - LCDx->txTail) & LCD_TX_MASK);
+}
+
+/* Queued bytes from the tail up to the head, the end of the buffer or the
+ * next hold, whichever comes first */
+static uint16_t LCD_TxChunk(LCD_HandleTypeDef *LCDx)
+{
+    uint16_t tail = LCDx->txTail;
+    uint16_t head = LCDx->txHead;
+    uint16_t len = (head > tail) ? (uint16_t)(head - tail) : (uint16_t)(LCD_TX_BUFFER_SIZE - tail);
+
+    if (LCDx->holdIn != LCDx->holdOut)
+    {
+        uint16_t to_hold = (uint16_t)((LCDx->holds[LCDx->holdOut & LCD_HOLD_MASK].pos - tail) & LCD_TX_MASK);
+        if (to_hold != 0U && to_hold < len)
+        {
+            len = to_hold;
+        }
+    }
+    if (LCDx->bus != NULL && len > LCD_BUS_CHUNK_MAX)
+    {
+        len = LCD_BUS_CHUNK_MAX;
+    }
+    return len;
+}
+
+/* Release the chunk owned by the running transfer, and start the hold of the
+ * command it ended with */
+static void LCD_TxRelease(LCD_HandleTypeDef *LCDx)
+{
+    LCDx->txTail = (uint16_t)((LCDx->txTail + LCDx->txLen) & LCD_TX_MASK);
+    LCDx->txLen = 0;
+
+    if (LCDx->holdIn != LCDx->holdOut)
+    {
+        LCD_HoldTypeDef *hold = &LCDx->holds[LCDx->holdOut & LCD_HOLD_MASK];
+        if (hold->pos == LCDx->txTail)
+        {
+            LCD_HoldStart(LCDx, hold->us);
+            LCDx->holdOut++;
+        }
+    }
+}
+
+/* Timeout of a blocking chunk: its time on the wire, 9 clocks a byte with
+ * the address, plus two ticks. A fixed 100 ms let a dead expander stall the
+ * caller for that long on every chunk */
+static uint32_t LCD_TxTimeout(LCD_HandleTypeDef *LCDx, uint16_t len)
+{
+    return ((uint32_t)(len + 1U) * 9U * 1000U) / LCDx->lcd_hi2c->Init.ClockSpeed + 2U;
+}
+
+/* Start sending the oldest contiguous run of queued bytes, if the bus is ours */
+static void LCD_TxKick(LCD_HandleTypeDef *LCDx)
+{
+    I2C_HandleTypeDef *hi2c = LCDx->lcd_hi2c;
+
+    if (LCDx->bus == NULL && hi2c->hdmatx == NULL)
+    {
+        // No DMA channel linked: drain synchronously, waiting out the holds
+        while (LCDx->txHead != LCDx->txTail)
+        {
+            while (LCDx->holdActive && !LCD_HoldExpired(LCDx))
+                ;
+            LCDx->holdActive = 0;
+            LCDx->txLen = LCD_TxChunk(LCDx);
+            HAL_I2C_Master_Transmit(hi2c, LCDx->lcd_addr << 1, &LCDx->txBuf[LCDx->txTail], LCDx->txLen,
+                                    LCD_TxTimeout(LCDx, LCDx->txLen));
+            LCD_TxRelease(LCDx);
+        }
+        return;
+    }
+
+    // Claim the transfer with interrupts masked, the completion hook also kicks
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (LCDx->txLen != 0 || LCDx->txHead == LCDx->txTail)
+    {
+        __set_PRIMASK(primask);
+        return;
+    }
+    if (LCDx->holdActive)
+    {
+        if (!LCD_HoldExpired(LCDx))
+        {
+            // The LCD is still executing, LCD_Process() retries later
+            __set_PRIMASK(primask);
+            return;
+        }
+        LCDx->holdActive = 0;
+    }
+    uint16_t tail = LCDx->txTail;
+    LCDx->txLen = LCD_TxChunk(LCDx);
+    __set_PRIMASK(primask);
+
+    HAL_StatusTypeDef status;
+    if (LCDx->bus != NULL)
+    {
+        // Waits behind more urgent traffic, LCD_BusDone() releases the chunk
+        LCDx->xfer.pData = &LCDx->txBuf[tail];
+        LCDx->xfer.size = LCDx->txLen;
+        status = I2C_Bus_Submit(LCDx->bus, &LCDx->xfer);
+    }
+    else
+    {
+        status = HAL_I2C_Master_Transmit_DMA(hi2c, LCDx->lcd_addr << 1, &LCDx->txBuf[tail], LCDx->txLen);
+    }
+
+    if (status != HAL_OK)
+    {
+        // Bus busy or in error: give the claim back, the next write retries
+        LCDx->txLen = 0;
+    }
+}
+
+/* Reserve len contiguous bytes at the head of the queue, waiting for room.
+ * A run that would wrap is moved to the start of the buffer and the gap is
+ * filled with EN-low frames, which the LCD ignores, so a run always leaves in
+ * one transfer. Returns the start index, or LCD_TX_BUFFER_SIZE on timeout. */
+static uint16_t LCD_TxReserve(LCD_HandleTypeDef *LCDx, uint16_t len)
+{
+    // An idle queue restarts at the front, no padding needed
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (LCDx->txLen == 0 && LCDx->txHead == LCDx->txTail)
+    {
+        LCDx->txHead = 0;
+        LCDx->txTail = 0;
+    }
+    __set_PRIMASK(primask);
+
+    uint16_t head = LCDx->txHead;
+    uint16_t pad = (LCD_TX_BUFFER_SIZE - head < len) ? (uint16_t)(LCD_TX_BUFFER_SIZE - head) : 0U;
+    uint32_t tickstart = HAL_GetTick();
+
+    while ((LCD_TX_BUFFER_SIZE - 1U) - LCD_TxUsed(LCDx) < (uint16_t)(len + pad))
+    {
+        LCD_Process(LCDx);
+        if ((HAL_GetTick() - tickstart) > LCD_TX_TIMEOUT_MS)
+        {
+            return LCD_TX_BUFFER_SIZE; // Transport stuck, drop the run rather than hang
+        }
+    }
+
+    if (pad != 0U)
+    {
+        memset(&LCDx->txBuf[head], LCDx->backlight, pad);
+        head = 0;
+    }
+    return head;
+}
+
+/* Publish a run written at start, the pad before it goes out with it */
+static void LCD_TxCommit(LCD_HandleTypeDef *LCDx, uint16_t start, uint16_t len)
+{
+    LCDx->txHead = (uint16_t)((start + len) & LCD_TX_MASK);
+    LCD_TxKick(LCDx);
+}
+
+/* Encode one byte as high and low nibble frames, each strobed with EN */
+static uint8_t *LCD_Encode(LCD_HandleTypeDef *LCDx, uint8_t *dst, uint8_t data, uint8_t mode)
 {
     uint8_t high_nibble = mode | (data & 0xF0) | LCDx->backlight;
     uint8_t low_nibble = mode | ((data << 4) & 0xF0) | LCDx->backlight;
 
-    uint8_t data_tx[4];
-
     // Send high nibble
-    data_tx[0] = high_nibble | LCD_EN_SET;  // EN = 1
-    data_tx[1] = high_nibble & ~LCD_EN_SET; // EN = 0
+    *dst++ = high_nibble | LCD_EN_SET;  // EN = 1
+    *dst++ = high_nibble & ~LCD_EN_SET; // EN = 0
 
     // Send low nibble
-    data_tx[2] = low_nibble | LCD_EN_SET;  // EN = 1
-    data_tx[3] = low_nibble & ~LCD_EN_SET; // EN = 0
+    *dst++ = low_nibble | LCD_EN_SET;  // EN = 1
+    *dst++ = low_nibble & ~LCD_EN_SET; // EN = 0
+
+    return dst;
+}
 
-    HAL_I2C_Master_Transmit(LCDx->lcd_hi2c, LCDx->lcd_addr << 1, data_tx, 4, 100);
+/* Function send 4-bit data */
+static void LCD_Send4Bits(LCD_HandleTypeDef *LCDx, uint8_t data, uint8_t mode)
+{
+    PROFILER_SCOPE("LCD_Send4Bits");
+    uint16_t start = LCD_TxReserve(LCDx, LCD_FRAME_BYTES);
+    if (start == LCD_TX_BUFFER_SIZE)
+    {
+        return;
+    }
+    LCD_Encode(LCDx, &LCDx->txBuf[start], data, mode);
+    LCD_TxCommit(LCDx, start, LCD_FRAME_BYTES);
+}
+
+/* Queue characters, optionally preceded by a DDRAM address command, as runs
+ * of at most LCD_RUN_MAX_CHARS that each go out in a single I2C transfer */
+static void LCD_SendRun(LCD_HandleTypeDef *LCDx, uint8_t set_addr, uint8_t addr, const char *str, uint16_t len)
+{
+    if (!set_addr && len == 0)
+    {
+        return;
+    }
+
+    do
+    {
+        uint16_t n = (len > LCD_RUN_MAX_CHARS) ? LCD_RUN_MAX_CHARS : len;
+        uint16_t bytes = (uint16_t)((n + set_addr) * LCD_FRAME_BYTES);
+        uint16_t start = LCD_TxReserve(LCDx, bytes);
+        if (start == LCD_TX_BUFFER_SIZE)
+        {
+            return;
+        }
+
+        uint8_t *dst = &LCDx->txBuf[start];
+        if (set_addr)
+        {
+            dst = LCD_Encode(LCDx, dst, LCD_SET_DDRAM_ADDR | addr, RS_COMMAND);
+        }
+        for (uint16_t i = 0; i < n; i++)
+        {
+            dst = LCD_Encode(LCDx, dst, (uint8_t)str[i], RS_DATA);
+        }
+        LCD_TxCommit(LCDx, start, bytes);
+
+        set_addr = 0;
+        str += n;
+        len -= n;
+    } while (len > 0);
+}
+
+/* DDRAM address of a cell */
+static uint8_t LCD_Address(uint8_t col, uint8_t row)
+{
+    static const uint8_t row_offsets[] = {0x00, 0x40, 0x14, 0x54};
+    if (row > 3)
+        row = 3;
+    return (uint8_t)(col + row_offsets[row]);
+}
+
+/* Queue a command the LCD needs hold_us to execute; nothing after it is sent
+ * before the time has passed */
+static void LCD_Send4BitsHold(LCD_HandleTypeDef *LCDx, uint8_t data, uint8_t mode, uint16_t hold_us)
+{
+    uint32_t tickstart = HAL_GetTick();
+
+    while ((uint8_t)(LCDx->holdIn - LCDx->holdOut) >= LCD_HOLD_DEPTH)
+    {
+        LCD_Process(LCDx);
+        if ((HAL_GetTick() - tickstart) > LCD_TX_TIMEOUT_MS)
+        {
+            return;
+        }
+    }
+
+    uint16_t start = LCD_TxReserve(LCDx, LCD_FRAME_BYTES);
+    if (start == LCD_TX_BUFFER_SIZE)
+    {
+        return;
+    }
+    LCD_Encode(LCDx, &LCDx->txBuf[start], data, mode);
+
+    // Publish the hold before the bytes so the chunk cannot run past it
+    LCD_HoldTypeDef *hold = &LCDx->holds[LCDx->holdIn & LCD_HOLD_MASK];
+    hold->pos = (uint16_t)((start + LCD_FRAME_BYTES) & LCD_TX_MASK);
+    hold->us = hold_us;
+    LCDx->holdIn++;
+
+    LCD_TxCommit(LCDx, start, LCD_FRAME_BYTES);
 }
 
 /* Function send command */
@@ -36,17 +313,24 @@ void LCD_Init(LCD_HandleTypeDef *LCDx, I2C_HandleTypeDef *hi2c, uint8_t addr)
 {
     LCDx->lcd_hi2c = hi2c;
     LCDx->lcd_addr = addr;
+    LCDx->bus = NULL;
     LCDx->backlight = LCD_BACKLIGHT;
     LCDx->displaycontrol = LCD_DISPLAY_ON | LCD_CURSOR_OFF | LCD_BLINK_OFF;
     LCDx->displaymode = LCD_ENTRY_LEFT | LCD_ENTRY_SHIFT_DECREMENT;
+    LCDx->txHead = 0;
+    LCDx->txTail = 0;
+    LCDx->txLen = 0;
+    LCDx->holdIn = 0;
+    LCDx->holdOut = 0;
+    LCDx->xfer.pending = 0;
+    LCDx->scrolling = 0;
 
-    HAL_Delay(50); // Wait for LCD to power up
+    // Nothing leaves the queue until the LCD has powered up
+    LCD_HoldStart(LCDx, LCD_POWERUP_DELAY_US);
 
-    // Initialization sequence
-    LCD_Send4Bits(LCDx, 0x33, RS_COMMAND); // Initialize to 8-bit mode
-    HAL_Delay(5);
-    LCD_Send4Bits(LCDx, 0x32, RS_COMMAND); // Switch to 4-bit mode
-    HAL_Delay(5);
+    // Initialization sequence, sent from LCD_Process() as the holds expire
+    LCD_Send4BitsHold(LCDx, 0x33, RS_COMMAND, LCD_INIT_DELAY_US); // Initialize to 8-bit mode
+    LCD_Send4BitsHold(LCDx, 0x32, RS_COMMAND, LCD_INIT_DELAY_US); // Switch to 4-bit mode
 
     // Configure LCD
     LCD_SendCommand(LCDx, LCD_FUNCTION_SET | LCD_4BIT_MODE | LCD_2LINE | LCD_5x8_DOTS);
@@ -57,24 +341,44 @@ void LCD_Init(LCD_HandleTypeDef *LCDx, I2C_HandleTypeDef *hi2c, uint8_t addr)
     LCD_Home(LCDx);
 }
 
+/* Bus queue completion of a chunk, successful or not */
+static void LCD_BusDone(I2C_Bus_TransactionTypeDef *xfer)
+{
+    LCD_HandleTypeDef *LCDx = (LCD_HandleTypeDef *)xfer->ctx;
+
+    // A chunk that failed every attempt is dropped like in LCD_I2C_ErrorCallback()
+    LCD_TxRelease(LCDx);
+    LCD_TxKick(LCDx);
+}
+
+void LCD_SetBus(LCD_HandleTypeDef *LCDx, I2C_Bus_HandleTypeDef *hbus)
+{
+    LCDx->xfer.addr = LCDx->lcd_addr;
+    LCDx->xfer.op = I2C_BUS_OP_WRITE;
+    LCDx->xfer.priority = I2C_BUS_PRIORITY_DISPLAY;
+    LCDx->xfer.done = LCD_BusDone;
+    LCDx->xfer.ctx = LCDx;
+    // The PCF8574 acknowledges every data byte: a NACK is on the address and
+    // nothing was latched, so the chunk is safe to send again
+    LCDx->xfer.retries = I2C_BUS_RETRIES;
+    LCDx->bus = hbus;
+}
+
 void LCD_Clear_Display(LCD_HandleTypeDef *LCDx)
 {
-    LCD_SendCommand(LCDx, LCD_CLEAR_DISPLAY);
-    HAL_Delay(2); // Clear display needs delay
+    LCD_Send4BitsHold(LCDx, LCD_CLEAR_DISPLAY, RS_COMMAND, LCD_CLEAR_DELAY_US);
+    memset(LCDx->frame, ' ', sizeof(LCDx->frame));
+    memset(LCDx->shadow, ' ', sizeof(LCDx->shadow));
 }
 
 void LCD_Home(LCD_HandleTypeDef *LCDx)
 {
-    LCD_SendCommand(LCDx, LCD_RETURN_HOME);
-    HAL_Delay(2); // Return home needs delay
+    LCD_Send4BitsHold(LCDx, LCD_RETURN_HOME, RS_COMMAND, LCD_CLEAR_DELAY_US);
 }
 
 void LCD_SetCursor(LCD_HandleTypeDef *LCDx, uint8_t col, uint8_t row)
 {
-    uint8_t row_offsets[] = {0x00, 0x40, 0x14, 0x54};
-    if (row > 3)
-        row = 3;
-    LCD_SendCommand(LCDx, LCD_SET_DDRAM_ADDR | (col + row_offsets[row]));
+    LCD_SendCommand(LCDx, LCD_SET_DDRAM_ADDR | LCD_Address(col, row));
 }
 
 void LCD_NoDisplay(LCD_HandleTypeDef *LCDx)
@@ -129,10 +433,12 @@ void LCD_NoBacklight(LCD_HandleTypeDef *LCDx)
 
 void LCD_Print(LCD_HandleTypeDef *LCDx, char *str)
 {
-    while (*str)
-    {
-        LCD_PrintChar(LCDx, *str++);
-    }
+    LCD_SendRun(LCDx, 0, 0, str, (uint16_t)strlen(str));
+}
+
+void LCD_PrintAt(LCD_HandleTypeDef *LCDx, uint8_t col, uint8_t row, char *str)
+{
+    LCD_SendRun(LCDx, 1, LCD_Address(col, row), str, (uint16_t)strlen(str));
 }
 
 void LCD_PrintChar(LCD_HandleTypeDef *LCDx, char ch)
@@ -192,4 +498,275 @@ void LCD_ScrollText(LCD_HandleTypeDef *LCDx, uint8_t row, char *message, uint16_
         LCD_Print(LCDx, buf);
         HAL_Delay(delay_ms);
     }
-}
\ No newline at end of file
+}
+
+/* Show the window starting at the scroller position through the framebuffer */
+static void LCD_Scroller_Draw(LCD_ScrollerTypeDef *scroller)
+{
+    LCD_HandleTypeDef *LCDx = scroller->lcd;
+    uint8_t n = scroller->len - scroller->pos;
+
+    if (n > LCD_COLS)
+        n = LCD_COLS;
+    memcpy(LCDx->frame[scroller->row], &scroller->message[scroller->pos], n);
+    memset(&LCDx->frame[scroller->row][n], ' ', LCD_COLS - n);
+    LCD_Flush(LCDx);
+}
+
+HAL_StatusTypeDef LCD_Scroller_Init(LCD_ScrollerTypeDef *scroller, LCD_HandleTypeDef *LCDx, uint8_t row,
+                                    const char *message, uint16_t period_ms, uint8_t hardware)
+{
+    size_t len = strlen(message);
+
+    if (row >= LCD_ROWS || len > 0xFFU)
+    {
+        return HAL_ERROR;
+    }
+
+    scroller->lcd = LCDx;
+    scroller->message = message;
+    scroller->len = (uint8_t)len;
+    scroller->row = row;
+    scroller->pos = 0;
+    scroller->hardware = (hardware && len <= LCD_DDRAM_LINE) ? 1U : 0U;
+    scroller->period_ms = period_ms;
+    scroller->lastTick = HAL_GetTick();
+    scroller->stepPending = 0;
+
+    if (scroller->hardware)
+    {
+        // Load the whole DDRAM line once, the blank tail scrolls in after the text
+        char line[LCD_DDRAM_LINE + 1];
+        memcpy(line, message, len);
+        memset(&line[len], ' ', LCD_DDRAM_LINE - len);
+        line[LCD_DDRAM_LINE] = '\0';
+
+        LCD_Home(LCDx); // Undo any previous shift
+        LCD_PrintAt(LCDx, 0, row, line);
+        memcpy(LCDx->frame[row], line, LCD_COLS);
+        memcpy(LCDx->shadow[row], line, LCD_COLS);
+        LCDx->scrolling = 1;
+    }
+    else
+    {
+        LCD_Scroller_Draw(scroller);
+    }
+    return HAL_OK;
+}
+
+void LCD_Scroller_Step(LCD_ScrollerTypeDef *scroller)
+{
+    if (scroller->len <= LCD_COLS)
+    {
+        return; // Fits on the row, nothing to scroll
+    }
+
+    if (scroller->pos >= scroller->len - LCD_COLS)
+    {
+        scroller->pos = 0;
+        if (scroller->hardware)
+        {
+            LCD_Home(scroller->lcd); // Resets the shift, held 1.52 ms in the queue
+            return;
+        }
+    }
+    else
+    {
+        scroller->pos++;
+        if (scroller->hardware)
+        {
+            LCD_SendCommand(scroller->lcd, LCD_CURSOR_SHIFT | LCD_DISPLAY_MOVE | LCD_MOVE_LEFT);
+            return;
+        }
+    }
+    LCD_Scroller_Draw(scroller);
+}
+
+void LCD_Scroller_Request(LCD_ScrollerTypeDef *scroller)
+{
+    // Nothing else here: the queue and the framebuffer belong to the main loop
+    scroller->stepPending = 1;
+}
+
+uint8_t LCD_Scroller_Tick(LCD_ScrollerTypeDef *scroller)
+{
+    uint32_t now = HAL_GetTick();
+    uint8_t due = (scroller->period_ms != 0U) && ((now - scroller->lastTick) >= scroller->period_ms);
+
+    if (!due && !scroller->stepPending)
+    {
+        return 0;
+    }
+    scroller->stepPending = 0;
+    scroller->lastTick = now;
+    LCD_Scroller_Step(scroller);
+    return 1;
+}
+
+void LCD_Scroller_Stop(LCD_ScrollerTypeDef *scroller)
+{
+    if (scroller->hardware)
+    {
+        if (scroller->pos != 0)
+        {
+            LCD_Home(scroller->lcd);
+        }
+        scroller->lcd->scrolling = 0;
+    }
+    scroller->len = 0;
+    scroller->stepPending = 0;
+    LCD_Invalidate(scroller->lcd);
+}
+
+uint8_t LCD_IsIdle(LCD_HandleTypeDef *LCDx)
+{
+    return (LCDx->txHead == LCDx->txTail) ? 1U : 0U;
+}
+
+HAL_StatusTypeDef LCD_WaitIdle(LCD_HandleTypeDef *LCDx)
+{
+    uint32_t tickstart = HAL_GetTick();
+
+    while (!LCD_IsIdle(LCDx))
+    {
+        // Through the bus too: a chunk backing off after a NACK restarts there
+        LCD_Process(LCDx);
+        if ((HAL_GetTick() - tickstart) > LCD_TX_TIMEOUT_MS)
+        {
+            // Leave the running chunk to its callback, drop the rest
+            uint32_t primask = __get_PRIMASK();
+            __disable_irq();
+            LCDx->txHead = (uint16_t)((LCDx->txTail + LCDx->txLen) & LCD_TX_MASK);
+            LCDx->holdOut = LCDx->holdIn;
+            __set_PRIMASK(primask);
+            return HAL_TIMEOUT;
+        }
+    }
+    return HAL_OK;
+}
+
+uint32_t LCD_Benchmark(LCD_HandleTypeDef *LCDx)
+{
+    if (LCD_WaitIdle(LCDx) != HAL_OK)
+    {
+        return 0;
+    }
+
+    LCD_Invalidate(LCDx);
+    uint16_t start = Timebase_Now_us();
+    LCD_Flush(LCDx);
+    if (LCD_WaitIdle(LCDx) != HAL_OK)
+    {
+        return 0;
+    }
+    return Timebase_Elapsed_us(start);
+}
+
+void LCD_Process(LCD_HandleTypeDef *LCDx)
+{
+    if (LCDx->bus != NULL)
+    {
+        I2C_Bus_Process(LCDx->bus);
+    }
+    LCD_TxKick(LCDx);
+}
+
+void LCD_I2C_MasterTxCpltCallback(LCD_HandleTypeDef *LCDx, I2C_HandleTypeDef *hi2c)
+{
+    // Chunks sent through the bus queue are released by LCD_BusDone()
+    if (hi2c != LCDx->lcd_hi2c || LCDx->txLen == 0 || LCDx->xfer.pending)
+    {
+        return;
+    }
+    LCD_TxRelease(LCDx);
+    LCD_TxKick(LCDx);
+}
+
+void LCD_I2C_ErrorCallback(LCD_HandleTypeDef *LCDx, I2C_HandleTypeDef *hi2c)
+{
+    // Chunks sent through the bus queue are released by LCD_BusDone()
+    if (hi2c != LCDx->lcd_hi2c || LCDx->txLen == 0 || LCDx->xfer.pending)
+    {
+        return;
+    }
+    // A corrupted nibble stream cannot be resent reliably, drop the chunk
+    LCD_TxRelease(LCDx);
+    LCD_TxKick(LCDx);
+}
+
+void LCD_WriteString(LCD_HandleTypeDef *LCDx, uint8_t col, uint8_t row, const char *str)
+{
+    if (row >= LCD_ROWS)
+    {
+        return;
+    }
+    while (*str && col < LCD_COLS)
+    {
+        LCDx->frame[row][col++] = *str++;
+    }
+}
+
+void LCD_ClearFrame(LCD_HandleTypeDef *LCDx)
+{
+    memset(LCDx->frame, ' ', sizeof(LCDx->frame));
+}
+
+uint8_t LCD_Flush(LCD_HandleTypeDef *LCDx)
+{
+    PROFILER_SCOPE("LCD_Flush");
+    uint8_t runs = 0;
+
+    // Under a display shift the cells would land in other columns; the shadow
+    // is left alone, so the frame goes out after LCD_Scroller_Stop()
+    if (LCDx->scrolling)
+    {
+        return 0;
+    }
+
+    for (uint8_t row = 0; row < LCD_ROWS; row++)
+    {
+        char *frame = LCDx->frame[row];
+        char *shadow = LCDx->shadow[row];
+        uint8_t col = 0;
+
+        while (col < LCD_COLS)
+        {
+            if (frame[col] == shadow[col])
+            {
+                col++;
+                continue;
+            }
+
+            // Extend the run over short stretches of clean cells
+            uint8_t start = col;
+            uint8_t end = col + 1;
+            uint8_t scan = end;
+            while (scan < LCD_COLS && (uint8_t)(scan - end) <= LCD_FLUSH_MERGE_GAP)
+            {
+                if (frame[scan] != shadow[scan])
+                {
+                    end = scan + 1;
+                }
+                scan++;
+            }
+
+            LCD_SendRun(LCDx, 1, LCD_Address(start, row), &frame[start], (uint16_t)(end - start));
+            memcpy(&shadow[start], &frame[start], end - start);
+            runs++;
+            col = end;
+        }
+    }
+    return runs;
+}
+
+void LCD_Invalidate(LCD_HandleTypeDef *LCDx)
+{
+    // Any value other than the frame's forces the cell to be resent
+    for (uint8_t row = 0; row < LCD_ROWS; row++)
+    {
+        for (uint8_t col = 0; col < LCD_COLS; col++)
+        {
+            LCDx->shadow[row][col] = (char)~LCDx->frame[row][col];
+        }
+    }
+}
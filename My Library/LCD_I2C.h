@@ -11,6 +11,26 @@
  * through an I2C adapter (e.g. PCF8574). It supports basic text display,
  * cursor control, backlight management, and custom character creation.
  *
+ * Writes are asynchronous: every command is expanded into PCF8574 nibble
+ * frames and appended to a ring buffer that is streamed to the expander with
+ * HAL_I2C_Master_Transmit_DMA, so printing returns immediately. Frames queued
+ * while a transfer is running leave together in the next one. Forward
+ * HAL_I2C_MasterTxCpltCallback and HAL_I2C_ErrorCallback to the
+ * LCD_I2C_xxxCallback hooks. Without a TX DMA channel linked to the I2C handle
+ * the queue is drained with blocking transfers instead. On a bus shared
+ * with other devices (LCD_SetBus) the chunks go through the bus queue at
+ * display priority and the bus hooks complete them.
+ *
+ * Commands with long execution times (power-up, clear, home, the 8-bit init
+ * steps) place a hold in the queue: the bytes after them are not sent until
+ * the command's deadline has passed, so the caller never waits. Call
+ * LCD_Process() from the main loop to resume the queue once a hold expires;
+ * LCD_Init() itself only queues the init sequence.
+ *
+ * For screens that are redrawn periodically, write into the in-RAM frame with
+ * LCD_WriteString() and call LCD_Flush(): only cells that differ from what the
+ * LCD already shows are sent, with no clear and no flicker.
+ *
  * Example usage:
  * @code
  *   LCD_HandleTypeDef hlcd;
@@ -27,6 +47,7 @@
 #define _LCD_I2C_H_
 
 #include "stm32f1xx_hal.h"
+#include "I2C_Bus.h"
 
 /* -------------------------------------------------------------------------- */
 /*                               LCD Constants                                */
@@ -83,28 +104,122 @@
 #define RS_COMMAND 0x00
 #define RS_DATA 0x01
 
+/* Command execution times (HD44780 datasheet, fosc = 270 kHz) */
+#define LCD_POWERUP_DELAY_US 50000U /* Vcc rise to first command */
+#define LCD_CLEAR_DELAY_US 1520U    /* Clear display, return home */
+#define LCD_INIT_DELAY_US 4100U     /* Function set while still in 8-bit mode */
+#define LCD_CMD_DELAY_US 37U        /* Any other command or data write. Shorter
+                                       than the two I2C bytes separating EN
+                                       strobes, so it never needs a hold */
+
+/* DDRAM characters per line, the span the hardware display shift rotates */
+#define LCD_DDRAM_LINE 40U
+
+/* Pending holds the queue can track, a power of two */
+#define LCD_HOLD_DEPTH 8U
+
+/* Display geometry used by the shadow framebuffer */
+#ifndef LCD_COLS
+#define LCD_COLS 16U
+#endif
+#ifndef LCD_ROWS
+#define LCD_ROWS 2U
+#endif
+
+/* Unchanged cells between two dirty runs that LCD_Flush() resends rather than
+ * start a new run: a cell costs as many bytes as the address command */
+#define LCD_FLUSH_MERGE_GAP 1U
+
+/* Transmit queue size in bytes, a power of two. Each command or character
+ * takes 4 bytes, so the default holds a full 16x2 update with cursor moves. */
+#ifndef LCD_TX_BUFFER_SIZE
+#define LCD_TX_BUFFER_SIZE 256U
+#endif
+
+/* PCF8574 bytes per command or character: two nibbles, each strobed by EN */
+#define LCD_FRAME_BYTES 4U
+
+/* Longest transfer on a shared bus, a multiple of LCD_FRAME_BYTES: a sensor
+ * read waits for one at most (0.8 ms at 400 kHz, 3 ms at 100 kHz) */
+#ifndef LCD_BUS_CHUNK_MAX
+#define LCD_BUS_CHUNK_MAX 32U
+#endif
+
+/* Longest string run encoded into one transfer, half the queue at most */
+#define LCD_RUN_MAX_CHARS ((LCD_TX_BUFFER_SIZE / 2U) / LCD_FRAME_BYTES - 1U)
+
+/* Longest time LCD_WaitIdle() waits for the queue to drain */
+#define LCD_TX_TIMEOUT_MS 100U
+
 /* -------------------------------------------------------------------------- */
 /*                             LCD Handle Struct                              */
 /* -------------------------------------------------------------------------- */
 
+/**
+ * @brief  Execution hold placed after a slow command
+ */
+typedef struct
+{
+    uint16_t pos; /*!< Queue index just past the command's last byte */
+    uint16_t us;  /*!< Time the LCD needs once that byte is sent */
+} LCD_HoldTypeDef;
+
 /**
  * @brief  LCD handle structure definition
  */
 typedef struct
 {
-    I2C_HandleTypeDef *lcd_hi2c; /*!< Pointer to I2C handler */
-    uint8_t lcd_addr;            /*!< I2C address of LCD */
-    uint8_t backlight;           /*!< Backlight control flag */
-    uint8_t displaycontrol;      /*!< Display control flags */
-    uint8_t displaymode;         /*!< Display mode flags */
+    I2C_HandleTypeDef *lcd_hi2c;     /*!< Pointer to I2C handler */
+    I2C_Bus_HandleTypeDef *bus;      /*!< Shared bus layer, NULL to use lcd_hi2c as is */
+    I2C_Bus_TransactionTypeDef xfer; /*!< Bus queue descriptor of the running chunk */
+    uint8_t lcd_addr;                /*!< I2C address of LCD */
+    uint8_t backlight;               /*!< Backlight control flag */
+    uint8_t displaycontrol;          /*!< Display control flags */
+    uint8_t displaymode;             /*!< Display mode flags */
+
+    uint8_t txBuf[LCD_TX_BUFFER_SIZE]; /*!< Queued PCF8574 output bytes */
+    volatile uint16_t txHead;          /*!< Next free slot, written by the producer */
+    volatile uint16_t txTail;          /*!< Oldest byte not yet sent, written on completion */
+    volatile uint16_t txLen;           /*!< Bytes owned by the running transfer, 0 when idle */
+
+    LCD_HoldTypeDef holds[LCD_HOLD_DEPTH]; /*!< Holds not yet reached, oldest first */
+    volatile uint8_t holdIn;               /*!< Holds queued, free-running */
+    volatile uint8_t holdOut;              /*!< Holds reached, free-running */
+    volatile uint8_t holdActive;           /*!< The queue is waiting for the LCD */
+    uint16_t holdStart;                    /*!< Timebase_Now_us() when the hold began */
+    uint16_t holdUs;                       /*!< Length of the running hold */
+    uint32_t holdTick;                     /*!< HAL_GetTick() when the hold began */
+
+    char frame[LCD_ROWS][LCD_COLS];  /*!< Contents to show, written by LCD_WriteString */
+    char shadow[LCD_ROWS][LCD_COLS]; /*!< Contents the LCD DDRAM is known to hold */
+    uint8_t scrolling;               /*!< A hardware scroller shifts the display, LCD_Flush() waits */
 } LCD_HandleTypeDef;
 
+/**
+ * @brief  Non-blocking text scroller state
+ */
+typedef struct
+{
+    LCD_HandleTypeDef *lcd;       /*!< LCD the scroller draws on */
+    const char *message;          /*!< Text to scroll, kept by the caller */
+    uint8_t len;                  /*!< Message length */
+    uint8_t row;                  /*!< LCD row index */
+    uint8_t pos;                  /*!< First visible character */
+    uint8_t hardware;             /*!< 1 if steps use the display shift command */
+    uint16_t period_ms;           /*!< Time between steps for LCD_Scroller_Tick */
+    uint32_t lastTick;            /*!< HAL_GetTick() of the last step */
+    volatile uint8_t stepPending; /*!< Step asked for by LCD_Scroller_Request() */
+} LCD_ScrollerTypeDef;
+
 /* -------------------------------------------------------------------------- */
 /*                              Function Prototypes                           */
 /* -------------------------------------------------------------------------- */
 
 /**
- * @brief  Initialize the LCD module via I2C.
+ * @brief  Initialize the LCD module via I2C. The init sequence is queued and
+ *         sent by LCD_Process() as its delays expire, so this returns at once.
+ *         Command delays are timed with the shared microsecond timebase,
+ *         start it first with Timebase_Init().
  * @param  LCDx: Pointer to LCD handle structure.
  * @param  hi2c: Pointer to I2C handle (e.g. &hi2c1).
  * @param  addr: I2C address of LCD (e.g. LCD_ADDR).
@@ -112,6 +227,19 @@ typedef struct
  */
 void LCD_Init(LCD_HandleTypeDef *LCDx, I2C_HandleTypeDef *hi2c, uint8_t addr);
 
+/**
+ * @brief  Route the LCD through a shared bus layer: every chunk is queued at
+ *         display priority, runs with the profile registered for the LCD
+ *         address, and is at most LCD_BUS_CHUNK_MAX bytes long so other
+ *         devices get the bus in between. A chunk that fails is sent again
+ *         up to I2C_BUS_RETRIES times after a backoff. Call right after
+ *         LCD_Init(), before LCD_Process() sends the init sequence.
+ * @param  LCDx: Pointer to LCD handle structure.
+ * @param  hbus: Pointer to bus handle built over the same I2C handle.
+ * @retval None
+ */
+void LCD_SetBus(LCD_HandleTypeDef *LCDx, I2C_Bus_HandleTypeDef *hbus);
+
 /**
  * @brief  Clear the LCD display and return cursor to home position.
  * @param  LCDx: Pointer to LCD handle structure.
@@ -193,12 +321,24 @@ void LCD_NoBacklight(LCD_HandleTypeDef *LCDx);
 
 /**
  * @brief  Print a string on the LCD starting at current cursor position.
+ *         The string is encoded into one contiguous I2C transfer.
  * @param  LCDx: Pointer to LCD handle structure.
  * @param  str: Pointer to null-terminated string.
  * @retval None
  */
 void LCD_Print(LCD_HandleTypeDef *LCDx, char *str);
 
+/**
+ * @brief  Move the cursor and print a string. The address command and the
+ *         characters are encoded into one contiguous I2C transfer.
+ * @param  LCDx: Pointer to LCD handle structure.
+ * @param  col: Column position (0-based).
+ * @param  row: Row position (0-based).
+ * @param  str: Pointer to null-terminated string.
+ * @retval None
+ */
+void LCD_PrintAt(LCD_HandleTypeDef *LCDx, uint8_t col, uint8_t row, char *str);
+
 /**
  * @brief  Print a single character on the LCD.
  * @param  LCDx: Pointer to LCD handle structure.
@@ -217,7 +357,8 @@ void LCD_PrintChar(LCD_HandleTypeDef *LCDx, char ch);
 void LCD_CreateChar(LCD_HandleTypeDef *LCDx, uint8_t location, uint8_t charmap[]);
 
 /**
- * @brief  Scroll text horizontally across a given LCD row.
+ * @brief  Scroll text horizontally across a given LCD row. Blocks for the
+ *         whole pass, see LCD_Scroller_Init() for a non-blocking scroller.
  * @param  LCDx: Pointer to LCD handle structure.
  * @param  row: LCD row index (0 or 1 for 16x2).
  * @param  message: Pointer to text string to scroll.
@@ -226,4 +367,145 @@ void LCD_CreateChar(LCD_HandleTypeDef *LCDx, uint8_t location, uint8_t charmap[]
  */
 void LCD_ScrollText(LCD_HandleTypeDef *LCDx, uint8_t row, char *message, uint16_t delay_ms);
 
+/**
+ * @brief  Write a string into the framebuffer, clipped at the end of the row.
+ *         Nothing is sent until LCD_Flush().
+ * @param  LCDx: Pointer to LCD handle structure.
+ * @param  col: Column position (0-based).
+ * @param  row: Row position (0-based).
+ * @param  str: Pointer to null-terminated string.
+ * @retval None
+ */
+void LCD_WriteString(LCD_HandleTypeDef *LCDx, uint8_t col, uint8_t row, const char *str);
+
+/**
+ * @brief  Fill the framebuffer with spaces. Nothing is sent until LCD_Flush().
+ * @param  LCDx: Pointer to LCD handle structure.
+ * @retval None
+ */
+void LCD_ClearFrame(LCD_HandleTypeDef *LCDx);
+
+/**
+ * @brief  Send the framebuffer cells that differ from the LCD contents, as
+ *         one cursor move plus characters per changed run.
+ * @param  LCDx: Pointer to LCD handle structure.
+ * @retval Number of runs queued, 0 if the LCD was already up to date or a
+ *         hardware scroller shifts the display; the frame then stays
+ *         pending and goes out with the first flush after LCD_Scroller_Stop().
+ */
+uint8_t LCD_Flush(LCD_HandleTypeDef *LCDx);
+
+/**
+ * @brief  Forget what the LCD shows so the next LCD_Flush() redraws every
+ *         cell. Call after writing with LCD_Print/LCD_PrintAt/LCD_ScrollText,
+ *         which bypass the framebuffer.
+ * @param  LCDx: Pointer to LCD handle structure.
+ * @retval None
+ */
+void LCD_Invalidate(LCD_HandleTypeDef *LCDx);
+
+/**
+ * @brief  Time a full redraw of the framebuffer: every cell is resent and
+ *         the queue drained. Pending output is flushed before timing starts.
+ * @param  LCDx: Pointer to LCD handle structure.
+ * @retval Redraw time in microseconds, 0 if the transport timed out.
+ *         Measured with the 16-bit timebase, so valid below 65 ms.
+ */
+uint32_t LCD_Benchmark(LCD_HandleTypeDef *LCDx);
+
+/**
+ * @brief  Resume the transmit queue after a command's execution time has
+ *         passed. Call from the main loop.
+ * @param  LCDx: Pointer to LCD handle structure.
+ * @retval None
+ */
+void LCD_Process(LCD_HandleTypeDef *LCDx);
+
+/**
+ * @brief  Set up a scroller that moves text one column per step, wrapping
+ *         back to the start after the last column has been shown.
+ *         With hardware set and a message of up to LCD_DDRAM_LINE characters,
+ *         the message is loaded into DDRAM once and each step is a single
+ *         display shift command. The shift moves every row, so LCD_Flush()
+ *         sends nothing until LCD_Scroller_Stop().
+ *         Otherwise each step redraws the row through the framebuffer.
+ * @param  scroller: Pointer to scroller state.
+ * @param  LCDx: Pointer to LCD handle structure.
+ * @param  row: LCD row index.
+ * @param  message: Null-terminated text, must stay valid while scrolling.
+ * @param  period_ms: Time between steps when driven by LCD_Scroller_Tick(),
+ *                    0 to step only on LCD_Scroller_Request().
+ * @param  hardware: 1 to use the display shift when the message allows it.
+ * @retval HAL status
+ */
+HAL_StatusTypeDef LCD_Scroller_Init(LCD_ScrollerTypeDef *scroller, LCD_HandleTypeDef *LCDx, uint8_t row,
+                                    const char *message, uint16_t period_ms, uint8_t hardware);
+
+/**
+ * @brief  Advance the scroller by one column. Call from the main loop only:
+ *         a step queues frames like any other write and may wait for room.
+ *         From a timer callback use LCD_Scroller_Request().
+ * @param  scroller: Pointer to scroller state.
+ * @retval None
+ */
+void LCD_Scroller_Step(LCD_ScrollerTypeDef *scroller);
+
+/**
+ * @brief  Ask for a step from interrupt context, e.g. a timer callback. Only
+ *         a flag is set; the next LCD_Scroller_Tick() sends the step.
+ *         Requests made before that one step is taken count once.
+ * @param  scroller: Pointer to scroller state.
+ * @retval None
+ */
+void LCD_Scroller_Request(LCD_ScrollerTypeDef *scroller);
+
+/**
+ * @brief  Advance the scroller if a step was requested or its period has
+ *         elapsed. Call from the main loop.
+ * @param  scroller: Pointer to scroller state.
+ * @retval 1 if a step was taken, else 0.
+ */
+uint8_t LCD_Scroller_Tick(LCD_ScrollerTypeDef *scroller);
+
+/**
+ * @brief  Stop scrolling. A hardware shift is undone and the framebuffer is
+ *         resynchronized on the next LCD_Flush().
+ * @param  scroller: Pointer to scroller state.
+ * @retval None
+ */
+void LCD_Scroller_Stop(LCD_ScrollerTypeDef *scroller);
+
+/**
+ * @brief  Check whether every queued frame has reached the LCD.
+ * @param  LCDx: Pointer to LCD handle structure.
+ * @retval 1 if the transmit queue is empty and no transfer is running, else 0.
+ */
+uint8_t LCD_IsIdle(LCD_HandleTypeDef *LCDx);
+
+/**
+ * @brief  Wait until the transmit queue has drained. Frames still pending
+ *         after LCD_TX_TIMEOUT_MS are discarded.
+ * @param  LCDx: Pointer to LCD handle structure.
+ * @retval HAL_OK when drained, HAL_TIMEOUT if frames were discarded.
+ */
+HAL_StatusTypeDef LCD_WaitIdle(LCD_HandleTypeDef *LCDx);
+
+/**
+ * @brief  I2C transmit complete hook, call from HAL_I2C_MasterTxCpltCallback.
+ *         Releases the finished chunk and starts the next one.
+ * @param  LCDx: Pointer to LCD handle structure.
+ * @param  hi2c: I2C handle passed to the HAL callback.
+ * @retval None
+ */
+void LCD_I2C_MasterTxCpltCallback(LCD_HandleTypeDef *LCDx, I2C_HandleTypeDef *hi2c);
+
+/**
+ * @brief  I2C error hook, call from HAL_I2C_ErrorCallback. The failed chunk
+ *         is dropped so the queue keeps moving.
+ * @param  LCDx: Pointer to LCD handle structure.
+ * @param  hi2c: I2C handle passed to the HAL callback.
+ * @retval None
+ */
+void LCD_I2C_ErrorCallback(LCD_HandleTypeDef *LCDx, I2C_HandleTypeDef *hi2c);
+
 #endif /* _LCD_I2C_H_ */
\ No newline at end of file
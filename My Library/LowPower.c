@@ -0,0 +1,150 @@
+#include "LowPower.h"
+#include "Timebase.h"
+
+/* Defined by stm32f1xx_hal.c, advanced here for the time spent in STOP */
+extern __IO uint32_t uwTick;
+
+static uint32_t LowPower_RtcCounter(void)
+{
+    // CNTL may roll over between the two halves: read until CNTH is stable
+    uint16_t high = (uint16_t)RTC->CNTH;
+    uint16_t low = (uint16_t)RTC->CNTL;
+    if (high != (uint16_t)RTC->CNTH)
+    {
+        high = (uint16_t)RTC->CNTH;
+        low = (uint16_t)RTC->CNTL;
+    }
+    return ((uint32_t)high << 16) | low;
+}
+
+static void LowPower_RtcWriteAlarm(uint32_t alarm)
+{
+    // Alarm registers are written in configuration mode, one write at a time
+    while ((RTC->CRL & RTC_CRL_RTOFF) == 0U)
+    {
+    }
+    SET_BIT(RTC->CRL, RTC_CRL_CNF);
+    RTC->ALRH = alarm >> 16;
+    RTC->ALRL = alarm & 0xFFFFU;
+    CLEAR_BIT(RTC->CRL, RTC_CRL_CNF);
+    while ((RTC->CRL & RTC_CRL_RTOFF) == 0U)
+    {
+    }
+}
+
+static void LowPower_Sleep(LowPower_HandleTypeDef *hlp)
+{
+    uint16_t start = Timebase_Now_us();
+
+    HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+
+    // SysTick ends the sleep within a millisecond, well inside the 16-bit range
+    hlp->sleepUs += Timebase_Elapsed_us(start);
+}
+
+static void LowPower_Stop(LowPower_HandleTypeDef *hlp, uint32_t sleep_ms)
+{
+    uint32_t counts = ((sleep_ms - LOWPOWER_WAKE_MARGIN_MS) * LOWPOWER_RTC_HZ) / 1000U;
+    uint32_t start = LowPower_RtcCounter();
+
+    LowPower_RtcWriteAlarm(start + counts);
+    __HAL_RTC_ALARM_CLEAR_FLAG(hlp->hrtc, RTC_FLAG_ALRAF);
+    __HAL_RTC_ALARM_EXTI_CLEAR_FLAG();
+    __HAL_RTC_ALARM_ENABLE_IT(hlp->hrtc, RTC_IT_ALRA);
+
+    HAL_SuspendTick();
+    HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+
+    // Running from HSI at 8 MHz until the clock tree is rebuilt
+    hlp->RestoreClock();
+
+    __HAL_RTC_ALARM_DISABLE_IT(hlp->hrtc, RTC_IT_ALRA);
+    __HAL_RTC_ALARM_CLEAR_FLAG(hlp->hrtc, RTC_FLAG_ALRAF);
+    __HAL_RTC_ALARM_EXTI_CLEAR_FLAG();
+
+    // The APB1 view of the RTC registers is stale until resynchronized
+    HAL_RTC_WaitForSynchro(hlp->hrtc);
+    uint32_t elapsed = LowPower_RtcCounter() - start;
+
+    // The tick stood still: add the RTC time, carrying the fraction of a ms
+    uint32_t scaled = elapsed * 1000U + hlp->tickRemainder;
+    uwTick += scaled / LOWPOWER_RTC_HZ;
+    hlp->tickRemainder = scaled % LOWPOWER_RTC_HZ;
+    HAL_ResumeTick();
+
+    hlp->stopUs += ((uint64_t)elapsed * 1000000U) / LOWPOWER_RTC_HZ;
+    hlp->stops++;
+}
+
+HAL_StatusTypeDef LowPower_Init(LowPower_HandleTypeDef *hlp, RTC_HandleTypeDef *hrtc, void (*RestoreClock)(void))
+{
+    if (hlp == NULL || (hrtc != NULL && RestoreClock == NULL))
+    {
+        return HAL_ERROR;
+    }
+
+    hlp->hrtc = hrtc;
+    hlp->RestoreClock = RestoreClock;
+    hlp->tickRemainder = 0;
+    LowPower_ResetStats(hlp);
+
+    if (hrtc != NULL)
+    {
+        // Only the interrupt line wakes WFI out of STOP, not the event line
+        __HAL_RTC_ALARM_EXTI_ENABLE_IT();
+        __HAL_RTC_ALARM_EXTI_ENABLE_RISING_EDGE();
+    }
+
+    return HAL_OK;
+}
+
+void LowPower_Idle(LowPower_HandleTypeDef *hlp, uint32_t sleep_ms, uint8_t allow_stop)
+{
+    // Counter arithmetic must not overflow: one STOP lasts at most a minute
+    if (sleep_ms > 60000U)
+    {
+        sleep_ms = 60000U;
+    }
+
+    if (allow_stop && hlp->hrtc != NULL && sleep_ms >= LOWPOWER_STOP_MIN_MS)
+    {
+        LowPower_Stop(hlp, sleep_ms);
+    }
+    else
+    {
+        LowPower_Sleep(hlp);
+    }
+}
+
+void LowPower_GetReport(LowPower_HandleTypeDef *hlp, LowPower_ReportTypeDef *report)
+{
+    uint32_t total = HAL_GetTick() - hlp->startTick;
+    uint32_t sleep = (uint32_t)(hlp->sleepUs / 1000U);
+    uint32_t stop = (uint32_t)(hlp->stopUs / 1000U);
+
+    report->total_ms = total;
+    report->sleep_ms = sleep;
+    report->stop_ms = stop;
+    report->stops = hlp->stops;
+    report->run_ms = (sleep + stop < total) ? total - sleep - stop : 0U;
+
+    if (total == 0U)
+    {
+        report->duty_permille = 1000U;
+        report->average_ua = LOWPOWER_RUN_UA;
+        return;
+    }
+
+    report->duty_permille = (uint16_t)(((uint64_t)report->run_ms * 1000U) / total);
+    report->average_ua = (uint32_t)(((uint64_t)report->run_ms * LOWPOWER_RUN_UA +
+                                     (uint64_t)sleep * LOWPOWER_SLEEP_UA + (uint64_t)stop * LOWPOWER_STOP_UA) /
+                                    total);
+}
+
+void LowPower_ResetStats(LowPower_HandleTypeDef *hlp)
+{
+    hlp->startTick = HAL_GetTick();
+    hlp->sleepUs = 0;
+    hlp->stopUs = 0;
+    hlp->stops = 0;
+}
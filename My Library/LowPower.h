@@ -0,0 +1,148 @@
+/**
+ ******************************************************************************
+ * @file           : LowPower.h
+ * @brief          : Header file for the low-power idle layer.
+ *                   Sleeps the core between scheduler deadlines, in STOP mode
+ *                   with an RTC alarm wake-up when the gap is long enough,
+ *                   and accounts for the time spent in each mode.
+ ******************************************************************************
+ * @attention
+ *
+ * The scheduler idle hook hands over the time until the next deadline.
+ * Short gaps, or gaps during which a peripheral is still working, use SLEEP:
+ * the core halts on WFI and every clock keeps running, SysTick wakes it
+ * within a millisecond. Longer gaps use STOP: the 1.8 V domain clocks stop,
+ * HSE and PLL are switched off and only the LSE-driven RTC runs. An RTC alarm
+ * (EXTI line 17) ends the stop a few milliseconds before the deadline, the
+ * clock tree is restored through the callback given to LowPower_Init() and
+ * the HAL tick is advanced by the time measured on the RTC, so task deadlines
+ * stay on schedule.
+ *
+ * STOP halts TIM1, TIM2, DMA and I2C. The caller only allows it when no
+ * transfer, capture or start pulse is in progress; any enabled interrupt
+ * still wakes the core early.
+ *
+ * The RTC counts LSE / (AsynchPrediv + 1) = 1024 Hz (MX_RTC_Init). Current
+ * estimates use the datasheet figures of the MCU alone at 72 MHz with the
+ * peripherals in use; the LCD backlight and sensor dominate the board total.
+ *
+ * Example usage:
+ * @code
+ *   LowPower_Init(&hlp, &hrtc, SystemClock_Config);
+ *
+ *   static void Idle(uint32_t sleep_ms)
+ *   {
+ *       LowPower_Idle(&hlp, sleep_ms, PeripheralsIdle());
+ *   }
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _LOWPOWER_H_
+#define _LOWPOWER_H_
+
+#include "stm32f1xx_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/*                            LowPower Constants                              */
+/* -------------------------------------------------------------------------- */
+
+/* RTC counter frequency, LSE / (AsynchPrediv + 1) */
+#ifndef LOWPOWER_RTC_HZ
+#define LOWPOWER_RTC_HZ 1024U
+#endif
+
+/* Shortest idle worth entering STOP, below it SLEEP is used */
+#ifndef LOWPOWER_STOP_MIN_MS
+#define LOWPOWER_STOP_MIN_MS 10U
+#endif
+
+/* Wake this much before the deadline: HSE start-up and PLL lock */
+#ifndef LOWPOWER_WAKE_MARGIN_MS
+#define LOWPOWER_WAKE_MARGIN_MS 3U
+#endif
+
+/* Typical MCU supply current per mode, in uA (RM0008 / DS5319) */
+#ifndef LOWPOWER_RUN_UA
+#define LOWPOWER_RUN_UA 36000U
+#endif
+#ifndef LOWPOWER_SLEEP_UA
+#define LOWPOWER_SLEEP_UA 14400U
+#endif
+#ifndef LOWPOWER_STOP_UA
+#define LOWPOWER_STOP_UA 24U
+#endif
+
+/* -------------------------------------------------------------------------- */
+/*                             LowPower Structs                               */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Time spent per mode since the last reset of the statistics
+ */
+typedef struct
+{
+    uint32_t total_ms;      /*!< Wall time covered by the report */
+    uint32_t run_ms;        /*!< Time with the core running */
+    uint32_t sleep_ms;      /*!< Time in SLEEP */
+    uint32_t stop_ms;       /*!< Time in STOP, measured on the RTC */
+    uint32_t stops;         /*!< STOP entries */
+    uint16_t duty_permille; /*!< Run time per thousand */
+    uint32_t average_ua;    /*!< Estimated average MCU current */
+} LowPower_ReportTypeDef;
+
+/**
+ * @brief  LowPower handle structure definition
+ */
+typedef struct
+{
+    RTC_HandleTypeDef *hrtc;    /*!< RTC clocked from LSE, provides the alarm */
+    void (*RestoreClock)(void); /*!< Rebuilds the clock tree after STOP */
+    uint32_t startTick;         /*!< HAL tick at the last statistics reset */
+    uint64_t sleepUs;           /*!< Accumulated SLEEP time */
+    uint64_t stopUs;            /*!< Accumulated STOP time */
+    uint32_t stops;             /*!< STOP entries */
+    uint32_t tickRemainder;     /*!< Sub-millisecond RTC time not yet added to the tick */
+} LowPower_HandleTypeDef;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Initialize the low-power layer and arm the RTC alarm wake-up line.
+ * @param  hlp: Pointer to LowPower handle structure.
+ * @param  hrtc: Initialized RTC handle (MX_RTC_Init), or NULL to use SLEEP only.
+ * @param  RestoreClock: Called after STOP to restart HSE and PLL
+ *         (e.g. SystemClock_Config).
+ * @retval HAL status
+ */
+HAL_StatusTypeDef LowPower_Init(LowPower_HandleTypeDef *hlp, RTC_HandleTypeDef *hrtc, void (*RestoreClock)(void));
+
+/**
+ * @brief  Sleep until an interrupt or for at most sleep_ms. Call with
+ *         interrupts masked, as the Scheduler idle hook is.
+ * @param  hlp: Pointer to LowPower handle structure.
+ * @param  sleep_ms: Time until the next deadline.
+ * @param  allow_stop: Non-zero when no peripheral needs its clock until then.
+ * @retval None
+ */
+void LowPower_Idle(LowPower_HandleTypeDef *hlp, uint32_t sleep_ms, uint8_t allow_stop);
+
+/**
+ * @brief  Time and current figures since the last reset.
+ * @param  hlp: Pointer to LowPower handle structure.
+ * @param  report: Pointer to receive the report.
+ * @retval None
+ */
+void LowPower_GetReport(LowPower_HandleTypeDef *hlp, LowPower_ReportTypeDef *report);
+
+/**
+ * @brief  Restart the statistics from now.
+ * @param  hlp: Pointer to LowPower handle structure.
+ * @retval None
+ */
+void LowPower_ResetStats(LowPower_HandleTypeDef *hlp);
+
+#endif /* _LOWPOWER_H_ */
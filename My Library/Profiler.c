@@ -0,0 +1,153 @@
+#include "Profiler.h"
+
+#if PROFILER_ENABLE
+
+#include <stdio.h>
+
+/* Probes that have fired, newest first */
+static Profiler_ProbeTypeDef *profiler_probes = NULL;
+
+/* Cycles between the two counter reads of an empty scope */
+static uint32_t profiler_overhead = 0;
+
+static void Profiler_ITM_Write(const char *line, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        ITM_SendChar((uint32_t)line[i]);
+    }
+}
+
+HAL_StatusTypeDef Profiler_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    if ((DWT->CTRL & DWT_CTRL_NOCYCCNT_Msk) != 0U)
+    {
+        return HAL_ERROR;
+    }
+    // Left running: the probes only take differences, and the RTOS port
+    // counts its start-up tick on it
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    // Back-to-back reads, as at the two ends of an empty scope; keep the best
+    profiler_overhead = UINT32_MAX;
+    for (uint8_t i = 0; i < 8U; i++)
+    {
+        uint32_t start = DWT->CYCCNT;
+        uint32_t cycles = DWT->CYCCNT - start;
+        if (cycles < profiler_overhead)
+        {
+            profiler_overhead = cycles;
+        }
+    }
+
+    return HAL_OK;
+}
+
+void Profiler_Record(Profiler_ProbeTypeDef *probe, uint32_t cycles)
+{
+    cycles = (cycles > profiler_overhead) ? cycles - profiler_overhead : 0U;
+
+    uint32_t bucket = (cycles > 1U) ? 31U - __CLZ(cycles) : 0U;
+    if (bucket >= PROFILER_BUCKETS)
+    {
+        bucket = PROFILER_BUCKETS - 1U;
+    }
+
+    // A probe may fire in an interrupt while the main loop updates it
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!probe->linked)
+    {
+        probe->next = profiler_probes;
+        profiler_probes = probe;
+        probe->linked = 1;
+    }
+    if (probe->count == 0U || cycles < probe->min)
+    {
+        probe->min = cycles;
+    }
+    if (cycles > probe->max)
+    {
+        probe->max = cycles;
+    }
+    probe->count++;
+    probe->total += cycles;
+    probe->hist[bucket]++;
+    __set_PRIMASK(primask);
+}
+
+void Profiler_Reset(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (Profiler_ProbeTypeDef *probe = profiler_probes; probe != NULL; probe = probe->next)
+    {
+        probe->count = 0;
+        probe->min = 0;
+        probe->max = 0;
+        probe->total = 0;
+        for (uint8_t i = 0; i < PROFILER_BUCKETS; i++)
+        {
+            probe->hist[i] = 0;
+        }
+    }
+    __set_PRIMASK(primask);
+}
+
+void Profiler_Dump(Profiler_WriteFunc write)
+{
+    char line[PROFILER_LINE_SIZE];
+    uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+    int len;
+
+    if (write == NULL)
+    {
+        write = Profiler_ITM_Write;
+    }
+
+    len = snprintf(line, sizeof(line), "probe count min mean max (cycles), mean us, overhead %lu\r\n",
+                   (unsigned long)profiler_overhead);
+    write(line, (uint16_t)len);
+
+    for (Profiler_ProbeTypeDef *probe = profiler_probes; probe != NULL; probe = probe->next)
+    {
+        // Copy first: the report must not tear if the probe fires meanwhile
+        Profiler_ProbeTypeDef snap;
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        snap = *probe;
+        __set_PRIMASK(primask);
+
+        uint32_t mean = (snap.count != 0U) ? (uint32_t)(snap.total / snap.count) : 0U;
+        len = snprintf(line, sizeof(line), "%s %lu %lu %lu %lu %lu\r\n", snap.name, (unsigned long)snap.count,
+                       (unsigned long)snap.min, (unsigned long)mean, (unsigned long)snap.max,
+                       (unsigned long)(mean / cycles_per_us));
+        if (len >= (int)sizeof(line))
+        {
+            len = sizeof(line) - 1;
+        }
+        write(line, (uint16_t)len);
+
+        // Histogram: "  2^k:n" for every bucket in use
+        len = snprintf(line, sizeof(line), " ");
+        for (uint8_t i = 0; i < PROFILER_BUCKETS; i++)
+        {
+            if (snap.hist[i] == 0U)
+            {
+                continue;
+            }
+            if (len > (int)sizeof(line) - 20)
+            {
+                len += snprintf(&line[len], sizeof(line) - len, "\r\n");
+                write(line, (uint16_t)len);
+                len = snprintf(line, sizeof(line), " ");
+            }
+            len += snprintf(&line[len], sizeof(line) - len, " 2^%u:%lu", i, (unsigned long)snap.hist[i]);
+        }
+        len += snprintf(&line[len], sizeof(line) - len, "\r\n");
+        write(line, (uint16_t)len);
+    }
+}
+
+#endif /* PROFILER_ENABLE */
@@ -0,0 +1,159 @@
+/**
+ ******************************************************************************
+ * @file           : Profiler.h
+ * @brief          : Header file for the cycle-count profiler.
+ *                   Scoped probes on the DWT cycle counter with min/max/mean
+ *                   and log2 histograms, dumped over the ITM on demand.
+ ******************************************************************************
+ * @attention
+ *
+ * A probe measures the CPU cycles from its PROFILER_SCOPE() statement to the
+ * end of the enclosing block, however the block is left: the end is taken by
+ * a cleanup handler, so early returns are counted too. Each probe is a
+ * static record created at the probe site; it joins the dump list the first
+ * time it fires.
+ *
+ * Entering a scope reads DWT->CYCCNT into a local. Leaving it reads the
+ * counter again and records the difference, minus the probe overhead
+ * measured by Profiler_Init(). Histogram bucket k counts durations of
+ * 2^k to 2^(k+1) - 1 cycles (bucket 0 also holds 0 and 1); the last bucket
+ * takes everything longer.
+ *
+ * The counter runs at HCLK (72 MHz) and wraps every 59.6 s, so one
+ * measurement must stay below that. It stops in STOP mode: a scope that
+ * spans a STOP idle only counts the time the core was clocked.
+ *
+ * Probes compile to nothing unless PROFILER_ENABLE is 1. The top-level
+ * CMakeLists.txt sets it for Debug builds when the DHT22_PROFILER option is
+ * ON; Release builds never carry probes.
+ *
+ * Example usage:
+ * @code
+ *   Profiler_Init();
+ *
+ *   void Work(void)
+ *   {
+ *       PROFILER_SCOPE("Work");
+ *       ...
+ *   }
+ *
+ *   Profiler_Dump(NULL); // Text report on ITM stimulus port 0 (SWO)
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include "stm32f1xx_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/*                            Profiler Constants                              */
+/* -------------------------------------------------------------------------- */
+
+/* Probes compiled in, 0 to remove them */
+#ifndef PROFILER_ENABLE
+#define PROFILER_ENABLE 0
+#endif
+
+/* Histogram buckets per probe: bucket 23 starts at 2^23 cycles (116 ms) */
+#ifndef PROFILER_BUCKETS
+#define PROFILER_BUCKETS 24U
+#endif
+
+/* Longest report line, probe name included */
+#define PROFILER_LINE_SIZE 96U
+
+/* -------------------------------------------------------------------------- */
+/*                             Profiler Structs                               */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Statistics of one probe site
+ */
+typedef struct __Profiler_ProbeTypeDef
+{
+    const char *name;                        /*!< Label in the report */
+    uint32_t count;                          /*!< Measurements */
+    uint32_t min;                            /*!< Shortest, in cycles */
+    uint32_t max;                            /*!< Longest, in cycles */
+    uint64_t total;                          /*!< Sum, for the mean */
+    uint32_t hist[PROFILER_BUCKETS];         /*!< Log2 histogram */
+    struct __Profiler_ProbeTypeDef *next;    /*!< Dump list link */
+    uint8_t linked;                          /*!< Non-zero once on the dump list */
+} Profiler_ProbeTypeDef;
+
+/**
+ * @brief  Running measurement, ended by the cleanup handler
+ */
+typedef struct
+{
+    Profiler_ProbeTypeDef *probe; /*!< Probe to record into */
+    uint32_t start;               /*!< DWT->CYCCNT on entry */
+} Profiler_ScopeTypeDef;
+
+/**
+ * @brief  Report output: called with each line of the dump
+ */
+typedef void (*Profiler_WriteFunc)(const char *line, uint16_t len);
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+#if PROFILER_ENABLE
+
+/**
+ * @brief  Start the DWT cycle counter and measure the probe overhead.
+ * @retval HAL_OK, or HAL_ERROR if the core has no cycle counter.
+ */
+HAL_StatusTypeDef Profiler_Init(void);
+
+/**
+ * @brief  Add one measurement to a probe. Called by the scope cleanup.
+ * @param  probe: Probe to update.
+ * @param  cycles: Raw cycle count, overhead included.
+ * @retval None
+ */
+void Profiler_Record(Profiler_ProbeTypeDef *probe, uint32_t cycles);
+
+/**
+ * @brief  Clear the statistics of every probe that has fired.
+ * @retval None
+ */
+void Profiler_Reset(void);
+
+/**
+ * @brief  Write the report: one line per probe with count, min, mean and max
+ *         in cycles and microseconds, then its non-empty histogram buckets.
+ * @param  write: Line output, NULL for ITM stimulus port 0.
+ * @retval None
+ */
+void Profiler_Dump(Profiler_WriteFunc write);
+
+/* Cleanup handler of PROFILER_SCOPE(): kept inline, it runs on every exit */
+__STATIC_INLINE void Profiler_ScopeEnd(Profiler_ScopeTypeDef *scope)
+{
+    Profiler_Record(scope->probe, DWT->CYCCNT - scope->start);
+}
+
+#define PROFILER_CONCAT_(__A__, __B__) __A__##__B__
+#define PROFILER_CONCAT(__A__, __B__) PROFILER_CONCAT_(__A__, __B__)
+
+/* Measure from here to the end of the enclosing block */
+#define PROFILER_SCOPE(__NAME__)                                                                                     \
+    static Profiler_ProbeTypeDef PROFILER_CONCAT(profiler_probe_, __LINE__) = {.name = (__NAME__)};                  \
+    Profiler_ScopeTypeDef PROFILER_CONCAT(profiler_scope_, __LINE__) __attribute__((cleanup(Profiler_ScopeEnd))) = { \
+        &PROFILER_CONCAT(profiler_probe_, __LINE__), DWT->CYCCNT}
+
+#else
+
+#define Profiler_Init() (HAL_OK)
+#define Profiler_Reset() ((void)0)
+#define Profiler_Dump(__WRITE__) ((void)(__WRITE__))
+#define PROFILER_SCOPE(__NAME__) ((void)0)
+
+#endif /* PROFILER_ENABLE */
+
+#endif /* _PROFILER_H_ */
@@ -0,0 +1,202 @@
+#include "Scheduler.h"
+
+#define SCHEDULER_QUEUE_MASK (SCHEDULER_QUEUE_SIZE - 1U)
+
+#if (SCHEDULER_QUEUE_SIZE & SCHEDULER_QUEUE_MASK) != 0U || SCHEDULER_QUEUE_SIZE > 128U
+#error "SCHEDULER_QUEUE_SIZE must be a power of two up to 128"
+#endif
+
+#if defined(__arm__)
+#include "cmsis_compiler.h"
+/* Interrupts may post at any priority, mask them all around shared state */
+#define SCHEDULER_CRITICAL_ENTER()          \
+    uint32_t primask_ = __get_PRIMASK(); \
+    __disable_irq()
+#define SCHEDULER_CRITICAL_EXIT() __set_PRIMASK(primask_)
+#else
+/* Host build: single-threaded, nothing to mask */
+#define SCHEDULER_CRITICAL_ENTER() ((void)0)
+#define SCHEDULER_CRITICAL_EXIT() ((void)0)
+#endif
+
+/* Signed distance from now to a deadline, robust to tick wrap-around */
+static inline int32_t Scheduler_Until(uint32_t due, uint32_t now)
+{
+    return (int32_t)(due - now);
+}
+
+static inline uint8_t Scheduler_EventsPending(Scheduler_HandleTypeDef *sched)
+{
+    return sched->eventHead != sched->eventTail;
+}
+
+Scheduler_StatusTypeDef Scheduler_Init(Scheduler_HandleTypeDef *sched, uint32_t (*GetTick)(void),
+                                       void (*Idle)(uint32_t sleep_ms))
+{
+    if (sched == NULL || GetTick == NULL)
+    {
+        return SCHEDULER_ERROR;
+    }
+
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        sched->tasks[i].func = NULL;
+    }
+    sched->eventHead = 0;
+    sched->eventTail = 0;
+    sched->dropped = 0;
+    sched->GetTick = GetTick;
+    sched->Idle = Idle;
+
+    return SCHEDULER_OK;
+}
+
+int8_t Scheduler_AddTask(Scheduler_HandleTypeDef *sched, Scheduler_TaskFunc func, void *arg, uint32_t delay_ms,
+                         uint32_t period_ms)
+{
+    if (func == NULL)
+    {
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        Scheduler_TaskTypeDef *task = &sched->tasks[i];
+        if (task->func == NULL)
+        {
+            task->arg = arg;
+            task->period_ms = period_ms;
+            task->due = sched->GetTick() + delay_ms;
+            task->func = func;
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+Scheduler_StatusTypeDef Scheduler_Reschedule(Scheduler_HandleTypeDef *sched, int8_t id, uint32_t delay_ms)
+{
+    if (id < 0 || id >= (int8_t)SCHEDULER_MAX_TASKS || sched->tasks[id].func == NULL)
+    {
+        return SCHEDULER_ERROR;
+    }
+
+    sched->tasks[id].due = sched->GetTick() + delay_ms;
+    return SCHEDULER_OK;
+}
+
+Scheduler_StatusTypeDef Scheduler_Cancel(Scheduler_HandleTypeDef *sched, int8_t id)
+{
+    if (id < 0 || id >= (int8_t)SCHEDULER_MAX_TASKS)
+    {
+        return SCHEDULER_ERROR;
+    }
+
+    sched->tasks[id].func = NULL;
+    return SCHEDULER_OK;
+}
+
+Scheduler_StatusTypeDef Scheduler_Post(Scheduler_HandleTypeDef *sched, Scheduler_TaskFunc func, void *arg)
+{
+    if (func == NULL)
+    {
+        return SCHEDULER_ERROR;
+    }
+
+    SCHEDULER_CRITICAL_ENTER();
+    uint8_t head = sched->eventHead;
+    if ((uint8_t)(head - sched->eventTail) >= SCHEDULER_QUEUE_SIZE)
+    {
+        sched->dropped++;
+        SCHEDULER_CRITICAL_EXIT();
+        return SCHEDULER_FULL;
+    }
+    sched->events[head & SCHEDULER_QUEUE_MASK].func = func;
+    sched->events[head & SCHEDULER_QUEUE_MASK].arg = arg;
+    sched->eventHead = head + 1U;
+    SCHEDULER_CRITICAL_EXIT();
+
+    return SCHEDULER_OK;
+}
+
+uint32_t Scheduler_RunOnce(Scheduler_HandleTypeDef *sched)
+{
+    // Deferred work first: it carries interrupt results the tasks may need
+    while (Scheduler_EventsPending(sched))
+    {
+        Scheduler_EventTypeDef event = sched->events[sched->eventTail & SCHEDULER_QUEUE_MASK];
+        sched->eventTail++;
+        event.func(event.arg);
+    }
+
+    uint32_t now = sched->GetTick();
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        Scheduler_TaskTypeDef *task = &sched->tasks[i];
+        if (task->func == NULL || Scheduler_Until(task->due, now) > 0)
+        {
+            continue;
+        }
+
+        Scheduler_TaskFunc func = task->func;
+        if (task->period_ms == 0U)
+        {
+            task->func = NULL; // One-shot, the slot is free again
+        }
+        else
+        {
+            task->due += task->period_ms;
+            if (Scheduler_Until(task->due, now) <= 0)
+            {
+                // Missed whole periods: resynchronize instead of bursting
+                task->due = now + task->period_ms;
+            }
+        }
+        func(task->arg);
+        now = sched->GetTick();
+    }
+
+    if (Scheduler_EventsPending(sched))
+    {
+        return 0;
+    }
+
+    uint32_t next = SCHEDULER_NO_DEADLINE;
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        Scheduler_TaskTypeDef *task = &sched->tasks[i];
+        if (task->func == NULL)
+        {
+            continue;
+        }
+        int32_t until = Scheduler_Until(task->due, now);
+        if (until <= 0)
+        {
+            return 0;
+        }
+        if ((uint32_t)until < next)
+        {
+            next = (uint32_t)until;
+        }
+    }
+    return next;
+}
+
+void Scheduler_Dispatch(Scheduler_HandleTypeDef *sched)
+{
+    uint32_t next = Scheduler_RunOnce(sched);
+
+    if (next == 0U || sched->Idle == NULL)
+    {
+        return;
+    }
+
+    // Check and sleep with interrupts masked: an event posted after the check
+    // still wakes the core, it stays pending until the mask is lifted
+    SCHEDULER_CRITICAL_ENTER();
+    if (!Scheduler_EventsPending(sched))
+    {
+        sched->Idle(next);
+    }
+    SCHEDULER_CRITICAL_EXIT();
+}
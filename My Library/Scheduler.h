@@ -0,0 +1,184 @@
+/**
+ ******************************************************************************
+ * @file           : Scheduler.h
+ * @brief          : Header file for the cooperative run-to-completion
+ *                   scheduler. Runs timed tasks, drains work deferred from
+ *                   interrupts and sleeps when nothing is due.
+ ******************************************************************************
+ * @attention
+ *
+ * Tasks are plain functions that run to completion on the main stack, never
+ * preempting each other. A task runs once after a delay, or periodically
+ * with a fixed period. Interrupt handlers do not call drivers directly but
+ * post a function and argument with Scheduler_Post(); the main loop runs it
+ * before any timed task.
+ *
+ * The scheduler depends only on the time source and idle hook passed to
+ * Scheduler_Init(). On the target those are HAL_GetTick() and a function
+ * executing __WFI; a host build passes a simulated tick, so task logic can be
+ * exercised off target. The idle hook runs with interrupts masked and must
+ * return once an interrupt is pending, which __WFI does.
+ *
+ * Example usage:
+ * @code
+ *   static void Blink(void *arg) { HAL_GPIO_TogglePin(GPIOC, GPIO_PIN_13); }
+ *   static void Sleep(uint32_t ms) { __WFI(); }
+ *
+ *   Scheduler_HandleTypeDef sched;
+ *   Scheduler_Init(&sched, HAL_GetTick, Sleep);
+ *   Scheduler_AddTask(&sched, Blink, NULL, 0, 500);
+ *   while (1)
+ *       Scheduler_Dispatch(&sched);
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* -------------------------------------------------------------------------- */
+/*                            Scheduler Constants                             */
+/* -------------------------------------------------------------------------- */
+
+/* Timed task slots */
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 8U
+#endif
+
+/* Deferred events queued from interrupts, a power of two */
+#ifndef SCHEDULER_QUEUE_SIZE
+#define SCHEDULER_QUEUE_SIZE 16U
+#endif
+
+/* Returned by Scheduler_RunOnce() when no task is scheduled */
+#define SCHEDULER_NO_DEADLINE 0xFFFFFFFFU
+
+/* -------------------------------------------------------------------------- */
+/*                              Scheduler Structs                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Task or deferred event entry point
+ */
+typedef void (*Scheduler_TaskFunc)(void *arg);
+
+/**
+ * @brief  Scheduler result
+ */
+typedef enum
+{
+    SCHEDULER_OK = 0x00U,    /*!< Request accepted */
+    SCHEDULER_ERROR = 0x01U, /*!< Invalid argument */
+    SCHEDULER_FULL = 0x02U   /*!< No free task slot or queue entry */
+} Scheduler_StatusTypeDef;
+
+/**
+ * @brief  Timed task slot
+ */
+typedef struct
+{
+    Scheduler_TaskFunc func; /*!< Entry point, NULL for a free slot */
+    void *arg;               /*!< Argument passed to func */
+    uint32_t period_ms;      /*!< Period, 0 for a one-shot task */
+    uint32_t due;            /*!< Tick of the next run */
+} Scheduler_TaskTypeDef;
+
+/**
+ * @brief  Deferred event
+ */
+typedef struct
+{
+    Scheduler_TaskFunc func; /*!< Function to run from the main loop */
+    void *arg;               /*!< Argument passed to func */
+} Scheduler_EventTypeDef;
+
+/**
+ * @brief  Scheduler handle structure definition
+ */
+typedef struct
+{
+    Scheduler_TaskTypeDef tasks[SCHEDULER_MAX_TASKS];    /*!< Timed tasks */
+    Scheduler_EventTypeDef events[SCHEDULER_QUEUE_SIZE]; /*!< Deferred event ring */
+    volatile uint8_t eventHead;                          /*!< Next free event slot, free-running */
+    volatile uint8_t eventTail;                          /*!< Oldest pending event, free-running */
+    volatile uint32_t dropped;                           /*!< Events lost to a full queue */
+    uint32_t (*GetTick)(void);                           /*!< Millisecond time source */
+    void (*Idle)(uint32_t sleep_ms);                     /*!< Sleep until an interrupt, at most sleep_ms */
+} Scheduler_HandleTypeDef;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Initialize the scheduler.
+ * @param  sched: Pointer to scheduler handle structure.
+ * @param  GetTick: Millisecond time source (e.g. HAL_GetTick).
+ * @param  Idle: Called with interrupts masked when nothing is ready, with the
+ *         time until the next deadline (SCHEDULER_NO_DEADLINE if none). May
+ *         be NULL to spin.
+ * @retval Scheduler status
+ */
+Scheduler_StatusTypeDef Scheduler_Init(Scheduler_HandleTypeDef *sched, uint32_t (*GetTick)(void),
+                                       void (*Idle)(uint32_t sleep_ms));
+
+/**
+ * @brief  Add a timed task.
+ * @param  sched: Pointer to scheduler handle structure.
+ * @param  func: Task entry point.
+ * @param  arg: Argument passed to the task.
+ * @param  delay_ms: Time until the first run.
+ * @param  period_ms: Time between runs, 0 to run once.
+ * @retval Task id (0..SCHEDULER_MAX_TASKS-1), or -1 if no slot is free.
+ */
+int8_t Scheduler_AddTask(Scheduler_HandleTypeDef *sched, Scheduler_TaskFunc func, void *arg, uint32_t delay_ms,
+                         uint32_t period_ms);
+
+/**
+ * @brief  Move the next run of a task, e.g. to run it as soon as possible.
+ * @param  sched: Pointer to scheduler handle structure.
+ * @param  id: Task id returned by Scheduler_AddTask().
+ * @param  delay_ms: Time from now until the next run.
+ * @retval Scheduler status
+ */
+Scheduler_StatusTypeDef Scheduler_Reschedule(Scheduler_HandleTypeDef *sched, int8_t id, uint32_t delay_ms);
+
+/**
+ * @brief  Remove a task. Its slot can be reused.
+ * @param  sched: Pointer to scheduler handle structure.
+ * @param  id: Task id returned by Scheduler_AddTask().
+ * @retval Scheduler status
+ */
+Scheduler_StatusTypeDef Scheduler_Cancel(Scheduler_HandleTypeDef *sched, int8_t id);
+
+/**
+ * @brief  Queue a function to run from the main loop. Safe to call from
+ *         interrupt handlers of any priority.
+ * @param  sched: Pointer to scheduler handle structure.
+ * @param  func: Function to run.
+ * @param  arg: Argument passed to func.
+ * @retval SCHEDULER_FULL if the queue is full and the event was dropped.
+ */
+Scheduler_StatusTypeDef Scheduler_Post(Scheduler_HandleTypeDef *sched, Scheduler_TaskFunc func, void *arg);
+
+/**
+ * @brief  Run pending deferred events, then every task that is due.
+ * @param  sched: Pointer to scheduler handle structure.
+ * @retval Milliseconds until the next deadline, 0 if work is pending,
+ *         SCHEDULER_NO_DEADLINE if no task is scheduled.
+ */
+uint32_t Scheduler_RunOnce(Scheduler_HandleTypeDef *sched);
+
+/**
+ * @brief  Run ready work, then call the idle hook if nothing else became
+ *         ready. Call repeatedly from the main loop.
+ * @param  sched: Pointer to scheduler handle structure.
+ * @retval None
+ */
+void Scheduler_Dispatch(Scheduler_HandleTypeDef *sched);
+
+#endif /* _SCHEDULER_H_ */
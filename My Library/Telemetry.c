@@ -0,0 +1,135 @@
+#include "Telemetry.h"
+#include <string.h>
+
+/* Hand the filled half to the DMA; called with interrupts masked */
+static void Telemetry_Kick(Telemetry_HandleTypeDef *htel)
+{
+    uint8_t tx = htel->fillIndex;
+    uint16_t len = htel->fillLen;
+
+    htel->fillIndex = tx ^ 1U;
+    htel->fillLen = 0;
+    htel->busy = 1;
+    if (HAL_UART_Transmit_DMA(htel->huart, htel->buf[tx], len) != HAL_OK)
+    {
+        htel->busy = 0;
+        htel->dropped++;
+    }
+}
+
+HAL_StatusTypeDef Telemetry_Init(Telemetry_HandleTypeDef *htel, UART_HandleTypeDef *huart)
+{
+    if (htel == NULL || huart == NULL || huart->hdmatx == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    htel->huart = huart;
+    htel->fillIndex = 0;
+    htel->fillLen = 0;
+    htel->busy = 0;
+    htel->seq = 0;
+    htel->sent = 0;
+    htel->dropped = 0;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef Telemetry_Send(Telemetry_HandleTypeDef *htel, Telemetry_MessageTypeDef *msg)
+{
+    uint8_t payload[TELEMETRY_PAYLOAD_MAX];
+    uint8_t frame[TELEMETRY_FRAME_MAX];
+
+    msg->seq = htel->seq++;
+    size_t len = Telemetry_Encode(payload, Telemetry_Pack(msg, payload), frame);
+    if (len == 0U)
+    {
+        return HAL_ERROR;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (htel->fillLen + len > TELEMETRY_BUFFER_SIZE)
+    {
+        htel->dropped++;
+        __set_PRIMASK(primask);
+        return HAL_BUSY;
+    }
+    memcpy(&htel->buf[htel->fillIndex][htel->fillLen], frame, len);
+    htel->fillLen += (uint16_t)len;
+    htel->sent++;
+    if (!htel->busy)
+    {
+        Telemetry_Kick(htel);
+    }
+    __set_PRIMASK(primask);
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef Telemetry_SendReading(Telemetry_HandleTypeDef *htel, const DHT22_ReadingTypeDef *reading)
+{
+    Telemetry_MessageTypeDef msg;
+
+    msg.type = TELEMETRY_MSG_READING;
+    msg.tick = HAL_GetTick();
+    msg.reading.humidity = reading->humidity;
+    msg.reading.temperature = reading->temperature;
+
+    return Telemetry_Send(htel, &msg);
+}
+
+uint8_t Telemetry_IsIdle(Telemetry_HandleTypeDef *htel)
+{
+    return (!htel->busy && htel->fillLen == 0U) ? 1U : 0U;
+}
+
+uint32_t Telemetry_Benchmark(Telemetry_HandleTypeDef *htel, uint32_t duration_ms)
+{
+    DHT22_ReadingTypeDef reading = {.humidity = 555, .temperature = 234};
+    uint32_t frames = 0;
+    uint32_t tickstart = HAL_GetTick();
+
+    // Keep the buffer full: the accepted rate is what the line drains
+    while ((HAL_GetTick() - tickstart) < duration_ms)
+    {
+        if (Telemetry_SendReading(htel, &reading) == HAL_OK)
+        {
+            frames++;
+        }
+    }
+    while (!Telemetry_IsIdle(htel))
+    {
+    }
+
+    // Rejected attempts are part of the test, not real losses
+    htel->dropped = 0;
+    return (frames * 1000U) / duration_ms;
+}
+
+void Telemetry_UART_TxCpltCallback(Telemetry_HandleTypeDef *htel, UART_HandleTypeDef *huart)
+{
+    if (huart != htel->huart)
+    {
+        return;
+    }
+
+    htel->busy = 0;
+    if (htel->fillLen > 0U)
+    {
+        Telemetry_Kick(htel);
+    }
+}
+
+void Telemetry_UART_ErrorCallback(Telemetry_HandleTypeDef *htel, UART_HandleTypeDef *huart)
+{
+    // Receive-side errors leave a transmission running, only a stopped one counts
+    if (huart != htel->huart || huart->gState != HAL_UART_STATE_READY)
+    {
+        return;
+    }
+
+    // The half in flight is lost; carry on with what was queued since
+    htel->dropped++;
+    Telemetry_UART_TxCpltCallback(htel, huart);
+}
@@ -0,0 +1,127 @@
+/**
+ ******************************************************************************
+ * @file           : Telemetry.h
+ * @brief          : Header file for the UART telemetry stream.
+ *                   Queues framed messages in a double buffer and sends them
+ *                   by DMA while the application keeps running.
+ ******************************************************************************
+ * @attention
+ *
+ * Frames (see Telemetry_Frame.h) are appended to the filling half of a
+ * double buffer. When the DMA is idle the halves are swapped and the filled
+ * one is sent with HAL_UART_Transmit_DMA(); the transfer complete callback
+ * swaps again if more frames came in meanwhile. Telemetry_Send() never
+ * waits: when the filling half is full, the message is dropped and counted.
+ * At 115200 baud a 14-byte reading frame takes 1.2 ms on the line, far below
+ * the 2 s sampling interval.
+ *
+ * Send from the main loop only. Call Telemetry_UART_TxCpltCallback() from
+ * HAL_UART_TxCpltCallback() and Telemetry_UART_ErrorCallback() from
+ * HAL_UART_ErrorCallback().
+ *
+ * Example usage:
+ * @code
+ *   Telemetry_Init(&htel, &huart1);
+ *   Telemetry_SendReading(&htel, &dht22_1.reading);
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include "DHT22.h"
+#include "Telemetry_Frame.h"
+#include "stm32f1xx_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/*                            Telemetry Constants                             */
+/* -------------------------------------------------------------------------- */
+
+/* Size of each half of the double buffer */
+#ifndef TELEMETRY_BUFFER_SIZE
+#define TELEMETRY_BUFFER_SIZE 128U
+#endif
+
+/* -------------------------------------------------------------------------- */
+/*                             Telemetry Structs                              */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Telemetry handle structure definition
+ */
+typedef struct
+{
+    UART_HandleTypeDef *huart;             /*!< Pointer to UART handler, TX linked to a DMA channel */
+    uint8_t buf[2][TELEMETRY_BUFFER_SIZE]; /*!< Double buffer */
+    volatile uint8_t fillIndex;            /*!< Half being filled */
+    volatile uint16_t fillLen;             /*!< Bytes in the filling half */
+    volatile uint8_t busy;                 /*!< DMA sending the other half */
+    uint8_t seq;                           /*!< Sequence number of the next message */
+    volatile uint32_t sent;                /*!< Frames queued */
+    volatile uint32_t dropped;             /*!< Frames lost to a full buffer or UART error */
+} Telemetry_HandleTypeDef;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Initialize the telemetry stream.
+ * @param  htel: Pointer to telemetry handle structure.
+ * @param  huart: Initialized UART handle with a TX DMA channel (e.g. &huart1).
+ * @retval HAL status
+ */
+HAL_StatusTypeDef Telemetry_Init(Telemetry_HandleTypeDef *htel, UART_HandleTypeDef *huart);
+
+/**
+ * @brief  Frame and queue a message; type and payload fields must be set,
+ *         the sequence number is filled in.
+ * @param  htel: Pointer to telemetry handle structure.
+ * @param  msg: Message to send.
+ * @retval HAL_BUSY if the buffer is full and the message was dropped.
+ */
+HAL_StatusTypeDef Telemetry_Send(Telemetry_HandleTypeDef *htel, Telemetry_MessageTypeDef *msg);
+
+/**
+ * @brief  Queue a DHT22 reading stamped with the current tick.
+ * @param  htel: Pointer to telemetry handle structure.
+ * @param  reading: Reading to send.
+ * @retval HAL_BUSY if the buffer is full and the message was dropped.
+ */
+HAL_StatusTypeDef Telemetry_SendReading(Telemetry_HandleTypeDef *htel, const DHT22_ReadingTypeDef *reading);
+
+/**
+ * @brief  Check that nothing is queued or being sent.
+ * @param  htel: Pointer to telemetry handle structure.
+ * @retval 1 if idle, 0 otherwise.
+ */
+uint8_t Telemetry_IsIdle(Telemetry_HandleTypeDef *htel);
+
+/**
+ * @brief  Measure the frame rate the link sustains: stream reading frames
+ *         for a while and count those accepted. Blocking.
+ * @param  htel: Pointer to telemetry handle structure.
+ * @param  duration_ms: Measurement time.
+ * @retval Frames per second.
+ */
+uint32_t Telemetry_Benchmark(Telemetry_HandleTypeDef *htel, uint32_t duration_ms);
+
+/**
+ * @brief  UART transmit complete hook, call from HAL_UART_TxCpltCallback.
+ * @param  htel: Pointer to telemetry handle structure.
+ * @param  huart: UART handle passed to the HAL callback.
+ * @retval None
+ */
+void Telemetry_UART_TxCpltCallback(Telemetry_HandleTypeDef *htel, UART_HandleTypeDef *huart);
+
+/**
+ * @brief  UART error hook, call from HAL_UART_ErrorCallback.
+ * @param  htel: Pointer to telemetry handle structure.
+ * @param  huart: UART handle passed to the HAL callback.
+ * @retval None
+ */
+void Telemetry_UART_ErrorCallback(Telemetry_HandleTypeDef *htel, UART_HandleTypeDef *huart);
+
+#endif /* _TELEMETRY_H_ */
@@ -0,0 +1,195 @@
+#include "Telemetry_Frame.h"
+#include "CRC16.h"
+
+#define TELEMETRY_HEADER_BYTES 6U
+#define TELEMETRY_READING_BYTES (TELEMETRY_HEADER_BYTES + 4U)
+#define TELEMETRY_POWER_BYTES (TELEMETRY_HEADER_BYTES + 6U)
+
+/* Marks a frame that overflowed the buffer, dropped at its delimiter */
+#define TELEMETRY_RAW_SKIP 0xFFFFU
+
+static inline void Telemetry_Put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void Telemetry_Put32(uint8_t *p, uint32_t v)
+{
+    Telemetry_Put16(p, (uint16_t)v);
+    Telemetry_Put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint16_t Telemetry_Get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t Telemetry_Get32(const uint8_t *p)
+{
+    return Telemetry_Get16(p) | ((uint32_t)Telemetry_Get16(p + 2) << 16);
+}
+
+size_t Telemetry_Pack(const Telemetry_MessageTypeDef *msg, uint8_t *payload)
+{
+    payload[0] = msg->type;
+    payload[1] = msg->seq;
+    Telemetry_Put32(&payload[2], msg->tick);
+
+    switch (msg->type)
+    {
+    case TELEMETRY_MSG_READING:
+        Telemetry_Put16(&payload[6], (uint16_t)msg->reading.humidity);
+        Telemetry_Put16(&payload[8], (uint16_t)msg->reading.temperature);
+        return TELEMETRY_READING_BYTES;
+    case TELEMETRY_MSG_POWER:
+        Telemetry_Put16(&payload[6], msg->power.duty_permille);
+        Telemetry_Put32(&payload[8], msg->power.average_ua);
+        return TELEMETRY_POWER_BYTES;
+    default:
+        return 0;
+    }
+}
+
+uint8_t Telemetry_Unpack(const uint8_t *payload, size_t len, Telemetry_MessageTypeDef *msg)
+{
+    if (len < TELEMETRY_HEADER_BYTES)
+    {
+        return 0;
+    }
+
+    msg->type = payload[0];
+    msg->seq = payload[1];
+    msg->tick = Telemetry_Get32(&payload[2]);
+
+    switch (msg->type)
+    {
+    case TELEMETRY_MSG_READING:
+        msg->reading.humidity = (int16_t)Telemetry_Get16(&payload[6]);
+        msg->reading.temperature = (int16_t)Telemetry_Get16(&payload[8]);
+        return len == TELEMETRY_READING_BYTES;
+    case TELEMETRY_MSG_POWER:
+        msg->power.duty_permille = Telemetry_Get16(&payload[6]);
+        msg->power.average_ua = Telemetry_Get32(&payload[8]);
+        return len == TELEMETRY_POWER_BYTES;
+    default:
+        return 0;
+    }
+}
+
+size_t Telemetry_Encode(const uint8_t *payload, size_t len, uint8_t *frame)
+{
+    if (len > TELEMETRY_PAYLOAD_MAX)
+    {
+        return 0;
+    }
+
+    uint16_t crc = CRC16_Update(CRC16_INIT, payload, len);
+    uint8_t crc_bytes[2] = {(uint8_t)crc, (uint8_t)(crc >> 8)};
+
+    // COBS: each zero is replaced by the distance to the next one; the code
+    // byte in front of a run is patched once the run ends. Runs never reach
+    // 254 bytes here, the payload is shorter.
+    size_t code_at = 0;
+    size_t out = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len + 2U; i++)
+    {
+        uint8_t byte = (i < len) ? payload[i] : crc_bytes[i - len];
+        if (byte == 0U)
+        {
+            frame[code_at] = code;
+            code_at = out++;
+            code = 1;
+        }
+        else
+        {
+            frame[out++] = byte;
+            code++;
+        }
+    }
+    frame[code_at] = code;
+    frame[out++] = 0x00;
+
+    return out;
+}
+
+void Telemetry_DecoderInit(Telemetry_DecoderTypeDef *dec)
+{
+    dec->rawLen = 0;
+    dec->payloadLen = 0;
+    dec->frames = 0;
+    dec->crcErrors = 0;
+    dec->framingErrors = 0;
+}
+
+/* Undo COBS on a complete frame (delimiter excluded), 0 if malformed */
+static size_t Telemetry_Unstuff(const uint8_t *raw, size_t len, uint8_t *out)
+{
+    size_t n = 0;
+    size_t i = 0;
+
+    while (i < len)
+    {
+        uint8_t code = raw[i++];
+        if (code == 0U || i + code - 1U > len)
+        {
+            return 0;
+        }
+        for (uint8_t k = 1; k < code; k++)
+        {
+            out[n++] = raw[i++];
+        }
+        // A zero was replaced here, except after the final run
+        if (code < 0xFFU && i < len)
+        {
+            out[n++] = 0;
+        }
+    }
+    return n;
+}
+
+size_t Telemetry_DecodeByte(Telemetry_DecoderTypeDef *dec, uint8_t byte)
+{
+    if (byte != 0x00U)
+    {
+        if (dec->rawLen == TELEMETRY_RAW_SKIP)
+        {
+            return 0;
+        }
+        if (dec->rawLen == TELEMETRY_FRAME_MAX - 1U)
+        {
+            // Longer than any frame: noise or a lost delimiter
+            dec->rawLen = TELEMETRY_RAW_SKIP;
+            dec->framingErrors++;
+            return 0;
+        }
+        dec->raw[dec->rawLen++] = byte;
+        return 0;
+    }
+
+    uint16_t raw_len = dec->rawLen;
+    dec->rawLen = 0;
+    if (raw_len == 0U || raw_len == TELEMETRY_RAW_SKIP)
+    {
+        return 0; // Idle delimiters, or the end of a skipped frame
+    }
+
+    size_t n = Telemetry_Unstuff(dec->raw, raw_len, dec->payload);
+    if (n < TELEMETRY_HEADER_BYTES + 2U)
+    {
+        dec->framingErrors++;
+        return 0;
+    }
+
+    n -= 2U;
+    if (CRC16_Update(CRC16_INIT, dec->payload, n) != Telemetry_Get16(&dec->payload[n]))
+    {
+        dec->crcErrors++;
+        return 0;
+    }
+
+    dec->payloadLen = (uint16_t)n;
+    dec->frames++;
+    return n;
+}
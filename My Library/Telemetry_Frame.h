@@ -0,0 +1,149 @@
+/**
+ ******************************************************************************
+ * @file           : Telemetry_Frame.h
+ * @brief          : Header file for the telemetry wire format.
+ *                   Packs messages into CRC-protected, COBS-framed byte
+ *                   strings and decodes them back from a byte stream.
+ ******************************************************************************
+ * @attention
+ *
+ * Frame on the wire:
+ *
+ *   COBS( payload | CRC-16 of payload, little-endian ) | 0x00
+ *
+ * COBS (Consistent Overhead Byte Stuffing) removes every zero byte from the
+ * encoded data at a cost of one byte per 254, so 0x00 only ever appears as
+ * the frame delimiter. A receiver that starts mid-stream or loses bytes
+ * resynchronizes on the next delimiter; the CRC rejects damaged frames.
+ *
+ * Payload, little-endian:
+ *   type (1), sequence (1), tick in ms (4), then per type
+ *   - TELEMETRY_MSG_READING: humidity (2), temperature (2), deci-units;
+ *   - TELEMETRY_MSG_POWER: duty cycle in permille (2), average uA (4).
+ * A reading makes a 14-byte frame.
+ *
+ * This file and Telemetry_Frame.c depend only on <stdint.h>, <stddef.h> and
+ * CRC16, and are shared with the host decoder in Tools/telemetry_decode.c.
+ *
+ * Example usage:
+ * @code
+ *   uint8_t payload[TELEMETRY_PAYLOAD_MAX], frame[TELEMETRY_FRAME_MAX];
+ *   size_t n = Telemetry_Pack(&msg, payload);
+ *   size_t len = Telemetry_Encode(payload, n, frame);  // ready to send
+ *
+ *   // receiver, byte by byte
+ *   if (Telemetry_DecodeByte(&dec, byte) > 0)
+ *       Telemetry_Unpack(dec.payload, dec.payloadLen, &msg);
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _TELEMETRY_FRAME_H_
+#define _TELEMETRY_FRAME_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* -------------------------------------------------------------------------- */
+/*                         Telemetry Frame Constants                          */
+/* -------------------------------------------------------------------------- */
+
+/* Message types */
+#define TELEMETRY_MSG_READING 0x01U
+#define TELEMETRY_MSG_POWER 0x02U
+
+/* Largest payload of any message */
+#define TELEMETRY_PAYLOAD_MAX 16U
+
+/* Largest frame: payload, CRC, one COBS code byte per 254, delimiter */
+#define TELEMETRY_FRAME_MAX (TELEMETRY_PAYLOAD_MAX + 2U + 1U + 1U)
+
+/* -------------------------------------------------------------------------- */
+/*                          Telemetry Frame Structs                           */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Decoded telemetry message
+ */
+typedef struct
+{
+    uint8_t type;  /*!< TELEMETRY_MSG_... */
+    uint8_t seq;   /*!< Sender sequence number, gaps mean lost frames */
+    uint32_t tick; /*!< Sender HAL tick in ms */
+    union
+    {
+        struct
+        {
+            int16_t humidity;    /*!< Relative humidity in 0.1 % */
+            int16_t temperature; /*!< Temperature in 0.1 degree Celsius */
+        } reading;
+        struct
+        {
+            uint16_t duty_permille; /*!< Run time per thousand */
+            uint32_t average_ua;    /*!< Estimated average MCU current */
+        } power;
+    };
+} Telemetry_MessageTypeDef;
+
+/**
+ * @brief  Stream decoder state
+ */
+typedef struct
+{
+    uint8_t raw[TELEMETRY_FRAME_MAX];            /*!< Encoded bytes of the current frame */
+    uint16_t rawLen;                             /*!< Bytes collected, 0xFFFF while skipping an oversized frame */
+    uint8_t payload[TELEMETRY_PAYLOAD_MAX + 2U]; /*!< Last decoded payload (CRC included) */
+    uint16_t payloadLen;                         /*!< Payload length without the CRC */
+    uint32_t frames;                             /*!< Valid frames */
+    uint32_t crcErrors;                          /*!< Frames with a bad CRC */
+    uint32_t framingErrors;                      /*!< Oversized or malformed frames */
+} Telemetry_DecoderTypeDef;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Serialize a message into a payload.
+ * @param  msg: Message to pack.
+ * @param  payload: Buffer of TELEMETRY_PAYLOAD_MAX bytes.
+ * @retval Payload length, 0 for an unknown type.
+ */
+size_t Telemetry_Pack(const Telemetry_MessageTypeDef *msg, uint8_t *payload);
+
+/**
+ * @brief  Parse a payload into a message.
+ * @param  payload: Payload bytes.
+ * @param  len: Payload length.
+ * @param  msg: Pointer to receive the message.
+ * @retval 1 if the payload is a known message of the right length, 0 otherwise.
+ */
+uint8_t Telemetry_Unpack(const uint8_t *payload, size_t len, Telemetry_MessageTypeDef *msg);
+
+/**
+ * @brief  Append the CRC, COBS-encode and terminate a payload.
+ * @param  payload: Payload bytes.
+ * @param  len: Payload length, at most TELEMETRY_PAYLOAD_MAX.
+ * @param  frame: Buffer of TELEMETRY_FRAME_MAX bytes.
+ * @retval Frame length including the delimiter, 0 if the payload is too long.
+ */
+size_t Telemetry_Encode(const uint8_t *payload, size_t len, uint8_t *frame);
+
+/**
+ * @brief  Reset a stream decoder.
+ * @param  dec: Pointer to decoder state.
+ * @retval None
+ */
+void Telemetry_DecoderInit(Telemetry_DecoderTypeDef *dec);
+
+/**
+ * @brief  Feed one received byte.
+ * @param  dec: Pointer to decoder state.
+ * @param  byte: Received byte.
+ * @retval Payload length once a valid frame ends (dec->payload holds it),
+ *         0 while the frame is incomplete or was rejected.
+ */
+size_t Telemetry_DecodeByte(Telemetry_DecoderTypeDef *dec, uint8_t byte);
+
+#endif /* _TELEMETRY_FRAME_H_ */
@@ -0,0 +1,44 @@
+#include "Timebase.h"
+
+static TIM_HandleTypeDef *timebase_htim = NULL;
+
+HAL_StatusTypeDef Timebase_Init(TIM_HandleTypeDef *htim)
+{
+    if (htim == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    if (timebase_htim == htim)
+    {
+        return HAL_OK;
+    }
+
+    timebase_htim = htim;
+
+    return HAL_TIM_Base_Start(htim);
+}
+
+uint16_t Timebase_Now_us(void)
+{
+    return (uint16_t)timebase_htim->Instance->CNT;
+}
+
+uint16_t Timebase_Elapsed_us(uint16_t since)
+{
+    return (uint16_t)(timebase_htim->Instance->CNT - since);
+}
+
+void Timebase_Delay_us(uint16_t us)
+{
+    if (timebase_htim == NULL)
+    {
+        /* Not started yet: fall back to the millisecond tick */
+        HAL_Delay((us + 999U) / 1000U);
+        return;
+    }
+
+    uint16_t start = Timebase_Now_us();
+    while (Timebase_Elapsed_us(start) < us)
+        ;
+}
@@ -0,0 +1,65 @@
+/**
+ ******************************************************************************
+ * @file           : Timebase.h
+ * @brief          : Header file for the shared microsecond timebase.
+ *                   Provides a free-running 1 MHz counter with timestamp,
+ *                   elapsed-time and delay primitives.
+ ******************************************************************************
+ * @attention
+ *
+ * The timebase owns one hardware timer (TIM1 on this board) configured with a
+ * 1 MHz tick and a 0xFFFF period. The timer is started once and never
+ * stopped or reset, so any number of drivers can take timestamps from it
+ * concurrently. Timestamps are 16-bit and wrap every 65.536 ms; intervals
+ * are computed with unsigned wrap-around arithmetic and must stay below that.
+ *
+ * Example usage:
+ * @code
+ *   Timebase_Init(&htim1);
+ *
+ *   uint16_t start = Timebase_Now_us();
+ *   while (!done && Timebase_Elapsed_us(start) < 500)
+ *       ;
+ *   Timebase_Delay_us(40);
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _TIMEBASE_H_
+#define _TIMEBASE_H_
+
+#include "stm32f1xx_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Start the free-running timebase. Calling it again is harmless.
+ * @param  htim: Pointer to a timer configured for a 1 MHz tick, 0xFFFF period.
+ * @retval HAL status
+ */
+HAL_StatusTypeDef Timebase_Init(TIM_HandleTypeDef *htim);
+
+/**
+ * @brief  Current timestamp.
+ * @retval Timestamp in microseconds (wraps at 65536)
+ */
+uint16_t Timebase_Now_us(void);
+
+/**
+ * @brief  Time elapsed since a timestamp.
+ * @param  since: Timestamp returned by Timebase_Now_us().
+ * @retval Elapsed microseconds
+ */
+uint16_t Timebase_Elapsed_us(uint16_t since);
+
+/**
+ * @brief  Busy-wait for a number of microseconds.
+ * @param  us: Delay in microseconds (up to 65535).
+ * @retval None
+ */
+void Timebase_Delay_us(uint16_t us);
+
+#endif /* _TIMEBASE_H_ */
@@ -0,0 +1,258 @@
+/**
+ ******************************************************************************
+ * @file           : Sim.h
+ * @brief          : Header file for the host simulator core.
+ *                   Virtual time, simulated interrupts, device attachment
+ *                   points and cost accounting for the host build.
+ ******************************************************************************
+ * @attention
+ *
+ * Time is virtual and counted in nanoseconds. It only moves when the code
+ * under test does something that takes time on the target:
+ *  - reading a clock (HAL_GetTick, Timebase_Now_us, ...) costs
+ *    SIM_POLL_COST_NS of CPU time, so busy-wait loops terminate and their
+ *    cost shows up in the statistics;
+ *  - delays and blocking transfers advance by their duration;
+ *  - the idle hook sleeps until the next simulated interrupt.
+ * While time advances, the peripherals and the attached device models run
+ * every event that falls due (timer overflow, captured edge, end of an I2C
+ * transfer, a sensor edge) in order.
+ *
+ * Interrupt handlers raised by the peripherals run between driver statements,
+ * never nested, and are held back while PRIMASK is set.
+ *
+ * Device models hook in at three points: a pin device drives a GPIO line
+ * through an open-drain output, an I2C device receives the bytes addressed
+ * to it and may answer reads, and any model may register an event source to
+ * be woken at a given time.
+ *
+ * Example usage:
+ * @code
+ *   Sim_Init();
+ *   Sim_DHT22_Init(&sensor, GPIOA, GPIO_PIN_0);
+ *
+ *   Sim_ResetStats();
+ *   DHT22_Read_Raw(&dht22, &reading);
+ *   printf("%lu us of CPU\n", (unsigned long)(Sim_Stats.busyNs / 1000U));
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include "stm32f1xx_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/*                                Sim Constants                               */
+/* -------------------------------------------------------------------------- */
+
+/* CPU time charged for one clock read, a polling loop iteration (~72 cycles) */
+#ifndef SIM_POLL_COST_NS
+#define SIM_POLL_COST_NS 1000U
+#endif
+
+/* Timer kernel clock: TIM1 on APB2, TIM2/3 on APB1 x2 */
+#define SIM_TIMCLK_HZ 72000000U
+
+/* APB1 clock reported to the drivers */
+#define SIM_PCLK1_HZ 36000000U
+
+/* Event time of a source with nothing scheduled */
+#define SIM_NEVER UINT64_MAX
+
+/* Attachment limits */
+#define SIM_MAX_SOURCES 16U
+#define SIM_MAX_PIN_DEVICES 4U
+#define SIM_MAX_I2C_DEVICES 4U
+
+/* -------------------------------------------------------------------------- */
+/*                                 Sim Structs                                */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Cost accounting, reset with Sim_ResetStats()
+ */
+typedef struct
+{
+    uint64_t busyNs;       /*!< CPU time spent running: polling, delays, blocking transfers */
+    uint64_t sleepNs;      /*!< CPU time spent in the idle hook */
+    uint32_t polls;        /*!< Clock reads */
+    uint32_t irqs;         /*!< Interrupt handlers run */
+    uint64_t irqMaxNs;     /*!< Longest interrupt handler, busy-waits in it included */
+    uint32_t timerUpdates; /*!< Timer update interrupts */
+    uint64_t timerRunNs;   /*!< Time timers with interrupts or captures enabled were running */
+    uint32_t captures;     /*!< Edges stored by input capture DMA */
+    uint32_t i2cTransfers; /*!< I2C transactions started */
+    uint32_t i2cBytes;     /*!< Bytes on the I2C bus, address bytes included */
+    uint32_t i2cNacks;     /*!< Transactions not acknowledged */
+    uint64_t i2cBusNs;     /*!< Time the I2C bus was busy */
+} Sim_StatsTypeDef;
+
+/**
+ * @brief  Event source: a model that needs to run at a given virtual time
+ */
+typedef struct
+{
+    uint64_t (*Next)(void *ctx);          /*!< Time of the next event, SIM_NEVER if none */
+    void (*Run)(void *ctx, uint64_t now); /*!< Process everything due at now */
+    void *ctx;                            /*!< Model state */
+} Sim_SourceTypeDef;
+
+/**
+ * @brief  Device driving a GPIO line, wired-AND with the MCU and the pull-up
+ */
+typedef struct
+{
+    uint8_t (*Drive)(void *ctx);                                 /*!< 0 while pulling the line low */
+    void (*LineChanged)(void *ctx, uint8_t level, uint64_t now); /*!< Line level changed, may be NULL */
+} Sim_PinDeviceTypeDef;
+
+/**
+ * @brief  Device on an I2C bus. Receives a write transaction once it ends;
+ *         byte i of data finished shifting at first_ns + i * byte_ns.
+ *         Returns 1 to acknowledge, 0 to NACK.
+ */
+typedef uint8_t (*Sim_I2C_WriteFunc)(void *ctx, const uint8_t *data, uint16_t len, uint64_t first_ns,
+                                     uint64_t byte_ns);
+
+/**
+ * @brief  Device answering a read transaction once it ends: fills len bytes
+ *         of data. Returns 1 to acknowledge, 0 to NACK.
+ */
+typedef uint8_t (*Sim_I2C_ReadFunc)(void *ctx, uint8_t *data, uint16_t len);
+
+/* Cost accounting since the last Sim_ResetStats() */
+extern Sim_StatsTypeDef Sim_Stats;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Reset virtual time, peripherals, attached models and statistics.
+ * @retval None
+ */
+void Sim_Init(void);
+
+/**
+ * @brief  Current virtual time.
+ * @retval Nanoseconds since Sim_Init()
+ */
+uint64_t Sim_Now(void);
+
+/**
+ * @brief  Let the CPU run for a while, processing events on the way.
+ * @param  ns: Duration in nanoseconds.
+ * @retval None
+ */
+void Sim_Busy(uint64_t ns);
+
+/**
+ * @brief  Sleep until an interrupt is raised or the time has passed.
+ * @param  ns: Longest sleep in nanoseconds.
+ * @retval 1 if an interrupt woke the CPU, 0 on timeout.
+ */
+uint8_t Sim_Sleep(uint64_t ns);
+
+/**
+ * @brief  Clear the statistics.
+ * @retval None
+ */
+void Sim_ResetStats(void);
+
+/**
+ * @brief  Register an event source. It stays registered until Sim_Init().
+ * @param  source: Source description, must outlive the simulation.
+ * @retval None
+ */
+void Sim_AddSource(const Sim_SourceTypeDef *source);
+
+/**
+ * @brief  Queue an interrupt handler; it runs as soon as PRIMASK allows.
+ * @param  handler: Handler to call.
+ * @param  arg: Handler argument.
+ * @retval None
+ */
+void Sim_RaiseIrq(void (*handler)(void *arg), void *arg);
+
+/**
+ * @brief  Connect a device to a GPIO pin.
+ * @param  port: GPIO port (GPIOA ...).
+ * @param  pin: Single GPIO_PIN_x.
+ * @param  device: Device callbacks.
+ * @param  ctx: Device state passed to the callbacks.
+ * @retval None
+ */
+void Sim_GPIO_Attach(GPIO_TypeDef *port, uint16_t pin, const Sim_PinDeviceTypeDef *device, void *ctx);
+
+/**
+ * @brief  Recompute the line levels of a port after a device changed its
+ *         drive, notifying devices and capture channels of the edges.
+ * @param  port: GPIO port.
+ * @param  now: Time of the change.
+ * @retval None
+ */
+void Sim_GPIO_Update(GPIO_TypeDef *port, uint64_t now);
+
+/**
+ * @brief  Wire a GPIO pin to a timer capture input (TIM2_CH1 is PA0).
+ * @param  tim: Timer instance (TIM2 ...).
+ * @param  channel: TIM_CHANNEL_x.
+ * @param  port: GPIO port of the input.
+ * @param  pin: Single GPIO_PIN_x.
+ * @param  polarity: TIM_INPUTCHANNELPOLARITY_RISING or _FALLING.
+ * @retval None
+ */
+void Sim_TIM_ConnectCapture(TIM_TypeDef *tim, uint32_t channel, GPIO_TypeDef *port, uint16_t pin,
+                            uint32_t polarity);
+
+/**
+ * @brief  Put a device on an I2C bus.
+ * @param  i2c: I2C instance (I2C1 ...).
+ * @param  addr: 7-bit device address.
+ * @param  write: Write transaction handler.
+ * @param  ctx: Device state passed to the handler.
+ * @retval None
+ */
+void Sim_I2C_Attach(I2C_TypeDef *i2c, uint8_t addr, Sim_I2C_WriteFunc write, void *ctx);
+
+/**
+ * @brief  Let an attached device answer reads; without a handler reads are
+ *         not acknowledged.
+ * @param  i2c: I2C instance (I2C1 ...).
+ * @param  addr: 7-bit address the device was attached at.
+ * @param  read: Read transaction handler, called with the attach context.
+ * @retval None
+ */
+void Sim_I2C_SetReader(I2C_TypeDef *i2c, uint8_t addr, Sim_I2C_ReadFunc read);
+
+/**
+ * @brief  Tell the bus model which GPIO pins carry SCL and SDA. While either
+ *         line is held low the enabled peripheral reads BUSY, and a start
+ *         spends the HAL's 25 ms BUSY flag timeout before HAL_BUSY.
+ * @param  i2c: I2C instance (I2C1 ...).
+ * @param  sclPort: GPIO port of SCL.
+ * @param  sclPin: Single GPIO_PIN_x of SCL.
+ * @param  sdaPort: GPIO port of SDA.
+ * @param  sdaPin: Single GPIO_PIN_x of SDA.
+ * @retval None
+ */
+void Sim_I2C_ConnectPins(I2C_TypeDef *i2c, GPIO_TypeDef *sclPort, uint16_t sclPin, GPIO_TypeDef *sdaPort,
+                         uint16_t sdaPin);
+
+/**
+ * @brief  Make transactions fail: the one on the wire, or else the next one,
+ *         and those after it up to count. With HAL_I2C_ERROR_AF nothing
+ *         reaches the device; HAL_I2C_ERROR_TIMEOUT never completes, as when
+ *         a slave stretches SCL forever; any other code ends the transaction
+ *         with that error.
+ * @param  i2c: I2C instance (I2C1 ...).
+ * @param  error: HAL_I2C_ERROR_xxx code.
+ * @param  count: Transactions to fail.
+ * @retval None
+ */
+void Sim_I2C_InjectFault(I2C_TypeDef *i2c, uint32_t error, uint8_t count);
+
+#endif /* _SIM_H_ */
@@ -0,0 +1,137 @@
+/**
+ ******************************************************************************
+ * @file           : Sim_DHT22.h
+ * @brief          : Header file for the simulated DHT22 sensor.
+ *                   Answers the host start signal on a GPIO line with the
+ *                   datasheet waveform, optionally with injected faults.
+ ******************************************************************************
+ * @attention
+ *
+ * The model watches its line for a low pulse of at least
+ * SIM_DHT22_START_MIN_US from the host. When the host releases the line it
+ * replies after SIM_DHT22_ANSWER_US: 80 us low, 80 us high, then 40 bits of
+ * 50 us low followed by 26 us ('0') or 70 us ('1') high, and a final 50 us
+ * low before letting go. That is DHT22_CAPTURE_EDGES falling edges.
+ *
+ * Example usage:
+ * @code
+ *   Sim_DHT22_TypeDef sensor;
+ *
+ *   Sim_DHT22_Init(&sensor, GPIOA, GPIO_PIN_0);
+ *   Sim_DHT22_Set(&sensor, 455, -102); // 45.5 %, -10.2 C
+ *   DHT22_Read_Raw(&dht22, &reading);
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _SIM_DHT22_H_
+#define _SIM_DHT22_H_
+
+#include "Sim.h"
+
+/* -------------------------------------------------------------------------- */
+/*                             Sim DHT22 Constants                            */
+/* -------------------------------------------------------------------------- */
+
+/* Shortest host low pulse taken as a start signal */
+#define SIM_DHT22_START_MIN_US 1000U
+
+/* Delay from the host release to the sensor answer (datasheet: 20 - 40 us) */
+#define SIM_DHT22_ANSWER_US 30U
+
+/* Waveform timings */
+#define SIM_DHT22_RESPONSE_US 80U /* Response low, then response high */
+#define SIM_DHT22_BIT_LOW_US 50U  /* Low pulse starting every bit */
+#define SIM_DHT22_BIT0_HIGH_US 26U
+#define SIM_DHT22_BIT1_HIGH_US 70U
+
+/* Bits sent before a truncated frame stops */
+#define SIM_DHT22_TRUNCATE_BITS 20U
+
+/* Line transitions of a full frame */
+#define SIM_DHT22_EDGES (2U + 40U * 2U + 2U)
+
+/* Reads closer together than this are counted as early triggers: 2 s less
+ * the 1 ms resolution of the HAL tick the drivers space their reads with */
+#define SIM_DHT22_MIN_INTERVAL_US 1999000U
+
+/* -------------------------------------------------------------------------- */
+/*                              Sim DHT22 Structs                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Injected fault
+ */
+typedef enum
+{
+    SIM_DHT22_FAULT_NONE = 0x00U,     /*!< Correct frames */
+    SIM_DHT22_FAULT_SILENT = 0x01U,   /*!< Never answers */
+    SIM_DHT22_FAULT_CHECKSUM = 0x02U, /*!< Checksum byte off by one */
+    SIM_DHT22_FAULT_TRUNCATE = 0x03U  /*!< Stops after SIM_DHT22_TRUNCATE_BITS bits */
+} Sim_DHT22_FaultTypeDef;
+
+/**
+ * @brief  Simulated sensor state
+ */
+typedef struct
+{
+    GPIO_TypeDef *port;                  /*!< Port of the data line */
+    uint16_t pin;                        /*!< Data line */
+    int16_t humidity;                    /*!< Value to report, 0.1 % */
+    int16_t temperature;                 /*!< Value to report, 0.1 degree Celsius */
+    Sim_DHT22_FaultTypeDef fault;        /*!< Fault applied to the next frames */
+    int8_t skew;                         /*!< Clock error of the sensor, percent of every duration */
+
+    uint8_t driveLow;                    /*!< The sensor pulls the line low */
+    uint64_t lowSince;                   /*!< Start of the host low pulse, SIM_NEVER if none */
+    uint64_t edges[SIM_DHT22_EDGES];     /*!< Times of the frame transitions */
+    uint8_t edgeCount;                   /*!< Transitions in the running frame */
+    uint8_t edgeNext;                    /*!< Next transition to apply */
+    uint64_t lastStart;                  /*!< Time of the previous start signal, SIM_NEVER if none */
+
+    uint32_t frames;                     /*!< Frames sent */
+    uint32_t earlyTriggers;              /*!< Start signals within SIM_DHT22_MIN_INTERVAL_US of the last */
+    Sim_SourceTypeDef source;            /*!< Event source of the waveform */
+} Sim_DHT22_TypeDef;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Attach a sensor to a GPIO line. Call after Sim_Init().
+ * @param  sensor: Sensor state.
+ * @param  port: GPIO port of the data line.
+ * @param  pin: Single GPIO_PIN_x.
+ * @retval None
+ */
+void Sim_DHT22_Init(Sim_DHT22_TypeDef *sensor, GPIO_TypeDef *port, uint16_t pin);
+
+/**
+ * @brief  Set the values reported by the next frames.
+ * @param  sensor: Sensor state.
+ * @param  humidity: Relative humidity in 0.1 %.
+ * @param  temperature: Temperature in 0.1 degree Celsius, may be negative.
+ * @retval None
+ */
+void Sim_DHT22_Set(Sim_DHT22_TypeDef *sensor, int16_t humidity, int16_t temperature);
+
+/**
+ * @brief  Inject a fault into the next frames.
+ * @param  sensor: Sensor state.
+ * @param  fault: SIM_DHT22_FAULT_x.
+ * @retval None
+ */
+void Sim_DHT22_SetFault(Sim_DHT22_TypeDef *sensor, Sim_DHT22_FaultTypeDef fault);
+
+/**
+ * @brief  Run the sensor's clock slow or fast: every waveform duration is
+ *         stretched by percent (negative shortens them).
+ * @param  sensor: Sensor state.
+ * @param  percent: Clock error, -100 < percent.
+ * @retval None
+ */
+void Sim_DHT22_SetSkew(Sim_DHT22_TypeDef *sensor, int8_t percent);
+
+#endif /* _SIM_DHT22_H_ */
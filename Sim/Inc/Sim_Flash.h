@@ -0,0 +1,84 @@
+/**
+ ******************************************************************************
+ * @file           : Sim_Flash.h
+ * @brief          : Header file for the simulated flash region of FlashLog.
+ *                   A RAM array with NOR flash rules and power-loss injection.
+ ******************************************************************************
+ * @attention
+ *
+ * Sim_Flash describes SIM_FLASH_PAGES small pages so a few dozen records
+ * already go around the ring. As on the STM32F1, an erase sets a page to
+ * 0xFF and a half-word can only be programmed while it reads 0xFFFF (or to
+ * 0x0000); anything else fails like a PGERR and leaves the cell alone.
+ *
+ * Sim_Flash_CutAfter() arms a power loss: the given number of half-words are
+ * still programmed, then every program and erase fails until the next
+ * Sim_Flash_CutAfter(SIM_FLASH_NO_CUT). Open the log again with
+ * FlashLog_Init() afterwards, as the firmware does after the reset.
+ * Sim_Flash_ClearBits() clears bits in place, as a half-word program
+ * interrupted halfway or a worn cell would.
+ *
+ * Example usage:
+ * @code
+ *   FlashLog_HandleTypeDef hlog;
+ *
+ *   Sim_Flash_Init();
+ *   FlashLog_Init(&hlog, &Sim_Flash);
+ *   Sim_Flash_CutAfter(7);                  // dies inside the 2nd record
+ *   FlashLog_Flush(&hlog);                  // FLASHLOG_ERROR
+ *   Sim_Flash_CutAfter(SIM_FLASH_NO_CUT);
+ *   FlashLog_Init(&hlog, &Sim_Flash);       // hlog.corrupted == 1
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _SIM_FLASH_H_
+#define _SIM_FLASH_H_
+
+#include "FlashLog.h"
+
+/* -------------------------------------------------------------------------- */
+/*                             Sim Flash Constants                            */
+/* -------------------------------------------------------------------------- */
+
+/* Region geometry: a 12 byte header and 5 records per page */
+#define SIM_FLASH_PAGE_SIZE 64U
+#define SIM_FLASH_PAGES 4U
+
+/* Sim_Flash_CutAfter() argument that disarms the power loss */
+#define SIM_FLASH_NO_CUT UINT32_MAX
+
+/* -------------------------------------------------------------------------- */
+/*                                 Variables                                  */
+/* -------------------------------------------------------------------------- */
+
+/* Simulated region for FlashLog_Init() */
+extern const FlashLog_FlashTypeDef Sim_Flash;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Erase the whole region and disarm the power loss.
+ * @retval None
+ */
+void Sim_Flash_Init(void);
+
+/**
+ * @brief  Lose power after some more half-words have been programmed.
+ * @param  halfwords: Half-words still programmed, SIM_FLASH_NO_CUT for none.
+ * @retval None
+ */
+void Sim_Flash_CutAfter(uint32_t halfwords);
+
+/**
+ * @brief  Clear bits of a programmed half-word in place.
+ * @param  offset: Byte offset of the half-word in the region.
+ * @param  mask: Bits to clear.
+ * @retval None
+ */
+void Sim_Flash_ClearBits(uint32_t offset, uint16_t mask);
+
+#endif /* _SIM_FLASH_H_ */
@@ -0,0 +1,110 @@
+/**
+ ******************************************************************************
+ * @file           : Sim_LCD.h
+ * @brief          : Header file for the simulated I2C character LCD.
+ *                   A PCF8574 expander driving an HD44780 in 4-bit mode.
+ ******************************************************************************
+ * @attention
+ *
+ * Expander wiring: P0 = RS, P1 = RW, P2 = EN, P3 = backlight, P4-P7 = D4-D7.
+ * The controller latches a nibble on every falling EN edge. It powers up in
+ * 8-bit mode (one instruction per strobe, D3-D0 low) and switches to 4-bit
+ * mode on a function set with DL = 0, as the init-by-instruction sequence
+ * requires.
+ *
+ * Every instruction keeps the controller busy for its datasheet execution
+ * time. An instruction that starts while it is still busy, or sooner than
+ * SIM_LCD_POWERUP_US after attachment, is counted as a timing violation and
+ * still executed, so the display contents stay comparable.
+ *
+ * Example usage:
+ * @code
+ *   Sim_LCD_TypeDef model;
+ *   char line[LCD_COLS + 1];
+ *
+ *   Sim_LCD_Init(&model, I2C1, LCD_ADDR);
+ *   LCD_Init(&lcd, &hi2c1, LCD_ADDR);
+ *   LCD_PrintAt(&lcd, 0, 0, "Hello");
+ *   LCD_WaitIdle(&lcd);
+ *   Sim_LCD_ReadLine(&model, 0, line, LCD_COLS);
+ * @endcode
+ *
+ ******************************************************************************
+ */
+
+#ifndef _SIM_LCD_H_
+#define _SIM_LCD_H_
+
+#include "Sim.h"
+
+/* -------------------------------------------------------------------------- */
+/*                              Sim LCD Constants                             */
+/* -------------------------------------------------------------------------- */
+
+/* Expander bits */
+#define SIM_LCD_RS 0x01U
+#define SIM_LCD_EN 0x04U
+#define SIM_LCD_BL 0x08U
+
+/* Controller timings (HD44780 datasheet, fosc = 270 kHz) */
+#define SIM_LCD_POWERUP_US 40000U /* Vcc rise to the first instruction */
+#define SIM_LCD_CLEAR_US 1520U    /* Clear display, return home */
+#define SIM_LCD_EXEC_US 37U       /* Any other instruction or data write */
+
+/* DDRAM: two lines of 40 characters at 0x00 and 0x40 */
+#define SIM_LCD_LINE_LEN 40U
+#define SIM_LCD_LINES 2U
+
+/* -------------------------------------------------------------------------- */
+/*                               Sim LCD Structs                              */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Simulated LCD state
+ */
+typedef struct
+{
+    uint8_t port;                                      /*!< Expander output latch */
+    uint8_t fourBit;                                   /*!< Interface in 4-bit mode */
+    uint8_t highNibble;                                /*!< First nibble of a 4-bit transfer, with RS in bit 0 */
+    uint8_t haveHigh;                                  /*!< highNibble holds a nibble */
+    uint8_t addr;                                      /*!< Address counter, DDRAM or CGRAM */
+    uint8_t cgram;                                     /*!< Address counter points into CGRAM */
+    uint8_t increment;                                 /*!< Entry mode I/D */
+    uint8_t shiftOnWrite;                              /*!< Entry mode S */
+    uint8_t displayOn;                                 /*!< Display control D */
+    uint8_t shift;                                     /*!< Display shift, 0..SIM_LCD_LINE_LEN - 1 */
+    char ddram[SIM_LCD_LINES][SIM_LCD_LINE_LEN];       /*!< Display data RAM */
+    uint8_t cgramData[64];                             /*!< Character generator RAM */
+    uint64_t poweredAt;                                /*!< Time of attachment */
+    uint64_t busyUntil;                                /*!< End of the running instruction */
+
+    uint32_t instructions;                             /*!< Instructions executed */
+    uint32_t writes;                                   /*!< Data bytes written */
+    uint32_t violations;                               /*!< Instructions sent too early */
+} Sim_LCD_TypeDef;
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief  Put an LCD on an I2C bus. Call after Sim_Init(); it powers up now.
+ * @param  lcd: LCD state.
+ * @param  i2c: I2C instance (I2C1 ...).
+ * @param  addr: 7-bit expander address.
+ * @retval None
+ */
+void Sim_LCD_Init(Sim_LCD_TypeDef *lcd, I2C_TypeDef *i2c, uint8_t addr);
+
+/**
+ * @brief  Visible characters of a display row, after the display shift.
+ * @param  lcd: LCD state.
+ * @param  row: Display row.
+ * @param  buf: Receives cols characters and a terminator.
+ * @param  cols: Display width.
+ * @retval None
+ */
+void Sim_LCD_ReadLine(const Sim_LCD_TypeDef *lcd, uint8_t row, char *buf, uint8_t cols);
+
+#endif /* _SIM_LCD_H_ */
@@ -0,0 +1,31 @@
+/**
+ ******************************************************************************
+ * @file           : cmsis_compiler.h
+ * @brief          : Host stand-in for the CMSIS core intrinsics.
+ *                   Interrupt masking and wait-for-interrupt act on the
+ *                   simulator instead of the Cortex-M3.
+ ******************************************************************************
+ * @attention
+ *
+ * Simulated interrupts only run between driver statements, when virtual
+ * time advances. While PRIMASK is set they stay pending and run as soon as
+ * it is cleared, as on the target.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __CMSIS_COMPILER_H
+#define __CMSIS_COMPILER_H
+
+#include <stdint.h>
+
+#define __STATIC_INLINE static inline
+#define __NOP() ((void)0)
+
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+void __disable_irq(void);
+void __enable_irq(void);
+void __WFI(void);
+
+#endif /* __CMSIS_COMPILER_H */
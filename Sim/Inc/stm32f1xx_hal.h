@@ -0,0 +1,394 @@
+/**
+ ******************************************************************************
+ * @file           : stm32f1xx_hal.h
+ * @brief          : Host stand-in for the STM32F1 HAL used by the drivers.
+ *                   Declares the subset of types, register blocks, macros and
+ *                   functions "My Library" relies on, backed by the simulator.
+ ******************************************************************************
+ * @attention
+ *
+ * Only the host build (DHT22_HOST_SIM) puts this directory before the real
+ * HAL includes. Register blocks keep the layout and field names of the
+ * device header so drivers that poke registers directly (GPIO IDR/BSRR/CRL,
+ * TIM CNT, DMA CNDTR, I2C SR2/CCR) compile unchanged; the peripheral
+ * instances are plain objects in Sim_HAL.c that the simulator keeps in step
+ * with virtual time.
+ *
+ * Macro values follow stm32f103xb.h and the HAL module headers, so constants
+ * a driver stores (channels, flags, duty cycles) mean the same on both sides.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __STM32F1xx_HAL_H
+#define __STM32F1xx_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cmsis_compiler.h"
+
+/* -------------------------------------------------------------------------- */
+/*                                   Common                                   */
+/* -------------------------------------------------------------------------- */
+
+#define __IO volatile
+#define __I volatile const
+
+typedef enum
+{
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+#define UNUSED(X) (void)X
+
+#define SET_BIT(REG, BIT) ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT) ((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT) ((REG) & (BIT))
+#define WRITE_REG(REG, VAL) ((REG) = (VAL))
+#define READ_REG(REG) ((REG))
+#define MODIFY_REG(REG, CLEARMASK, SETMASK) WRITE_REG((REG), (((READ_REG(REG)) & (~(CLEARMASK))) | (SETMASK)))
+#define POSITION_VAL(VAL) ((uint32_t)__builtin_ctz(VAL))
+
+/* -------------------------------------------------------------------------- */
+/*                              Register Blocks                               */
+/* -------------------------------------------------------------------------- */
+
+typedef struct
+{
+    __IO uint32_t CRL;
+    __IO uint32_t CRH;
+    __IO uint32_t IDR;
+    __IO uint32_t ODR;
+    __IO uint32_t BSRR;
+    __IO uint32_t BRR;
+    __IO uint32_t LCKR;
+} GPIO_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t CR1;
+    __IO uint32_t CR2;
+    __IO uint32_t SMCR;
+    __IO uint32_t DIER;
+    __IO uint32_t SR;
+    __IO uint32_t EGR;
+    __IO uint32_t CCMR1;
+    __IO uint32_t CCMR2;
+    __IO uint32_t CCER;
+    __IO uint32_t CNT;
+    __IO uint32_t PSC;
+    __IO uint32_t ARR;
+    __IO uint32_t RCR;
+    __IO uint32_t CCR1;
+    __IO uint32_t CCR2;
+    __IO uint32_t CCR3;
+    __IO uint32_t CCR4;
+    __IO uint32_t BDTR;
+    __IO uint32_t DCR;
+    __IO uint32_t DMAR;
+    __IO uint32_t OR;
+} TIM_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t CCR;
+    __IO uint32_t CNDTR;
+    __IO uint32_t CPAR;
+    __IO uint32_t CMAR;
+} DMA_Channel_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t CR1;
+    __IO uint32_t CR2;
+    __IO uint32_t OAR1;
+    __IO uint32_t OAR2;
+    __IO uint32_t DR;
+    __IO uint32_t SR1;
+    __IO uint32_t SR2;
+    __IO uint32_t CCR;
+    __IO uint32_t TRISE;
+} I2C_TypeDef;
+
+/* Simulated peripheral instances, see Sim_HAL.c */
+extern GPIO_TypeDef Sim_GPIO[3];
+extern TIM_TypeDef Sim_TIM[3];
+extern DMA_Channel_TypeDef Sim_DMA1_Channel[7];
+extern I2C_TypeDef Sim_I2C[2];
+
+#define GPIOA (&Sim_GPIO[0])
+#define GPIOB (&Sim_GPIO[1])
+#define GPIOC (&Sim_GPIO[2])
+#define TIM1 (&Sim_TIM[0])
+#define TIM2 (&Sim_TIM[1])
+#define TIM3 (&Sim_TIM[2])
+#define DMA1_Channel1 (&Sim_DMA1_Channel[0])
+#define DMA1_Channel2 (&Sim_DMA1_Channel[1])
+#define DMA1_Channel3 (&Sim_DMA1_Channel[2])
+#define DMA1_Channel4 (&Sim_DMA1_Channel[3])
+#define DMA1_Channel5 (&Sim_DMA1_Channel[4])
+#define DMA1_Channel6 (&Sim_DMA1_Channel[5])
+#define DMA1_Channel7 (&Sim_DMA1_Channel[6])
+#define I2C1 (&Sim_I2C[0])
+#define I2C2 (&Sim_I2C[1])
+
+/* -------------------------------------------------------------------------- */
+/*                                    GPIO                                    */
+/* -------------------------------------------------------------------------- */
+
+#define GPIO_PIN_0 ((uint16_t)0x0001)
+#define GPIO_PIN_1 ((uint16_t)0x0002)
+#define GPIO_PIN_2 ((uint16_t)0x0004)
+#define GPIO_PIN_3 ((uint16_t)0x0008)
+#define GPIO_PIN_4 ((uint16_t)0x0010)
+#define GPIO_PIN_5 ((uint16_t)0x0020)
+#define GPIO_PIN_6 ((uint16_t)0x0040)
+#define GPIO_PIN_7 ((uint16_t)0x0080)
+#define GPIO_PIN_8 ((uint16_t)0x0100)
+#define GPIO_PIN_9 ((uint16_t)0x0200)
+#define GPIO_PIN_10 ((uint16_t)0x0400)
+#define GPIO_PIN_11 ((uint16_t)0x0800)
+#define GPIO_PIN_12 ((uint16_t)0x1000)
+#define GPIO_PIN_13 ((uint16_t)0x2000)
+#define GPIO_PIN_14 ((uint16_t)0x4000)
+#define GPIO_PIN_15 ((uint16_t)0x8000)
+
+#define GPIO_MODE_INPUT 0x00000000U
+#define GPIO_MODE_OUTPUT_PP 0x00000001U
+#define GPIO_MODE_OUTPUT_OD 0x00000011U
+
+#define GPIO_NOPULL 0x00000000U
+#define GPIO_PULLUP 0x00000001U
+#define GPIO_PULLDOWN 0x00000002U
+
+#define GPIO_SPEED_FREQ_LOW 0x00000002U
+#define GPIO_SPEED_FREQ_HIGH 0x00000003U
+
+typedef enum
+{
+    GPIO_PIN_RESET = 0U,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct
+{
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+} GPIO_InitTypeDef;
+
+/* -------------------------------------------------------------------------- */
+/*                                    DMA                                     */
+/* -------------------------------------------------------------------------- */
+
+typedef struct
+{
+    DMA_Channel_TypeDef *Instance;
+    void *Parent;
+} DMA_HandleTypeDef;
+
+#define __HAL_DMA_GET_COUNTER(__HANDLE__) ((__HANDLE__)->Instance->CNDTR)
+
+/* -------------------------------------------------------------------------- */
+/*                                    TIM                                     */
+/* -------------------------------------------------------------------------- */
+
+#define TIM_CHANNEL_1 0x00000000U
+#define TIM_CHANNEL_2 0x00000004U
+#define TIM_CHANNEL_3 0x00000008U
+#define TIM_CHANNEL_4 0x0000000CU
+
+#define TIM_DMA_ID_UPDATE ((uint16_t)0x0000)
+#define TIM_DMA_ID_CC1 ((uint16_t)0x0001)
+#define TIM_DMA_ID_CC2 ((uint16_t)0x0002)
+#define TIM_DMA_ID_CC3 ((uint16_t)0x0003)
+#define TIM_DMA_ID_CC4 ((uint16_t)0x0004)
+#define TIM_DMA_ID_COMMUTATION ((uint16_t)0x0005)
+#define TIM_DMA_ID_TRIGGER ((uint16_t)0x0006)
+
+#define TIM_CR1_CEN 0x00000001U
+#define TIM_DIER_UIE 0x00000001U
+#define TIM_FLAG_UPDATE 0x00000001U
+
+#define TIM_INPUTCHANNELPOLARITY_RISING 0x00000000U
+#define TIM_INPUTCHANNELPOLARITY_FALLING 0x00000002U
+
+typedef enum
+{
+    HAL_TIM_ACTIVE_CHANNEL_1 = 0x01U,
+    HAL_TIM_ACTIVE_CHANNEL_2 = 0x02U,
+    HAL_TIM_ACTIVE_CHANNEL_3 = 0x04U,
+    HAL_TIM_ACTIVE_CHANNEL_4 = 0x08U,
+    HAL_TIM_ACTIVE_CHANNEL_CLEARED = 0x00U
+} HAL_TIM_ActiveChannel;
+
+typedef struct
+{
+    uint32_t Prescaler;
+    uint32_t CounterMode;
+    uint32_t Period;
+    uint32_t ClockDivision;
+    uint32_t RepetitionCounter;
+    uint32_t AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+
+typedef struct
+{
+    TIM_TypeDef *Instance;
+    TIM_Base_InitTypeDef Init;
+    HAL_TIM_ActiveChannel Channel;
+    DMA_HandleTypeDef *hdma[7];
+} TIM_HandleTypeDef;
+
+#define __HAL_TIM_SET_COUNTER(__HANDLE__, __COUNTER__) ((__HANDLE__)->Instance->CNT = (__COUNTER__))
+#define __HAL_TIM_GET_COUNTER(__HANDLE__) ((__HANDLE__)->Instance->CNT)
+#define __HAL_TIM_GET_AUTORELOAD(__HANDLE__) ((__HANDLE__)->Instance->ARR)
+#define __HAL_TIM_CLEAR_FLAG(__HANDLE__, __FLAG__) ((__HANDLE__)->Instance->SR = ~(__FLAG__))
+
+/* -------------------------------------------------------------------------- */
+/*                                    I2C                                     */
+/* -------------------------------------------------------------------------- */
+
+#define I2C_CR1_PE 0x00000001U
+#define I2C_SR2_BUSY 0x00000002U
+#define I2C_CCR_CCR 0x00000FFFU
+#define I2C_CCR_DUTY 0x00004000U
+#define I2C_CCR_FS 0x00008000U
+#define I2C_TRISE_TRISE 0x0000003FU
+
+#define I2C_DUTYCYCLE_2 0x00000000U
+#define I2C_DUTYCYCLE_16_9 I2C_CCR_DUTY
+
+#define HAL_I2C_ERROR_NONE 0x00000000U
+#define HAL_I2C_ERROR_BERR 0x00000001U
+#define HAL_I2C_ERROR_ARLO 0x00000002U
+#define HAL_I2C_ERROR_AF 0x00000004U
+#define HAL_I2C_ERROR_TIMEOUT 0x00000020U
+
+#define I2C_MEMADD_SIZE_8BIT 0x00000001U
+#define I2C_MEMADD_SIZE_16BIT 0x00000010U
+#define I2C_FIRST_FRAME 0x00000001U
+#define I2C_FIRST_AND_LAST_FRAME 0x00000008U
+#define I2C_LAST_FRAME 0x00000020U
+
+#define I2C_MIN_PCLK_FREQ_STANDARD 2000000U
+#define I2C_MIN_PCLK_FREQ_FAST 4000000U
+#define I2C_MIN_PCLK_FREQ(__PCLK__, __SPEED__)                                                                        \
+    (((__SPEED__) <= 100000U) ? ((__PCLK__) < I2C_MIN_PCLK_FREQ_STANDARD) : ((__PCLK__) < I2C_MIN_PCLK_FREQ_FAST))
+#define I2C_CCR_CALCULATION(__PCLK__, __SPEED__, __COEFF__)                                                           \
+    (((((__PCLK__) - 1U) / ((__SPEED__) * (__COEFF__))) + 1U) & I2C_CCR_CCR)
+#define I2C_FREQRANGE(__PCLK__) ((__PCLK__) / 1000000U)
+#define I2C_RISE_TIME(__FREQRANGE__, __SPEED__)                                                                       \
+    (((__SPEED__) <= 100000U) ? ((__FREQRANGE__) + 1U) : ((((__FREQRANGE__) * 300U) / 1000U) + 1U))
+#define I2C_SPEED_STANDARD(__PCLK__, __SPEED__)                                                                       \
+    ((I2C_CCR_CALCULATION((__PCLK__), (__SPEED__), 2U) < 4U) ? 4U : I2C_CCR_CALCULATION((__PCLK__), (__SPEED__), 2U))
+#define I2C_SPEED_FAST(__PCLK__, __SPEED__, __DUTYCYCLE__)                                                            \
+    (((__DUTYCYCLE__) == I2C_DUTYCYCLE_2) ? I2C_CCR_CALCULATION((__PCLK__), (__SPEED__), 3U)                         \
+                                          : (I2C_CCR_CALCULATION((__PCLK__), (__SPEED__), 25U) | I2C_DUTYCYCLE_16_9))
+#define I2C_SPEED(__PCLK__, __SPEED__, __DUTYCYCLE__)                                                                 \
+    (((__SPEED__) <= 100000U) ? (I2C_SPEED_STANDARD((__PCLK__), (__SPEED__)))                                        \
+     : ((I2C_SPEED_FAST((__PCLK__), (__SPEED__), (__DUTYCYCLE__)) & I2C_CCR_CCR) == 0U)                             \
+         ? 1U                                                                                                         \
+         : ((I2C_SPEED_FAST((__PCLK__), (__SPEED__), (__DUTYCYCLE__))) | I2C_CCR_FS))
+
+#define IS_I2C_DUTY_CYCLE(CYCLE) (((CYCLE) == I2C_DUTYCYCLE_2) || ((CYCLE) == I2C_DUTYCYCLE_16_9))
+#define IS_I2C_CLOCK_SPEED(SPEED) (((SPEED) > 0U) && ((SPEED) <= 400000U))
+
+typedef enum
+{
+    HAL_I2C_STATE_RESET = 0x00U,
+    HAL_I2C_STATE_READY = 0x20U,
+    HAL_I2C_STATE_BUSY = 0x24U,
+    HAL_I2C_STATE_BUSY_TX = 0x21U,
+    HAL_I2C_STATE_BUSY_RX = 0x22U,
+    HAL_I2C_STATE_ERROR = 0xE0U
+} HAL_I2C_StateTypeDef;
+
+typedef struct
+{
+    uint32_t ClockSpeed;
+    uint32_t DutyCycle;
+    uint32_t OwnAddress1;
+    uint32_t AddressingMode;
+    uint32_t DualAddressMode;
+    uint32_t OwnAddress2;
+    uint32_t GeneralCallMode;
+    uint32_t NoStretchMode;
+} I2C_InitTypeDef;
+
+typedef struct
+{
+    I2C_TypeDef *Instance;
+    I2C_InitTypeDef Init;
+    uint8_t *pBuffPtr;
+    uint16_t XferSize;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    __IO HAL_I2C_StateTypeDef State;
+    __IO uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+
+#define __HAL_I2C_ENABLE(__HANDLE__) SET_BIT((__HANDLE__)->Instance->CR1, I2C_CR1_PE)
+#define __HAL_I2C_DISABLE(__HANDLE__) CLEAR_BIT((__HANDLE__)->Instance->CR1, I2C_CR1_PE)
+
+/* -------------------------------------------------------------------------- */
+/*                            Function Prototypes                             */
+/* -------------------------------------------------------------------------- */
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_IC_Start_DMA(TIM_HandleTypeDef *htim, uint32_t Channel, uint32_t *pData, uint16_t Length);
+HAL_StatusTypeDef HAL_TIM_IC_Stop_DMA(TIM_HandleTypeDef *htim, uint32_t Channel);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim);
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size,
+                                          uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                             uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                              uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                                 uint16_t Size, uint32_t XferOptions);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                                  uint16_t Size, uint32_t XferOptions);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                                uint16_t Size, uint32_t XferOptions);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                                 uint16_t Size, uint32_t XferOptions);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                        uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                      uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c);
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+#endif /* __STM32F1xx_HAL_H */
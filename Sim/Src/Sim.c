@@ -0,0 +1,227 @@
+#include "Sim.h"
+#include <string.h>
+
+/* Interrupts raised and not yet run, a power of two */
+#define SIM_IRQ_QUEUE_SIZE 16U
+#define SIM_IRQ_QUEUE_MASK (SIM_IRQ_QUEUE_SIZE - 1U)
+
+/* SysTick period, WFI never sleeps past it */
+#define SIM_SYSTICK_NS 1000000U
+
+typedef struct
+{
+    void (*handler)(void *arg);
+    void *arg;
+} Sim_IrqTypeDef;
+
+Sim_StatsTypeDef Sim_Stats;
+
+static uint64_t sim_now;
+static const Sim_SourceTypeDef *sim_sources[SIM_MAX_SOURCES];
+static uint8_t sim_sourceCount;
+static Sim_IrqTypeDef sim_irqs[SIM_IRQ_QUEUE_SIZE];
+static uint8_t sim_irqHead;
+static uint8_t sim_irqTail;
+static uint32_t sim_primask;
+static uint8_t sim_inIrq;
+static uint32_t sim_raised;
+
+/* Peripherals of Sim_HAL.c, re-registered on every Sim_Init() */
+void Sim_HAL_Reset(void);
+
+/* Timebase_Sim.c, restarted with the timers */
+void Timebase_Sim_Reset(void);
+
+static void Sim_RunSources(void)
+{
+    for (uint8_t i = 0; i < sim_sourceCount; i++)
+    {
+        sim_sources[i]->Run(sim_sources[i]->ctx, sim_now);
+    }
+}
+
+static uint64_t Sim_NextEvent(void)
+{
+    uint64_t next = SIM_NEVER;
+
+    for (uint8_t i = 0; i < sim_sourceCount; i++)
+    {
+        uint64_t t = sim_sources[i]->Next(sim_sources[i]->ctx);
+        if (t < next)
+        {
+            next = t;
+        }
+    }
+    return next;
+}
+
+/* Run pending handlers in order; one level only, all NVIC priorities are equal */
+static void Sim_DispatchIrqs(void)
+{
+    if (sim_primask != 0U || sim_inIrq)
+    {
+        return;
+    }
+
+    sim_inIrq = 1;
+    while (sim_irqHead != sim_irqTail)
+    {
+        Sim_IrqTypeDef irq = sim_irqs[sim_irqTail & SIM_IRQ_QUEUE_MASK];
+        sim_irqTail++;
+        Sim_Stats.irqs++;
+        uint64_t entry = sim_now;
+        irq.handler(irq.arg);
+        if (sim_now - entry > Sim_Stats.irqMaxNs)
+        {
+            Sim_Stats.irqMaxNs = sim_now - entry;
+        }
+        // The handler may have written registers: let the models see it now
+        Sim_RunSources();
+    }
+    sim_inIrq = 0;
+}
+
+/* Move to target through every event on the way. With wake set, stop at the
+ * first event that raises an interrupt. Returns 1 in that case. */
+static uint8_t Sim_AdvanceTo(uint64_t target, uint8_t wake)
+{
+    // Register writes made since the last step happened at the current time
+    Sim_RunSources();
+    Sim_DispatchIrqs();
+
+    uint32_t raised = sim_raised;
+    for (;;)
+    {
+        uint64_t next = Sim_NextEvent();
+        if (next > target)
+        {
+            break;
+        }
+        if (next > sim_now)
+        {
+            sim_now = next;
+        }
+        Sim_RunSources();
+        Sim_DispatchIrqs();
+        if (wake && sim_raised != raised)
+        {
+            return 1;
+        }
+    }
+
+    // A handler run on the way may have spent time past target itself
+    if (target > sim_now)
+    {
+        sim_now = target;
+    }
+    Sim_RunSources();
+    Sim_DispatchIrqs();
+    return 0;
+}
+
+void Sim_Init(void)
+{
+    sim_now = 0;
+    sim_sourceCount = 0;
+    sim_irqHead = 0;
+    sim_irqTail = 0;
+    sim_primask = 0;
+    sim_inIrq = 0;
+    sim_raised = 0;
+    Sim_ResetStats();
+
+    Sim_HAL_Reset();
+    Timebase_Sim_Reset();
+}
+
+uint64_t Sim_Now(void)
+{
+    return sim_now;
+}
+
+void Sim_Busy(uint64_t ns)
+{
+    Sim_Stats.busyNs += ns;
+    Sim_AdvanceTo(sim_now + ns, 0);
+}
+
+uint8_t Sim_Sleep(uint64_t ns)
+{
+    uint64_t start = sim_now;
+    uint8_t woken = 1;
+
+    // WFI returns at once when an interrupt is already pending, masked or not
+    if (sim_irqHead == sim_irqTail)
+    {
+        woken = Sim_AdvanceTo(sim_now + ns, 1);
+    }
+    Sim_Stats.sleepNs += sim_now - start;
+
+    return woken;
+}
+
+void Sim_ResetStats(void)
+{
+    memset(&Sim_Stats, 0, sizeof(Sim_Stats));
+}
+
+void Sim_AddSource(const Sim_SourceTypeDef *source)
+{
+    if (sim_sourceCount < SIM_MAX_SOURCES)
+    {
+        sim_sources[sim_sourceCount++] = source;
+    }
+}
+
+void Sim_RaiseIrq(void (*handler)(void *arg), void *arg)
+{
+    sim_raised++;
+
+    // Raised again before it ran: the NVIC keeps a single pending bit
+    for (uint8_t i = sim_irqTail; i != sim_irqHead; i++)
+    {
+        Sim_IrqTypeDef *irq = &sim_irqs[i & SIM_IRQ_QUEUE_MASK];
+        if (irq->handler == handler && irq->arg == arg)
+        {
+            return;
+        }
+    }
+    if ((uint8_t)(sim_irqHead - sim_irqTail) >= SIM_IRQ_QUEUE_SIZE)
+    {
+        return;
+    }
+    sim_irqs[sim_irqHead & SIM_IRQ_QUEUE_MASK].handler = handler;
+    sim_irqs[sim_irqHead & SIM_IRQ_QUEUE_MASK].arg = arg;
+    sim_irqHead++;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              CMSIS intrinsics                              */
+/* -------------------------------------------------------------------------- */
+
+uint32_t __get_PRIMASK(void)
+{
+    return sim_primask;
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+    sim_primask = priMask & 1U;
+    Sim_DispatchIrqs();
+}
+
+void __disable_irq(void)
+{
+    sim_primask = 1;
+}
+
+void __enable_irq(void)
+{
+    __set_PRIMASK(0);
+}
+
+void __WFI(void)
+{
+    // SysTick wakes the core every millisecond
+    Sim_Sleep(SIM_SYSTICK_NS - (sim_now % SIM_SYSTICK_NS));
+}
@@ -0,0 +1,150 @@
+#include "Sim_DHT22.h"
+
+static uint8_t Sim_DHT22_Drive(void *ctx)
+{
+    return ((Sim_DHT22_TypeDef *)ctx)->driveLow ? 0U : 1U;
+}
+
+/* Duration in ns of a datasheet time, stretched by the sensor's clock skew */
+static uint64_t Sim_DHT22_Ns(const Sim_DHT22_TypeDef *sensor, uint32_t us)
+{
+    return (uint64_t)us * 10U * (uint64_t)(100 + sensor->skew);
+}
+
+/* Lay out the transitions of a frame answering a release at now */
+static void Sim_DHT22_BuildFrame(Sim_DHT22_TypeDef *sensor, uint64_t now)
+{
+    uint16_t humidity = (uint16_t)sensor->humidity;
+    uint16_t temperature = (sensor->temperature < 0) ? (uint16_t)(0x8000U | (uint16_t)(-sensor->temperature))
+                                                     : (uint16_t)sensor->temperature;
+    uint8_t data[5];
+    uint64_t t = now + Sim_DHT22_Ns(sensor, SIM_DHT22_ANSWER_US);
+    uint8_t n = 0;
+
+    data[0] = (uint8_t)(humidity >> 8);
+    data[1] = (uint8_t)humidity;
+    data[2] = (uint8_t)(temperature >> 8);
+    data[3] = (uint8_t)temperature;
+    data[4] = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+    if (sensor->fault == SIM_DHT22_FAULT_CHECKSUM)
+    {
+        data[4]++;
+    }
+
+    uint8_t bits = (sensor->fault == SIM_DHT22_FAULT_TRUNCATE) ? SIM_DHT22_TRUNCATE_BITS : 40U;
+
+    // Even entries pull the line low, odd ones release it
+    sensor->edges[n++] = t;
+    t += Sim_DHT22_Ns(sensor, SIM_DHT22_RESPONSE_US);
+    sensor->edges[n++] = t;
+    t += Sim_DHT22_Ns(sensor, SIM_DHT22_RESPONSE_US);
+    for (uint8_t i = 0; i < bits; i++)
+    {
+        uint8_t bit = (data[i / 8U] >> (7U - (i % 8U))) & 1U;
+        sensor->edges[n++] = t;
+        t += Sim_DHT22_Ns(sensor, SIM_DHT22_BIT_LOW_US);
+        sensor->edges[n++] = t;
+        t += Sim_DHT22_Ns(sensor, bit ? SIM_DHT22_BIT1_HIGH_US : SIM_DHT22_BIT0_HIGH_US);
+    }
+    if (bits == 40U)
+    {
+        sensor->edges[n++] = t;
+        t += Sim_DHT22_Ns(sensor, SIM_DHT22_BIT_LOW_US);
+        sensor->edges[n++] = t;
+    }
+
+    sensor->edgeCount = n;
+    sensor->edgeNext = 0;
+    sensor->frames++;
+}
+
+static void Sim_DHT22_LineChanged(void *ctx, uint8_t level, uint64_t now)
+{
+    Sim_DHT22_TypeDef *sensor = (Sim_DHT22_TypeDef *)ctx;
+
+    if (sensor->edgeNext < sensor->edgeCount || sensor->driveLow)
+    {
+        return; // Our own frame on the line
+    }
+
+    if (level == 0U)
+    {
+        sensor->lowSince = now;
+        return;
+    }
+
+    uint64_t start = sensor->lowSince;
+    sensor->lowSince = SIM_NEVER;
+    if (start == SIM_NEVER || now - start < SIM_DHT22_START_MIN_US * 1000U)
+    {
+        return;
+    }
+
+    if (sensor->lastStart != SIM_NEVER && start - sensor->lastStart < SIM_DHT22_MIN_INTERVAL_US * 1000U)
+    {
+        sensor->earlyTriggers++;
+    }
+    sensor->lastStart = start;
+
+    if (sensor->fault != SIM_DHT22_FAULT_SILENT)
+    {
+        Sim_DHT22_BuildFrame(sensor, now);
+    }
+}
+
+static uint64_t Sim_DHT22_Next(void *ctx)
+{
+    Sim_DHT22_TypeDef *sensor = (Sim_DHT22_TypeDef *)ctx;
+    return (sensor->edgeNext < sensor->edgeCount) ? sensor->edges[sensor->edgeNext] : SIM_NEVER;
+}
+
+static void Sim_DHT22_Run(void *ctx, uint64_t now)
+{
+    Sim_DHT22_TypeDef *sensor = (Sim_DHT22_TypeDef *)ctx;
+
+    while (sensor->edgeNext < sensor->edgeCount && sensor->edges[sensor->edgeNext] <= now)
+    {
+        sensor->driveLow = ((sensor->edgeNext & 1U) == 0U) ? 1U : 0U;
+        sensor->edgeNext++;
+        Sim_GPIO_Update(sensor->port, now);
+    }
+}
+
+static const Sim_PinDeviceTypeDef sim_dht22_device = {Sim_DHT22_Drive, Sim_DHT22_LineChanged};
+
+void Sim_DHT22_Init(Sim_DHT22_TypeDef *sensor, GPIO_TypeDef *port, uint16_t pin)
+{
+    sensor->port = port;
+    sensor->pin = pin;
+    sensor->humidity = 0;
+    sensor->temperature = 0;
+    sensor->fault = SIM_DHT22_FAULT_NONE;
+    sensor->skew = 0;
+    sensor->driveLow = 0;
+    sensor->lowSince = SIM_NEVER;
+    sensor->edgeCount = 0;
+    sensor->edgeNext = 0;
+    sensor->lastStart = SIM_NEVER;
+    sensor->frames = 0;
+    sensor->earlyTriggers = 0;
+    sensor->source = (Sim_SourceTypeDef){Sim_DHT22_Next, Sim_DHT22_Run, sensor};
+
+    Sim_GPIO_Attach(port, pin, &sim_dht22_device, sensor);
+    Sim_AddSource(&sensor->source);
+}
+
+void Sim_DHT22_Set(Sim_DHT22_TypeDef *sensor, int16_t humidity, int16_t temperature)
+{
+    sensor->humidity = humidity;
+    sensor->temperature = temperature;
+}
+
+void Sim_DHT22_SetFault(Sim_DHT22_TypeDef *sensor, Sim_DHT22_FaultTypeDef fault)
+{
+    sensor->fault = fault;
+}
+
+void Sim_DHT22_SetSkew(Sim_DHT22_TypeDef *sensor, int8_t percent)
+{
+    sensor->skew = percent;
+}
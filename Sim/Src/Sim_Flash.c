@@ -0,0 +1,73 @@
+#include "Sim_Flash.h"
+#include <string.h>
+
+static uint8_t sim_flash[SIM_FLASH_PAGES * SIM_FLASH_PAGE_SIZE];
+static uint32_t sim_flashBudget = SIM_FLASH_NO_CUT;
+
+static uint16_t Sim_Flash_Read16(uint32_t offset)
+{
+    return (uint16_t)(sim_flash[offset] | (sim_flash[offset + 1U] << 8));
+}
+
+static void Sim_Flash_Write16(uint32_t offset, uint16_t value)
+{
+    sim_flash[offset] = (uint8_t)value;
+    sim_flash[offset + 1U] = (uint8_t)(value >> 8);
+}
+
+static FlashLog_StatusTypeDef Sim_Flash_Erase(uint32_t offset)
+{
+    if (sim_flashBudget == 0U || offset % SIM_FLASH_PAGE_SIZE != 0U || offset >= sizeof(sim_flash))
+    {
+        return FLASHLOG_ERROR;
+    }
+    memset(&sim_flash[offset], 0xFF, SIM_FLASH_PAGE_SIZE);
+    return FLASHLOG_OK;
+}
+
+static FlashLog_StatusTypeDef Sim_Flash_Program(uint32_t offset, const uint16_t *data, uint16_t count)
+{
+    if ((offset & 1U) != 0U || offset + 2U * count > sizeof(sim_flash))
+    {
+        return FLASHLOG_ERROR;
+    }
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        uint32_t at = offset + 2U * i;
+        if (sim_flashBudget == 0U || (Sim_Flash_Read16(at) != 0xFFFFU && data[i] != 0x0000U))
+        {
+            return FLASHLOG_ERROR;
+        }
+        if (sim_flashBudget != SIM_FLASH_NO_CUT)
+        {
+            sim_flashBudget--;
+        }
+        Sim_Flash_Write16(at, data[i]);
+    }
+    return FLASHLOG_OK;
+}
+
+const FlashLog_FlashTypeDef Sim_Flash = {
+    .mem = sim_flash,
+    .pageSize = SIM_FLASH_PAGE_SIZE,
+    .pageCount = SIM_FLASH_PAGES,
+    .Erase = Sim_Flash_Erase,
+    .Program = Sim_Flash_Program,
+};
+
+void Sim_Flash_Init(void)
+{
+    memset(sim_flash, 0xFF, sizeof(sim_flash));
+    sim_flashBudget = SIM_FLASH_NO_CUT;
+}
+
+void Sim_Flash_CutAfter(uint32_t halfwords)
+{
+    sim_flashBudget = halfwords;
+}
+
+void Sim_Flash_ClearBits(uint32_t offset, uint16_t mask)
+{
+    Sim_Flash_Write16(offset, (uint16_t)(Sim_Flash_Read16(offset) & ~mask));
+}
@@ -0,0 +1,1173 @@
+#include "Sim.h"
+#include <string.h>
+
+/* GPIO CRL/CRH reset value: every pin a floating input */
+#define SIM_GPIO_CR_RESET 0x44444444U
+
+/* I2C transactions longer than this are cut, the LCD queue sends up to 255 */
+#define SIM_I2C_MAX_LEN 1024U
+
+/* I2C_TIMEOUT_BUSY_FLAG of the HAL: how long a start polls a busy bus */
+#define SIM_I2C_BUSY_FLAG_NS 25000000ULL
+
+/* I2C_TIMEOUT_FLAG of the HAL: how long the register calls poll SB, ADDR, TXE */
+#define SIM_I2C_FLAG_NS 35000000ULL
+
+typedef struct
+{
+    uint16_t pin;
+    const Sim_PinDeviceTypeDef *device;
+    void *ctx;
+} Sim_PinAttachTypeDef;
+
+typedef struct
+{
+    GPIO_TypeDef *regs;
+    Sim_PinAttachTypeDef devices[SIM_MAX_PIN_DEVICES];
+    uint8_t deviceCount;
+    Sim_SourceTypeDef source;
+} Sim_PortTypeDef;
+
+typedef struct
+{
+    GPIO_TypeDef *port;   /* Input pin, NULL if the channel is not wired */
+    uint16_t pin;
+    uint32_t polarity;
+    uint8_t armed;        /* Capture DMA running */
+    uint16_t *buffer;
+    uint16_t index;
+} Sim_CaptureTypeDef;
+
+typedef struct
+{
+    TIM_TypeDef *regs;
+    TIM_HandleTypeDef *htim; /* Handle of the last HAL call, passed to the callbacks */
+    uint8_t running;
+    uint64_t origin;         /* Time CNT was last set or the timer started */
+    uint32_t originCnt;      /* CNT at origin */
+    uint32_t shownCnt;       /* CNT as last written by the simulator */
+    uint64_t wraps;          /* Overflows since origin */
+    uint64_t accounted;      /* Active time counted up to here */
+    Sim_CaptureTypeDef capture[4];
+    uint8_t captureDone;     /* Channels whose DMA transfer completed, as 1 << index */
+    Sim_SourceTypeDef source;
+} Sim_TimerTypeDef;
+
+/* HAL call behind a transaction, selects the completion callback */
+typedef enum
+{
+    SIM_I2C_MASTER_TX,
+    SIM_I2C_MASTER_RX,
+    SIM_I2C_MEM_TX,
+    SIM_I2C_MEM_RX
+} Sim_I2CKindTypeDef;
+
+typedef struct
+{
+    uint8_t addr;
+    Sim_I2C_WriteFunc write;
+    Sim_I2C_ReadFunc read;
+    void *ctx;
+} Sim_I2CDeviceTypeDef;
+
+typedef struct
+{
+    I2C_TypeDef *regs;
+    I2C_HandleTypeDef *hi2c;
+    Sim_I2CDeviceTypeDef devices[SIM_MAX_I2C_DEVICES];
+    uint8_t deviceCount;
+    Sim_I2CDeviceTypeDef *target; /* Addressed device, NULL on NACK */
+    uint8_t busy;
+    uint8_t hold;                 /* The running frame ends without a stop */
+    uint8_t held;                 /* A frame ended without a stop, the bus is still ours */
+    uint16_t heldLen;             /* Bytes of that frame kept in wbuf */
+    uint8_t dma;
+    uint8_t kind;                 /* Sim_I2CKindTypeDef */
+    const uint8_t *data;          /* Bytes written: payload, or register address and payload */
+    uint16_t len;
+    uint8_t *rx;                  /* Read destination */
+    uint16_t rxLen;
+    uint8_t wbuf[SIM_I2C_MAX_LEN + 2U]; /* Register address followed by the payload, or the held frame */
+    uint64_t firstNs;             /* End of the first data byte */
+    uint64_t byteNs;
+    uint64_t end;
+    uint32_t error;               /* Injected error of the running transaction */
+    uint32_t fault;               /* Injected error of the next ones */
+    uint8_t faultCount;
+    GPIO_TypeDef *sclPort;        /* Lines, NULL if not connected */
+    uint16_t sclPin;
+    GPIO_TypeDef *sdaPort;
+    uint16_t sdaPin;
+    Sim_SourceTypeDef source;
+} Sim_I2CBusTypeDef;
+
+GPIO_TypeDef Sim_GPIO[3];
+TIM_TypeDef Sim_TIM[3];
+DMA_Channel_TypeDef Sim_DMA1_Channel[7];
+I2C_TypeDef Sim_I2C[2];
+
+static Sim_PortTypeDef sim_ports[3];
+static Sim_TimerTypeDef sim_timers[3];
+static Sim_I2CBusTypeDef sim_buses[2];
+
+static uint64_t Sim_Never(void *ctx)
+{
+    (void)ctx;
+    return SIM_NEVER;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    GPIO                                    */
+/* -------------------------------------------------------------------------- */
+
+static Sim_PortTypeDef *Sim_Port(GPIO_TypeDef *regs)
+{
+    return &sim_ports[regs - Sim_GPIO];
+}
+
+/* Level of a pin before devices pull: what the MCU drives, or the pull-up */
+static uint8_t Sim_GPIO_HostLevel(GPIO_TypeDef *regs, uint32_t position)
+{
+    uint32_t cr = (position < 8U) ? regs->CRL : regs->CRH;
+    uint32_t nibble = (cr >> ((position & 0x7U) * 4U)) & 0xFU;
+    uint8_t odr = (regs->ODR >> position) & 1U;
+
+    if ((nibble & 0x3U) != 0U)
+    {
+        // Output: push-pull drives ODR, open-drain releases to the pull-up on 1
+        return odr;
+    }
+    if ((nibble >> 2) == 0x2U)
+    {
+        return odr; // Input with the internal pull-up or pull-down
+    }
+    return 1U; // Floating input: the module's external pull-up
+}
+
+static void Sim_TIM_Edge(GPIO_TypeDef *port, uint16_t pin, uint8_t level, uint64_t now);
+
+void Sim_GPIO_Update(GPIO_TypeDef *regs, uint64_t now)
+{
+    Sim_PortTypeDef *port = Sim_Port(regs);
+    uint32_t idr = 0;
+
+    for (uint32_t position = 0; position < 16U; position++)
+    {
+        uint8_t level = Sim_GPIO_HostLevel(regs, position);
+        for (uint8_t i = 0; i < port->deviceCount; i++)
+        {
+            if (port->devices[i].pin == (1U << position) && !port->devices[i].device->Drive(port->devices[i].ctx))
+            {
+                level = 0;
+            }
+        }
+        idr |= (uint32_t)level << position;
+    }
+
+    uint32_t changed = (regs->IDR ^ idr) & 0xFFFFU;
+    regs->IDR = idr;
+
+    for (uint32_t position = 0; changed != 0U; position++, changed >>= 1)
+    {
+        if ((changed & 1U) == 0U)
+        {
+            continue;
+        }
+        uint16_t pin = (uint16_t)(1U << position);
+        uint8_t level = (idr >> position) & 1U;
+        for (uint8_t i = 0; i < port->deviceCount; i++)
+        {
+            if (port->devices[i].pin == pin && port->devices[i].device->LineChanged != NULL)
+            {
+                port->devices[i].device->LineChanged(port->devices[i].ctx, level, now);
+            }
+        }
+        Sim_TIM_Edge(regs, pin, level, now);
+    }
+}
+
+/* Apply the write-only set/reset registers, then settle the lines */
+static void Sim_GPIO_Run(void *ctx, uint64_t now)
+{
+    GPIO_TypeDef *regs = ((Sim_PortTypeDef *)ctx)->regs;
+
+    if (regs->BSRR != 0U)
+    {
+        regs->ODR = (regs->ODR & ~(regs->BSRR >> 16)) | (regs->BSRR & 0xFFFFU);
+        regs->BSRR = 0;
+    }
+    if (regs->BRR != 0U)
+    {
+        regs->ODR &= ~(regs->BRR & 0xFFFFU);
+        regs->BRR = 0;
+    }
+    Sim_GPIO_Update(regs, now);
+}
+
+void Sim_GPIO_Attach(GPIO_TypeDef *regs, uint16_t pin, const Sim_PinDeviceTypeDef *device, void *ctx)
+{
+    Sim_PortTypeDef *port = Sim_Port(regs);
+
+    if (port->deviceCount < SIM_MAX_PIN_DEVICES)
+    {
+        port->devices[port->deviceCount].pin = pin;
+        port->devices[port->deviceCount].device = device;
+        port->devices[port->deviceCount].ctx = ctx;
+        port->deviceCount++;
+    }
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+    for (uint32_t position = 0; position < 16U; position++)
+    {
+        if ((GPIO_Init->Pin & (1U << position)) == 0U)
+        {
+            continue;
+        }
+
+        uint32_t config;
+        if (GPIO_Init->Mode == GPIO_MODE_OUTPUT_PP)
+        {
+            config = 0x2U;
+        }
+        else if (GPIO_Init->Mode == GPIO_MODE_OUTPUT_OD)
+        {
+            config = 0x6U;
+        }
+        else if (GPIO_Init->Pull == GPIO_NOPULL)
+        {
+            config = 0x4U;
+        }
+        else
+        {
+            config = 0x8U;
+            if (GPIO_Init->Pull == GPIO_PULLUP)
+            {
+                GPIOx->ODR |= 1U << position;
+            }
+            else
+            {
+                GPIOx->ODR &= ~(1U << position);
+            }
+        }
+
+        __IO uint32_t *cr = (position < 8U) ? &GPIOx->CRL : &GPIOx->CRH;
+        MODIFY_REG(*cr, 0xFU << ((position & 0x7U) * 4U), config << ((position & 0x7U) * 4U));
+    }
+    Sim_Busy(0);
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    Sim_Busy(0);
+    return ((GPIOx->IDR & GPIO_Pin) != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    if (PinState != GPIO_PIN_RESET)
+    {
+        GPIOx->BSRR = GPIO_Pin;
+    }
+    else
+    {
+        GPIOx->BSRR = (uint32_t)GPIO_Pin << 16U;
+    }
+    Sim_Busy(0);
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    GPIOx->ODR ^= GPIO_Pin;
+    Sim_Busy(0);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    TIM                                     */
+/* -------------------------------------------------------------------------- */
+
+static Sim_TimerTypeDef *Sim_Timer(TIM_TypeDef *regs)
+{
+    return &sim_timers[regs - Sim_TIM];
+}
+
+static uint64_t Sim_TIM_Ticks(const Sim_TimerTypeDef *t, uint64_t ns)
+{
+    return (ns * (SIM_TIMCLK_HZ / 1000000U)) / ((uint64_t)(t->regs->PSC + 1U) * 1000U);
+}
+
+static uint8_t Sim_TIM_Active(const Sim_TimerTypeDef *t)
+{
+    uint8_t armed = 0;
+    for (uint8_t i = 0; i < 4U; i++)
+    {
+        armed |= t->capture[i].armed;
+    }
+    return t->running && (armed || (t->regs->DIER & TIM_DIER_UIE) != 0U);
+}
+
+static void Sim_TIM_UpdateIrq(void *arg)
+{
+    Sim_TimerTypeDef *t = (Sim_TimerTypeDef *)arg;
+
+    // The handler checks the enable bit, like HAL_TIM_IRQHandler
+    if (t->running && (t->regs->DIER & TIM_DIER_UIE) != 0U && t->htim != NULL)
+    {
+        HAL_TIM_PeriodElapsedCallback(t->htim);
+    }
+}
+
+static void Sim_TIM_CaptureIrq(void *arg)
+{
+    Sim_TimerTypeDef *t = (Sim_TimerTypeDef *)arg;
+    uint8_t done = t->captureDone;
+
+    t->captureDone = 0;
+    for (uint8_t i = 0; i < 4U; i++)
+    {
+        if ((done & (1U << i)) != 0U && t->htim != NULL)
+        {
+            // DMA transfer complete: HAL reports it as a capture of the channel
+            t->htim->Channel = (HAL_TIM_ActiveChannel)(1U << i);
+            HAL_TIM_IC_CaptureCallback(t->htim);
+            t->htim->Channel = HAL_TIM_ACTIVE_CHANNEL_CLEARED;
+        }
+    }
+}
+
+/* Bring CNT up to now; a value written by the driver restarts the count */
+static void Sim_TIM_Sync(Sim_TimerTypeDef *t, uint64_t now)
+{
+    if (!t->running)
+    {
+        t->shownCnt = t->regs->CNT;
+        return;
+    }
+    if (Sim_TIM_Active(t))
+    {
+        Sim_Stats.timerRunNs += now - t->accounted;
+    }
+    t->accounted = now;
+
+    if (t->regs->CNT != t->shownCnt)
+    {
+        t->origin = now;
+        t->originCnt = t->regs->CNT;
+        t->wraps = 0;
+    }
+
+    uint64_t period = (uint64_t)t->regs->ARR + 1U;
+    uint64_t total = t->originCnt + Sim_TIM_Ticks(t, now - t->origin);
+    uint64_t wraps = total / period;
+
+    t->regs->CNT = (uint32_t)(total % period);
+    t->shownCnt = t->regs->CNT;
+
+    if (wraps > t->wraps)
+    {
+        t->wraps = wraps;
+        if ((t->regs->DIER & TIM_DIER_UIE) != 0U)
+        {
+            Sim_Stats.timerUpdates++;
+            Sim_RaiseIrq(Sim_TIM_UpdateIrq, t);
+        }
+    }
+}
+
+static uint64_t Sim_TIM_Next(void *ctx)
+{
+    Sim_TimerTypeDef *t = (Sim_TimerTypeDef *)ctx;
+
+    if (!t->running || (t->regs->DIER & TIM_DIER_UIE) == 0U)
+    {
+        return SIM_NEVER;
+    }
+
+    // First instant the tick count reaches the next overflow
+    uint64_t period = (uint64_t)t->regs->ARR + 1U;
+    uint64_t ticks = (t->wraps + 1U) * period - t->originCnt;
+    uint64_t scale = (uint64_t)(t->regs->PSC + 1U) * 1000U;
+    uint64_t rate = SIM_TIMCLK_HZ / 1000000U;
+
+    return t->origin + (ticks * scale + rate - 1U) / rate;
+}
+
+static void Sim_TIM_Run(void *ctx, uint64_t now)
+{
+    Sim_TIM_Sync((Sim_TimerTypeDef *)ctx, now);
+}
+
+static void Sim_TIM_Start(Sim_TimerTypeDef *t, TIM_HandleTypeDef *htim)
+{
+    uint64_t now = Sim_Now();
+
+    Sim_TIM_Sync(t, now);
+    t->htim = htim;
+    if (!t->running)
+    {
+        t->running = 1;
+        t->origin = now;
+        t->originCnt = t->regs->CNT;
+        t->shownCnt = t->regs->CNT;
+        t->wraps = 0;
+        t->accounted = now;
+    }
+    t->regs->CR1 |= TIM_CR1_CEN;
+}
+
+static void Sim_TIM_Stop(Sim_TimerTypeDef *t)
+{
+    Sim_TIM_Sync(t, Sim_Now());
+    t->running = 0;
+    t->regs->CR1 &= ~TIM_CR1_CEN;
+}
+
+static void Sim_TIM_Edge(GPIO_TypeDef *port, uint16_t pin, uint8_t level, uint64_t now)
+{
+    for (uint8_t n = 0; n < 3U; n++)
+    {
+        Sim_TimerTypeDef *t = &sim_timers[n];
+        for (uint8_t i = 0; i < 4U; i++)
+        {
+            Sim_CaptureTypeDef *cap = &t->capture[i];
+            uint8_t wanted = (cap->polarity == TIM_INPUTCHANNELPOLARITY_FALLING) ? 0U : 1U;
+            if (!cap->armed || cap->port != port || cap->pin != pin || level != wanted || t->htim == NULL)
+            {
+                continue;
+            }
+
+            DMA_HandleTypeDef *hdma = t->htim->hdma[TIM_DMA_ID_CC1 + i];
+            Sim_TIM_Sync(t, now);
+            cap->buffer[cap->index++] = (uint16_t)t->regs->CNT;
+            hdma->Instance->CNDTR--;
+            Sim_Stats.captures++;
+
+            if (hdma->Instance->CNDTR == 0U)
+            {
+                cap->armed = 0;
+                t->captureDone |= (uint8_t)(1U << i);
+                Sim_RaiseIrq(Sim_TIM_CaptureIrq, t);
+            }
+        }
+    }
+}
+
+void Sim_TIM_ConnectCapture(TIM_TypeDef *tim, uint32_t channel, GPIO_TypeDef *port, uint16_t pin, uint32_t polarity)
+{
+    Sim_CaptureTypeDef *cap = &Sim_Timer(tim)->capture[channel >> 2];
+
+    cap->port = port;
+    cap->pin = pin;
+    cap->polarity = polarity;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim)
+{
+    htim->Instance->PSC = htim->Init.Prescaler;
+    htim->Instance->ARR = htim->Init.Period;
+    Sim_Timer(htim->Instance)->htim = htim;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim)
+{
+    Sim_TIM_Start(Sim_Timer(htim->Instance), htim);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim)
+{
+    Sim_TimerTypeDef *t = Sim_Timer(htim->Instance);
+
+    Sim_TIM_Sync(t, Sim_Now());
+    htim->Instance->DIER |= TIM_DIER_UIE;
+    Sim_TIM_Start(t, htim);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim)
+{
+    Sim_TimerTypeDef *t = Sim_Timer(htim->Instance);
+
+    Sim_TIM_Sync(t, Sim_Now());
+    htim->Instance->DIER &= ~TIM_DIER_UIE;
+    Sim_TIM_Stop(t);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_Start_DMA(TIM_HandleTypeDef *htim, uint32_t Channel, uint32_t *pData, uint16_t Length)
+{
+    Sim_TimerTypeDef *t = Sim_Timer(htim->Instance);
+    Sim_CaptureTypeDef *cap = &t->capture[Channel >> 2];
+    DMA_HandleTypeDef *hdma = htim->hdma[TIM_DMA_ID_CC1 + (Channel >> 2)];
+
+    if (hdma == NULL || pData == NULL || Length == 0U || cap->armed)
+    {
+        return HAL_ERROR;
+    }
+
+    Sim_TIM_Sync(t, Sim_Now());
+    // Half-word transfers: the buffer holds 16-bit captures
+    cap->buffer = (uint16_t *)pData;
+    cap->index = 0;
+    cap->armed = 1;
+    hdma->Instance->CNDTR = Length;
+    Sim_TIM_Start(t, htim);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_Stop_DMA(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+    Sim_TimerTypeDef *t = Sim_Timer(htim->Instance);
+
+    Sim_TIM_Sync(t, Sim_Now());
+    t->capture[Channel >> 2].armed = 0;
+    Sim_TIM_Stop(t);
+    return HAL_OK;
+}
+
+__attribute__((weak)) void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    UNUSED(htim);
+}
+
+__attribute__((weak)) void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim)
+{
+    UNUSED(htim);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    I2C                                     */
+/* -------------------------------------------------------------------------- */
+
+static Sim_I2CBusTypeDef *Sim_Bus(I2C_TypeDef *regs)
+{
+    return &sim_buses[regs - Sim_I2C];
+}
+
+static void Sim_I2C_CpltIrq(void *arg)
+{
+    Sim_I2CBusTypeDef *bus = (Sim_I2CBusTypeDef *)arg;
+
+    switch (bus->kind)
+    {
+    case SIM_I2C_MASTER_RX:
+        HAL_I2C_MasterRxCpltCallback(bus->hi2c);
+        break;
+    case SIM_I2C_MEM_TX:
+        HAL_I2C_MemTxCpltCallback(bus->hi2c);
+        break;
+    case SIM_I2C_MEM_RX:
+        HAL_I2C_MemRxCpltCallback(bus->hi2c);
+        break;
+    default:
+        HAL_I2C_MasterTxCpltCallback(bus->hi2c);
+        break;
+    }
+}
+
+static void Sim_I2C_ErrorIrq(void *arg)
+{
+    HAL_I2C_ErrorCallback(((Sim_I2CBusTypeDef *)arg)->hi2c);
+}
+
+/* A device holding SCL or SDA low */
+static uint8_t Sim_I2C_LineLow(const Sim_I2CBusTypeDef *bus)
+{
+    if (bus->sclPort == NULL)
+    {
+        return 0;
+    }
+    return ((bus->sclPort->IDR & bus->sclPin) == 0U) || ((bus->sdaPort->IDR & bus->sdaPin) == 0U);
+}
+
+/* BUSY follows the transaction, and the lines while the peripheral is on */
+static void Sim_I2C_UpdateBusy(Sim_I2CBusTypeDef *bus)
+{
+    if (bus->busy || bus->held || ((bus->regs->CR1 & I2C_CR1_PE) != 0U && Sim_I2C_LineLow(bus)))
+    {
+        bus->regs->SR2 |= I2C_SR2_BUSY;
+    }
+    else
+    {
+        bus->regs->SR2 &= ~I2C_SR2_BUSY;
+    }
+}
+
+/* Take the error of the transaction starting now from the injected faults */
+static void Sim_I2C_TakeFault(Sim_I2CBusTypeDef *bus)
+{
+    bus->error = HAL_I2C_ERROR_NONE;
+    if (bus->faultCount != 0U)
+    {
+        bus->error = bus->fault;
+        bus->faultCount--;
+    }
+}
+
+static uint64_t Sim_I2C_Next(void *ctx)
+{
+    Sim_I2CBusTypeDef *bus = (Sim_I2CBusTypeDef *)ctx;
+    return bus->busy ? bus->end : SIM_NEVER;
+}
+
+/* End of a transaction: hand the bytes to the device, release the bus */
+static void Sim_I2C_Run(void *ctx, uint64_t now)
+{
+    Sim_I2CBusTypeDef *bus = (Sim_I2CBusTypeDef *)ctx;
+    I2C_HandleTypeDef *hi2c = bus->hi2c;
+
+    if (!bus->busy || now < bus->end)
+    {
+        Sim_I2C_UpdateBusy(bus);
+        return;
+    }
+
+    // A register read writes the address first, then reads after the restart
+    uint8_t ack = 0;
+    Sim_I2CDeviceTypeDef *dev = bus->target;
+    if (bus->error != HAL_I2C_ERROR_NONE)
+    {
+        // Injected: nothing reaches the device
+        hi2c->ErrorCode |= bus->error;
+        ack = (bus->error & HAL_I2C_ERROR_AF) == 0U;
+        dev = NULL;
+    }
+    if (dev != NULL && bus->hold)
+    {
+        // No stop: the bytes reach the device with the closing frame
+        ack = 1;
+    }
+    else if (dev != NULL)
+    {
+        ack = 1;
+        if (bus->len != 0U)
+        {
+            ack = dev->write(dev->ctx, bus->data, bus->len, bus->firstNs, bus->byteNs);
+        }
+        if (ack && bus->rxLen != 0U)
+        {
+            ack = (dev->read != NULL) ? dev->read(dev->ctx, bus->rx, bus->rxLen) : 0U;
+        }
+    }
+
+    bus->busy = 0;
+    bus->held = bus->hold && ack && hi2c->ErrorCode == HAL_I2C_ERROR_NONE;
+    Sim_I2C_UpdateBusy(bus);
+    hi2c->State = HAL_I2C_STATE_READY;
+    if (!ack)
+    {
+        hi2c->ErrorCode |= HAL_I2C_ERROR_AF;
+        Sim_Stats.i2cNacks++;
+    }
+
+    if (bus->dma)
+    {
+        Sim_RaiseIrq((hi2c->ErrorCode == HAL_I2C_ERROR_NONE) ? Sim_I2C_CpltIrq : Sim_I2C_ErrorIrq, bus);
+    }
+}
+
+/* Put a transaction on the bus; it completes in Sim_I2C_Run(). The prefix
+ * (register address) is written before pData; with a read kind pData is
+ * then read, after a repeated start when there is a prefix. Of the
+ * sequential options, I2C_FIRST_FRAME writes without a stop and
+ * I2C_LAST_FRAME closes that transaction: a write goes on with the same
+ * bytes, a read after a repeated start. */
+static HAL_StatusTypeDef Sim_I2C_Start(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint8_t kind, uint8_t dma,
+                                       uint32_t options)
+{
+    Sim_I2CBusTypeDef *bus = Sim_Bus(hi2c->Instance);
+    uint64_t now = Sim_Now();
+    uint8_t receive = (kind == SIM_I2C_MASTER_RX) || (kind == SIM_I2C_MEM_RX);
+    uint8_t prefix = (kind == SIM_I2C_MEM_TX || kind == SIM_I2C_MEM_RX)
+                         ? ((MemAddSize == I2C_MEMADD_SIZE_16BIT) ? 2U : 1U)
+                         : 0U;
+    uint8_t hold = (options == I2C_FIRST_FRAME);
+    uint8_t cont = (options == I2C_LAST_FRAME);
+
+    if (hi2c->State != HAL_I2C_STATE_READY || bus->busy)
+    {
+        return HAL_BUSY;
+    }
+    if (pData == NULL || Size == 0U || Size > SIM_I2C_MAX_LEN || hi2c->Init.ClockSpeed == 0U)
+    {
+        return HAL_ERROR;
+    }
+    if ((hold && receive) || (!hold && !cont && options != I2C_FIRST_AND_LAST_FRAME))
+    {
+        return HAL_ERROR; // Not modelled
+    }
+    if (cont && (!bus->held || bus->target->addr != (uint8_t)(DevAddress >> 1) ||
+                 (!receive && bus->heldLen + Size > sizeof(bus->wbuf))))
+    {
+        return HAL_ERROR;
+    }
+    if (!cont && (bus->regs->SR2 & I2C_SR2_BUSY) != 0U)
+    {
+        // The HAL polls the flag of a held line until its timeout
+        Sim_Busy(SIM_I2C_BUSY_FLAG_NS);
+        return HAL_BUSY;
+    }
+
+    bus->hi2c = hi2c;
+    if (!cont)
+    {
+        bus->target = NULL;
+        for (uint8_t i = 0; i < bus->deviceCount; i++)
+        {
+            if (bus->devices[i].addr == (uint8_t)(DevAddress >> 1))
+            {
+                bus->target = &bus->devices[i];
+            }
+        }
+    }
+
+    if (hold)
+    {
+        memcpy(bus->wbuf, pData, Size);
+        bus->heldLen = Size;
+        bus->data = bus->wbuf;
+        bus->len = Size;
+    }
+    else if (cont)
+    {
+        // The device sees one write: the held bytes, then a written payload
+        if (!receive)
+        {
+            memcpy(&bus->wbuf[bus->heldLen], pData, Size);
+        }
+        bus->data = bus->wbuf;
+        bus->len = (uint16_t)(bus->heldLen + (receive ? 0U : Size));
+    }
+    else if (prefix == 0U)
+    {
+        bus->data = pData;
+        bus->len = receive ? 0U : Size;
+    }
+    else
+    {
+        // Most significant address byte first, then the payload of a write
+        bus->wbuf[0] = (uint8_t)(MemAddress >> 8);
+        bus->wbuf[1] = (uint8_t)MemAddress;
+        if (!receive)
+        {
+            memcpy(&bus->wbuf[2], pData, Size);
+        }
+        bus->data = &bus->wbuf[2U - prefix];
+        bus->len = (uint16_t)(prefix + (receive ? 0U : Size));
+    }
+    bus->rx = receive ? pData : NULL;
+    bus->rxLen = receive ? Size : 0U;
+
+    // Start, address, data (9 clocks a byte with the ACK), stop; a register
+    // read adds a repeated start and the address again. A NACK on the
+    // address ends the transaction there. A closing frame has no start and
+    // only its own bytes, a read its restart and address; a first frame no stop
+    uint64_t bit_ns = 1000000000U / hi2c->Init.ClockSpeed;
+    uint8_t restart = (prefix != 0U || cont) && receive;
+    uint16_t bytes = 1U;
+    if (cont)
+    {
+        bytes = (uint16_t)(Size + (receive ? 1U : 0U));
+    }
+    else if (bus->target != NULL)
+    {
+        bytes = (uint16_t)(1U + bus->len + bus->rxLen + (restart ? 1U : 0U));
+    }
+
+    bus->byteNs = 9U * bit_ns;
+    if (!cont)
+    {
+        bus->firstNs = now + bit_ns + 2U * bus->byteNs;
+    }
+    bus->end = now + (cont ? 0U : bit_ns) + (restart ? bit_ns : 0U) + bytes * bus->byteNs + (hold ? 0U : bit_ns);
+    bus->kind = kind;
+    bus->dma = dma;
+    bus->hold = hold;
+    bus->held = 0;
+    bus->busy = 1;
+    bus->regs->SR2 |= I2C_SR2_BUSY;
+    if (!cont)
+    {
+        // Injected faults count whole transactions
+        Sim_I2C_TakeFault(bus);
+    }
+    if (bus->error == HAL_I2C_ERROR_TIMEOUT)
+    {
+        bus->end = SIM_NEVER;
+    }
+
+    hi2c->State = receive ? HAL_I2C_STATE_BUSY_RX : HAL_I2C_STATE_BUSY_TX;
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    hi2c->pBuffPtr = pData;
+    hi2c->XferSize = Size;
+
+    Sim_Stats.i2cTransfers += cont ? 0U : 1U;
+    Sim_Stats.i2cBytes += bytes;
+    Sim_Stats.i2cBusNs += (bus->end != SIM_NEVER) ? bus->end - now : 0U;
+
+    return HAL_OK;
+}
+
+void Sim_I2C_Attach(I2C_TypeDef *i2c, uint8_t addr, Sim_I2C_WriteFunc write, void *ctx)
+{
+    Sim_I2CBusTypeDef *bus = Sim_Bus(i2c);
+
+    if (bus->deviceCount < SIM_MAX_I2C_DEVICES)
+    {
+        bus->devices[bus->deviceCount].addr = addr;
+        bus->devices[bus->deviceCount].write = write;
+        bus->devices[bus->deviceCount].read = NULL;
+        bus->devices[bus->deviceCount].ctx = ctx;
+        bus->deviceCount++;
+    }
+}
+
+void Sim_I2C_SetReader(I2C_TypeDef *i2c, uint8_t addr, Sim_I2C_ReadFunc read)
+{
+    Sim_I2CBusTypeDef *bus = Sim_Bus(i2c);
+
+    for (uint8_t i = 0; i < bus->deviceCount; i++)
+    {
+        if (bus->devices[i].addr == addr)
+        {
+            bus->devices[i].read = read;
+        }
+    }
+}
+
+void Sim_I2C_ConnectPins(I2C_TypeDef *i2c, GPIO_TypeDef *sclPort, uint16_t sclPin, GPIO_TypeDef *sdaPort,
+                         uint16_t sdaPin)
+{
+    Sim_I2CBusTypeDef *bus = Sim_Bus(i2c);
+
+    bus->sclPort = sclPort;
+    bus->sclPin = sclPin;
+    bus->sdaPort = sdaPort;
+    bus->sdaPin = sdaPin;
+}
+
+void Sim_I2C_InjectFault(I2C_TypeDef *i2c, uint32_t error, uint8_t count)
+{
+    Sim_I2CBusTypeDef *bus = Sim_Bus(i2c);
+
+    bus->fault = error;
+    bus->faultCount = count;
+    if (bus->busy && count != 0U)
+    {
+        Sim_I2C_TakeFault(bus);
+        if (bus->error == HAL_I2C_ERROR_TIMEOUT)
+        {
+            bus->end = SIM_NEVER;
+        }
+    }
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+    uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+
+    if (!IS_I2C_CLOCK_SPEED(hi2c->Init.ClockSpeed) || I2C_MIN_PCLK_FREQ(pclk1, hi2c->Init.ClockSpeed))
+    {
+        return HAL_ERROR;
+    }
+
+    // SWRST: status flags cleared, BUSY comes back from the lines
+    hi2c->Instance->SR1 = 0;
+    hi2c->Instance->SR2 = 0;
+
+    hi2c->Instance->TRISE = I2C_RISE_TIME(I2C_FREQRANGE(pclk1), hi2c->Init.ClockSpeed);
+    hi2c->Instance->CCR = I2C_SPEED(pclk1, hi2c->Init.ClockSpeed, hi2c->Init.DutyCycle);
+    __HAL_I2C_ENABLE(hi2c);
+
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    hi2c->State = HAL_I2C_STATE_READY;
+    Sim_Bus(hi2c->Instance)->hi2c = hi2c;
+    Sim_Bus(hi2c->Instance)->held = 0;
+    Sim_Busy(0);
+
+    return HAL_OK;
+}
+
+/* Disabling the peripheral abandons a transaction on the wire */
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c)
+{
+    Sim_I2CBusTypeDef *bus = Sim_Bus(hi2c->Instance);
+
+    __HAL_I2C_DISABLE(hi2c);
+    bus->busy = 0;
+    bus->held = 0;
+    bus->error = HAL_I2C_ERROR_NONE;
+    Sim_I2C_UpdateBusy(bus);
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    hi2c->State = HAL_I2C_STATE_RESET;
+    Sim_Busy(0);
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size,
+                                          uint32_t Timeout)
+{
+    Sim_I2CBusTypeDef *bus = Sim_Bus(hi2c->Instance);
+
+    HAL_StatusTypeDef status =
+        Sim_I2C_Start(hi2c, DevAddress, 0, 0, pData, Size, SIM_I2C_MASTER_TX, 0, I2C_FIRST_AND_LAST_FRAME);
+    if (status != HAL_OK)
+    {
+        return status;
+    }
+
+    // The CPU polls the flags for the whole transaction, or until the timeout
+    // when a slave stretches SCL past it
+    uint64_t timeout_ns = (uint64_t)Timeout * 1000000ULL;
+    if (bus->end - Sim_Now() > timeout_ns)
+    {
+        Sim_Busy(timeout_ns);
+        bus->busy = 0;
+        Sim_I2C_UpdateBusy(bus);
+        hi2c->ErrorCode |= HAL_I2C_ERROR_TIMEOUT;
+        hi2c->State = HAL_I2C_STATE_READY;
+        return HAL_ERROR;
+    }
+    Sim_Busy(bus->end - Sim_Now());
+
+    return (hi2c->ErrorCode == HAL_I2C_ERROR_NONE) ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                             uint16_t Size)
+{
+    // Byte interrupts are not modelled, only the completion
+    return Sim_I2C_Start(hi2c, DevAddress, 0, 0, pData, Size, SIM_I2C_MASTER_TX, 1, I2C_FIRST_AND_LAST_FRAME);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                              uint16_t Size)
+{
+    if (hi2c->hdmatx == NULL)
+    {
+        return HAL_ERROR;
+    }
+    return Sim_I2C_Start(hi2c, DevAddress, 0, 0, pData, Size, SIM_I2C_MASTER_TX, 1, I2C_FIRST_AND_LAST_FRAME);
+}
+
+/* Sequential transfers: I2C_FIRST_AND_LAST_FRAME, a complete transaction,
+ * or a write with I2C_FIRST_FRAME closed by I2C_LAST_FRAME. The BUSY flag is
+ * only polled by a first frame, nothing else is */
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                                 uint16_t Size, uint32_t XferOptions)
+{
+    return Sim_I2C_Start(hi2c, DevAddress, 0, 0, pData, Size, SIM_I2C_MASTER_TX, 1, XferOptions);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                                  uint16_t Size, uint32_t XferOptions)
+{
+    if (hi2c->hdmatx == NULL)
+    {
+        return HAL_ERROR;
+    }
+    return HAL_I2C_Master_Seq_Transmit_IT(hi2c, DevAddress, pData, Size, XferOptions);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                                uint16_t Size, uint32_t XferOptions)
+{
+    return Sim_I2C_Start(hi2c, DevAddress, 0, 0, pData, Size, SIM_I2C_MASTER_RX, 1, XferOptions);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                                 uint16_t Size, uint32_t XferOptions)
+{
+    if (hi2c->hdmarx == NULL)
+    {
+        return HAL_ERROR;
+    }
+    return HAL_I2C_Master_Seq_Receive_IT(hi2c, DevAddress, pData, Size, XferOptions);
+}
+
+/* The register calls send the start, the device address and the register
+ * address, and for a read the restart and the address again, by polling
+ * SB, ADDR and TXE with I2C_TIMEOUT_FLAG before they enable the interrupts
+ * or the DMA: that part runs on the caller's CPU, in its interrupt if it
+ * is called from one. A NACK there ends the call without a callback */
+static HAL_StatusTypeDef Sim_I2C_MemStart(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                          uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint8_t kind)
+{
+    Sim_I2CBusTypeDef *bus = Sim_Bus(hi2c->Instance);
+
+    HAL_StatusTypeDef status = Sim_I2C_Start(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size, kind, 1,
+                                             I2C_FIRST_AND_LAST_FRAME);
+    if (status != HAL_OK)
+    {
+        return status;
+    }
+
+    uint64_t bit_ns = 1000000000U / hi2c->Init.ClockSpeed;
+    uint16_t prefix = (MemAddSize == I2C_MEMADD_SIZE_16BIT) ? 2U : 1U;
+    uint64_t poll_ns = bit_ns + (1U + prefix) * bus->byteNs;
+    if (kind == SIM_I2C_MEM_RX)
+    {
+        poll_ns += bit_ns + bus->byteNs;
+    }
+
+    if (bus->error == HAL_I2C_ERROR_TIMEOUT)
+    {
+        Sim_Busy(SIM_I2C_FLAG_NS);
+        status = HAL_TIMEOUT;
+    }
+    else if (bus->target == NULL || (bus->error & HAL_I2C_ERROR_AF) != 0U)
+    {
+        Sim_Busy(bit_ns + bus->byteNs);
+        hi2c->ErrorCode |= HAL_I2C_ERROR_AF;
+        Sim_Stats.i2cNacks++;
+        status = HAL_ERROR;
+    }
+    else
+    {
+        // The rest goes on in the background and ends in Sim_I2C_Run()
+        Sim_Busy(poll_ns);
+        return HAL_OK;
+    }
+
+    bus->busy = 0;
+    bus->error = HAL_I2C_ERROR_NONE;
+    Sim_I2C_UpdateBusy(bus);
+    hi2c->State = HAL_I2C_STATE_READY;
+    return status;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    return Sim_I2C_MemStart(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size, SIM_I2C_MEM_TX);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                        uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    if (hi2c->hdmatx == NULL)
+    {
+        return HAL_ERROR;
+    }
+    return HAL_I2C_Mem_Write_IT(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                      uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    return Sim_I2C_MemStart(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size, SIM_I2C_MEM_RX);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    if (hi2c->hdmarx == NULL)
+    {
+        return HAL_ERROR;
+    }
+    return HAL_I2C_Mem_Read_IT(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size);
+}
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c)
+{
+    return hi2c->State;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c)
+{
+    return hi2c->ErrorCode;
+}
+
+__attribute__((weak)) void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    UNUSED(hi2c);
+}
+
+__attribute__((weak)) void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    UNUSED(hi2c);
+}
+
+__attribute__((weak)) void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    UNUSED(hi2c);
+}
+
+__attribute__((weak)) void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    UNUSED(hi2c);
+}
+
+__attribute__((weak)) void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    UNUSED(hi2c);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Tick and clocks                              */
+/* -------------------------------------------------------------------------- */
+
+uint32_t HAL_GetTick(void)
+{
+    Sim_Stats.polls++;
+    Sim_Busy(SIM_POLL_COST_NS);
+    return (uint32_t)(Sim_Now() / 1000000U);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    // Like the HAL: at least Delay full ticks, counted from the current one
+    uint64_t tick = Sim_Now() / 1000000U;
+    uint64_t wait = (Delay < HAL_MAX_DELAY) ? (uint64_t)Delay + 1U : Delay;
+
+    Sim_Busy((tick + wait) * 1000000U - Sim_Now());
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+    return SIM_PCLK1_HZ;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Reset                                    */
+/* -------------------------------------------------------------------------- */
+
+void Sim_HAL_Reset(void)
+{
+    memset(Sim_GPIO, 0, sizeof(Sim_GPIO));
+    memset(Sim_TIM, 0, sizeof(Sim_TIM));
+    memset(Sim_DMA1_Channel, 0, sizeof(Sim_DMA1_Channel));
+    memset(Sim_I2C, 0, sizeof(Sim_I2C));
+    memset(sim_ports, 0, sizeof(sim_ports));
+    memset(sim_timers, 0, sizeof(sim_timers));
+    memset(sim_buses, 0, sizeof(sim_buses));
+
+    for (uint8_t i = 0; i < 3U; i++)
+    {
+        Sim_GPIO[i].CRL = SIM_GPIO_CR_RESET;
+        Sim_GPIO[i].CRH = SIM_GPIO_CR_RESET;
+        Sim_GPIO[i].IDR = 0xFFFFU;
+        sim_ports[i].regs = &Sim_GPIO[i];
+        sim_ports[i].source = (Sim_SourceTypeDef){Sim_Never, Sim_GPIO_Run, &sim_ports[i]};
+        Sim_AddSource(&sim_ports[i].source);
+    }
+
+    for (uint8_t i = 0; i < 3U; i++)
+    {
+        Sim_TIM[i].ARR = 0xFFFFU;
+        sim_timers[i].regs = &Sim_TIM[i];
+        sim_timers[i].source = (Sim_SourceTypeDef){Sim_TIM_Next, Sim_TIM_Run, &sim_timers[i]};
+        Sim_AddSource(&sim_timers[i].source);
+    }
+
+    for (uint8_t i = 0; i < 2U; i++)
+    {
+        sim_buses[i].regs = &Sim_I2C[i];
+        sim_buses[i].source = (Sim_SourceTypeDef){Sim_I2C_Next, Sim_I2C_Run, &sim_buses[i]};
+        Sim_AddSource(&sim_buses[i].source);
+    }
+}
@@ -0,0 +1,183 @@
+#include "Sim_LCD.h"
+#include <string.h>
+
+/* Move the address counter one step, wrapping like the 2-line controller */
+static void Sim_LCD_Advance(Sim_LCD_TypeDef *lcd)
+{
+    if (lcd->cgram)
+    {
+        lcd->addr = (uint8_t)((lcd->addr + (lcd->increment ? 1U : 63U)) & 0x3FU);
+        return;
+    }
+
+    uint8_t line = (lcd->addr >= 0x40U) ? 1U : 0U;
+    uint8_t col = (uint8_t)(lcd->addr & 0x3FU);
+
+    if (lcd->increment)
+    {
+        if (++col == SIM_LCD_LINE_LEN)
+        {
+            col = 0;
+            line ^= 1U;
+        }
+    }
+    else if (col-- == 0U)
+    {
+        col = SIM_LCD_LINE_LEN - 1U;
+        line ^= 1U;
+    }
+    lcd->addr = (uint8_t)(line * 0x40U + col);
+}
+
+static void Sim_LCD_Shift(Sim_LCD_TypeDef *lcd, uint8_t right)
+{
+    lcd->shift = (uint8_t)((lcd->shift + (right ? SIM_LCD_LINE_LEN - 1U : 1U)) % SIM_LCD_LINE_LEN);
+}
+
+/* Execute a complete instruction or data write; returns its execution time */
+static uint32_t Sim_LCD_Execute(Sim_LCD_TypeDef *lcd, uint8_t rs, uint8_t value)
+{
+    if (rs)
+    {
+        if (lcd->cgram)
+        {
+            lcd->cgramData[lcd->addr & 0x3FU] = value;
+        }
+        else
+        {
+            lcd->ddram[(lcd->addr >= 0x40U) ? 1U : 0U][(lcd->addr & 0x3FU) % SIM_LCD_LINE_LEN] = (char)value;
+            if (lcd->shiftOnWrite)
+            {
+                Sim_LCD_Shift(lcd, !lcd->increment);
+            }
+        }
+        Sim_LCD_Advance(lcd);
+        lcd->writes++;
+        return SIM_LCD_EXEC_US;
+    }
+
+    lcd->instructions++;
+    if (value & 0x80U)
+    {
+        lcd->cgram = 0;
+        lcd->addr = (uint8_t)(value & 0x7FU);
+    }
+    else if (value & 0x40U)
+    {
+        lcd->cgram = 1;
+        lcd->addr = (uint8_t)(value & 0x3FU);
+    }
+    else if (value & 0x20U)
+    {
+        lcd->fourBit = ((value & 0x10U) == 0U) ? 1U : 0U;
+    }
+    else if (value & 0x10U)
+    {
+        if (value & 0x08U)
+        {
+            Sim_LCD_Shift(lcd, (value & 0x04U) != 0U);
+        }
+        else
+        {
+            // Cursor move: step the address counter in the requested direction
+            uint8_t increment = lcd->increment;
+            lcd->increment = (value & 0x04U) ? 1U : 0U;
+            Sim_LCD_Advance(lcd);
+            lcd->increment = increment;
+        }
+    }
+    else if (value & 0x08U)
+    {
+        lcd->displayOn = (value & 0x04U) ? 1U : 0U;
+    }
+    else if (value & 0x04U)
+    {
+        lcd->increment = (value & 0x02U) ? 1U : 0U;
+        lcd->shiftOnWrite = (value & 0x01U) ? 1U : 0U;
+    }
+    else if (value & 0x02U)
+    {
+        lcd->cgram = 0;
+        lcd->addr = 0;
+        lcd->shift = 0;
+        return SIM_LCD_CLEAR_US;
+    }
+    else if (value & 0x01U)
+    {
+        memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+        lcd->cgram = 0;
+        lcd->addr = 0;
+        lcd->shift = 0;
+        lcd->increment = 1;
+        return SIM_LCD_CLEAR_US;
+    }
+    return SIM_LCD_EXEC_US;
+}
+
+/* Falling EN edge at time now: latch D7-D4 and RS */
+static void Sim_LCD_Strobe(Sim_LCD_TypeDef *lcd, uint8_t port, uint64_t now)
+{
+    uint8_t rs = (port & SIM_LCD_RS) ? 1U : 0U;
+    uint8_t nibble = (uint8_t)(port & 0xF0U);
+
+    // The first strobe of an instruction must wait for the previous one
+    if (!lcd->haveHigh && (now < lcd->busyUntil || now < lcd->poweredAt + SIM_LCD_POWERUP_US * 1000ULL))
+    {
+        lcd->violations++;
+    }
+
+    if (!lcd->fourBit)
+    {
+        // 8-bit interface: D3-D0 are not wired and read as 0
+        lcd->busyUntil = now + Sim_LCD_Execute(lcd, rs, nibble) * 1000ULL;
+        return;
+    }
+
+    if (!lcd->haveHigh)
+    {
+        lcd->highNibble = (uint8_t)(nibble | rs);
+        lcd->haveHigh = 1;
+        return;
+    }
+
+    lcd->haveHigh = 0;
+    uint8_t value = (uint8_t)((lcd->highNibble & 0xF0U) | (nibble >> 4));
+    lcd->busyUntil = now + Sim_LCD_Execute(lcd, lcd->highNibble & 1U, value) * 1000ULL;
+}
+
+static uint8_t Sim_LCD_Write(void *ctx, const uint8_t *data, uint16_t len, uint64_t first_ns, uint64_t byte_ns)
+{
+    Sim_LCD_TypeDef *lcd = (Sim_LCD_TypeDef *)ctx;
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        uint8_t prev = lcd->port;
+        lcd->port = data[i];
+        if ((prev & SIM_LCD_EN) != 0U && (data[i] & SIM_LCD_EN) == 0U)
+        {
+            Sim_LCD_Strobe(lcd, prev, first_ns + i * byte_ns);
+        }
+    }
+    return 1;
+}
+
+void Sim_LCD_Init(Sim_LCD_TypeDef *lcd, I2C_TypeDef *i2c, uint8_t addr)
+{
+    memset(lcd, 0, sizeof(*lcd));
+    memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+    lcd->port = 0xFFU; // PCF8574 outputs are high after power-on
+    lcd->increment = 1;
+    lcd->poweredAt = Sim_Now();
+    lcd->busyUntil = lcd->poweredAt;
+
+    Sim_I2C_Attach(i2c, addr, Sim_LCD_Write, lcd);
+}
+
+void Sim_LCD_ReadLine(const Sim_LCD_TypeDef *lcd, uint8_t row, char *buf, uint8_t cols)
+{
+    for (uint8_t col = 0; col < cols; col++)
+    {
+        buf[col] = lcd->ddram[row % SIM_LCD_LINES][(lcd->shift + col) % SIM_LCD_LINE_LEN];
+    }
+    buf[cols] = '\0';
+}
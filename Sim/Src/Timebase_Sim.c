@@ -0,0 +1,58 @@
+#include "Timebase.h"
+#include "Sim.h"
+
+/*
+ * Host version of Timebase.c. On the target a counter read is a memory load
+ * and busy-wait loops spin on it; here every read costs SIM_POLL_COST_NS of
+ * virtual time, so the loops end and their cost is counted.
+ */
+
+static TIM_HandleTypeDef *timebase_htim = NULL;
+
+HAL_StatusTypeDef Timebase_Init(TIM_HandleTypeDef *htim)
+{
+    if (htim == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    if (timebase_htim == htim)
+    {
+        return HAL_OK;
+    }
+
+    timebase_htim = htim;
+
+    return HAL_TIM_Base_Start(htim);
+}
+
+uint16_t Timebase_Now_us(void)
+{
+    Sim_Stats.polls++;
+    Sim_Busy(SIM_POLL_COST_NS);
+    return (uint16_t)timebase_htim->Instance->CNT;
+}
+
+uint16_t Timebase_Elapsed_us(uint16_t since)
+{
+    return (uint16_t)(Timebase_Now_us() - since);
+}
+
+void Timebase_Delay_us(uint16_t us)
+{
+    if (timebase_htim == NULL)
+    {
+        /* Not started yet: fall back to the millisecond tick */
+        HAL_Delay((us + 999U) / 1000U);
+        return;
+    }
+
+    // Same time as the polling loop, without counting every iteration
+    Sim_Busy((uint64_t)us * 1000U);
+}
+
+/* Forget the started timer, for a new simulation run */
+void Timebase_Sim_Reset(void)
+{
+    timebase_htim = NULL;
+}
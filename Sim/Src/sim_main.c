@@ -0,0 +1,1263 @@
+/*
+ * Host scenarios for the DHT22 and LCD drivers. Each scenario runs the
+ * unmodified driver code against the simulated peripherals, checks the
+ * result and prints what it cost in virtual time. The exit status is the
+ * number of failed scenarios.
+ */
+
+#include "Sim.h"
+#include "Sim_DHT22.h"
+#include "Sim_Flash.h"
+#include "Sim_LCD.h"
+#include "DHT22.h"
+#include "DHT22_Group.h"
+#include "DHT22_History.h"
+#include "FlashLog.h"
+#include "I2C_Bus.h"
+#include "LCD_I2C.h"
+#include "Scheduler.h"
+#include "Timebase.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Virtual time covered by the application scenario */
+#define SIM_APP_RUN_MS 60000U
+
+/* The application changes the sensor values halfway */
+#define SIM_APP_CHANGE_MS 30000U
+
+/* Period of the LCD task once its queue has drained */
+#define SIM_APP_LCD_PARK_MS 60000U
+
+/* Longest wait for an asynchronous read */
+#define SIM_ASYNC_TIMEOUT_NS 20000000ULL
+
+/* Register-file device sharing I2C1 with the LCD, at a BMP280 address */
+#define SIM_REG_ADDR 0x76U
+
+/* Address nothing answers on */
+#define SIM_ABSENT_ADDR 0x50U
+
+/* One byte with its ACK at 100 kHz */
+#define SIM_BYTE_100K_US 90U
+
+/* Longest I2C interrupt handler allowed while register accesses start from
+ * it: well under one polled address phase */
+#define SIM_IRQ_MAX_NS 20000ULL
+
+/* Clocks a stuck slave waits for when it never lets go */
+#define SIM_STUCK_FOREVER 0xFFU
+
+/* Longest single pass of the main loop allowed while the bus recovers */
+#define SIM_RECOVERY_STALL_NS 1000000ULL
+
+/* Samples pushed through the history: several times its capacity and past
+ * the 16-bit wrap of the sample numbers the deques keep */
+#define SIM_HISTORY_PUSHES 70000UL
+
+/* Window shorter than DHT22_HISTORY_WINDOW_MAX, not dividing the capacity */
+#define SIM_HISTORY_SHORT 37U
+
+/* Higher-priority handler running during group reads, three times the
+ * SIM_IRQ_MAX_NS every handler should keep to, coming back at this rate */
+#define SIM_HOG_US 60U
+#define SIM_HOG_PERIOD_US 300U
+
+/* Timer interrupt asking the scroller for a step, and how long it runs */
+#define SIM_SCROLL_PERIOD_US 2000U
+#define SIM_SCROLL_NS 40000000ULL
+
+static TIM_HandleTypeDef htim1;
+static TIM_HandleTypeDef htim2;
+static DMA_HandleTypeDef hdma_tim2_ch1;
+static I2C_HandleTypeDef hi2c1;
+static DMA_HandleTypeDef hdma_i2c1_tx;
+static DMA_HandleTypeDef hdma_i2c1_rx;
+static I2C_Bus_HandleTypeDef hbus1;
+static DHT22_HandleTypeDef dht22;
+static LCD_HandleTypeDef hlcd;
+
+static Sim_DHT22_TypeDef sensor;
+static Sim_LCD_TypeDef lcd_model;
+
+/**
+ * @brief  Register file: a write sets the register pointer and stores the
+ *         bytes after it, a read streams from the pointer
+ */
+typedef struct
+{
+    uint8_t regs[256];
+    uint8_t ptr;
+    uint32_t reads;
+} Sim_RegDeviceTypeDef;
+
+/**
+ * @brief  Slave that lost a clock in the middle of a read: it holds SDA low
+ *         until it has seen the rest of its bits on SCL
+ */
+typedef struct
+{
+    uint8_t bits;    /* Falling SCL edges until it lets go, 0 when released */
+    uint32_t clocks; /* Falling SCL edges seen */
+} Sim_StuckTypeDef;
+
+/**
+ * @brief  Interrupt source that keeps the CPU for SIM_HOG_US every
+ *         SIM_HOG_PERIOD_US until a deadline
+ */
+typedef struct
+{
+    uint64_t next;  /* Time of the next interrupt */
+    uint64_t until; /* No interrupt after this */
+    uint32_t runs;  /* Handlers run */
+} Sim_HogTypeDef;
+
+static Sim_RegDeviceTypeDef reg_model;
+static Sim_StuckTypeDef stuck_model;
+static Sim_HogTypeDef hog_model;
+static Sim_SourceTypeDef hog_source;
+static Sim_HogTypeDef scroll_timer;
+static Sim_SourceTypeDef scroll_source;
+static LCD_ScrollerTypeDef scroller;
+static uint64_t bus_doneNs;
+static uint8_t bus_lcdBusy;
+
+static volatile uint8_t async_done;
+static HAL_StatusTypeDef async_status;
+
+static Scheduler_HandleTypeDef sched;
+static DHT22_HistoryTypeDef history;
+static int8_t history_1min;
+static int8_t lcd_task;
+
+/* -------------------------------------------------------------------------- */
+/*                                  Harness                                   */
+/* -------------------------------------------------------------------------- */
+
+/* Fresh simulation: the board of main.c with a sensor on PA0 and the LCD on I2C1 */
+static void Sim_Setup(uint8_t i2c_dma)
+{
+    Sim_Init();
+
+    memset(&htim1, 0, sizeof(htim1));
+    memset(&htim2, 0, sizeof(htim2));
+    memset(&hi2c1, 0, sizeof(hi2c1));
+    memset(&dht22, 0, sizeof(dht22));
+    memset(&hlcd, 0, sizeof(hlcd));
+    memset(&hbus1, 0, sizeof(hbus1));
+
+    // TIM1: shared 1 MHz timebase
+    htim1.Instance = TIM1;
+    htim1.Init.Prescaler = 71;
+    htim1.Init.Period = 65535;
+    HAL_TIM_Base_Init(&htim1);
+    Timebase_Init(&htim1);
+
+    // TIM2: channel 1 captures PA0 falling edges into DMA1 channel 5
+    htim2.Instance = TIM2;
+    htim2.Init.Prescaler = 71;
+    htim2.Init.Period = 65535;
+    HAL_TIM_Base_Init(&htim2);
+    hdma_tim2_ch1.Instance = DMA1_Channel5;
+    hdma_tim2_ch1.Parent = &htim2;
+    htim2.hdma[TIM_DMA_ID_CC1] = &hdma_tim2_ch1;
+    Sim_TIM_ConnectCapture(TIM2, TIM_CHANNEL_1, GPIOA, GPIO_PIN_0, TIM_INPUTCHANNELPOLARITY_FALLING);
+
+    // I2C1 at 100 kHz, DMA on channels 6 and 7 unless testing the other paths
+    hi2c1.Instance = I2C1;
+    hi2c1.Init.ClockSpeed = 100000;
+    hi2c1.Init.DutyCycle = I2C_DUTYCYCLE_2;
+    hdma_i2c1_tx.Instance = DMA1_Channel6;
+    hdma_i2c1_tx.Parent = &hi2c1;
+    hdma_i2c1_rx.Instance = DMA1_Channel7;
+    hdma_i2c1_rx.Parent = &hi2c1;
+    hi2c1.hdmatx = i2c_dma ? &hdma_i2c1_tx : NULL;
+    hi2c1.hdmarx = i2c_dma ? &hdma_i2c1_rx : NULL;
+    HAL_I2C_Init(&hi2c1);
+
+    Sim_DHT22_Init(&sensor, GPIOA, GPIO_PIN_0);
+    Sim_LCD_Init(&lcd_model, I2C1, LCD_ADDR);
+}
+
+static uint8_t Sim_Check(uint8_t ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("    FAILED: %s\n", what);
+    }
+    return ok;
+}
+
+/* Bus layer view of the LCD traffic since I2C_Bus_Init() */
+static void Sim_BusReport(void)
+{
+    I2C_Bus_StatsTypeDef lcd;
+
+    if (I2C_Bus_GetStats(&hbus1, LCD_ADDR, &lcd) != HAL_OK)
+    {
+        return;
+    }
+    printf("    lcd %lu xfers %lu B, latency %lu/%lu us, %lu nack %lu busy %lu resent, bus %u permille\n",
+           (unsigned long)lcd.transactions, (unsigned long)lcd.bytes, (unsigned long)lcd.latencyMin,
+           (unsigned long)lcd.latencyMax, (unsigned long)lcd.nacks, (unsigned long)lcd.busyWaits,
+           (unsigned long)lcd.retries, I2C_Bus_Utilisation(&hbus1));
+}
+
+static void Sim_Report(const char *name, uint8_t ok)
+{
+    printf("%-20s %-4s cpu %9.1f us  sleep %10.1f us  polls %6lu  irqs %4lu  i2c %5lu B %9.1f us  timer %9.1f us\n",
+           name, ok ? "ok" : "FAIL", Sim_Stats.busyNs / 1000.0, Sim_Stats.sleepNs / 1000.0,
+           (unsigned long)Sim_Stats.polls, (unsigned long)Sim_Stats.irqs, (unsigned long)Sim_Stats.i2cBytes,
+           Sim_Stats.i2cBusNs / 1000.0, Sim_Stats.timerRunNs / 1000.0);
+}
+
+static void Sim_ReadCplt(DHT22_HandleTypeDef *dht22x, HAL_StatusTypeDef status)
+{
+    UNUSED(dht22x);
+    async_status = status;
+    async_done = 1;
+}
+
+/* Start an asynchronous read and sleep until it completes */
+static HAL_StatusTypeDef Sim_ReadAsync(void)
+{
+    uint64_t start = Sim_Now();
+
+    async_done = 0;
+    if (DHT22_StartAsync(&dht22) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+    while (!async_done && Sim_Now() - start < SIM_ASYNC_TIMEOUT_NS)
+    {
+        __WFI();
+    }
+    return async_done ? async_status : HAL_ERROR;
+}
+
+static uint8_t Sim_LineIs(uint8_t row, const char *text)
+{
+    char line[LCD_COLS + 1];
+    char want[LCD_COLS + 1];
+
+    Sim_LCD_ReadLine(&lcd_model, row, line, LCD_COLS);
+    snprintf(want, sizeof(want), "%-16s", text);
+    if (strcmp(line, want) != 0)
+    {
+        printf("    row %u: \"%s\", expected \"%s\"\n", row, line, want);
+        return 0;
+    }
+    return 1;
+}
+
+static void Hog_Irq(void *arg)
+{
+    Sim_HogTypeDef *hog = (Sim_HogTypeDef *)arg;
+
+    hog->runs++;
+    Sim_Busy(SIM_HOG_US * 1000ULL);
+}
+
+static uint64_t Hog_Next(void *ctx)
+{
+    Sim_HogTypeDef *hog = (Sim_HogTypeDef *)ctx;
+    return (hog->next <= hog->until) ? hog->next : SIM_NEVER;
+}
+
+static void Hog_Run(void *ctx, uint64_t now)
+{
+    Sim_HogTypeDef *hog = (Sim_HogTypeDef *)ctx;
+
+    if (hog->next <= now && hog->next <= hog->until)
+    {
+        hog->next = now + SIM_HOG_PERIOD_US * 1000ULL;
+        Sim_RaiseIrq(Hog_Irq, hog);
+    }
+}
+
+/* Keep raising the hog interrupt for the next ns */
+static void Hog_Start(uint64_t ns)
+{
+    hog_model.next = Sim_Now();
+    hog_model.until = Sim_Now() + ns;
+    hog_model.runs = 0;
+    hog_source = (Sim_SourceTypeDef){Hog_Next, Hog_Run, &hog_model};
+    Sim_AddSource(&hog_source);
+}
+
+/* Timer callback of the scroller: it only asks for the step */
+static void ScrollTimer_Irq(void *arg)
+{
+    Sim_HogTypeDef *timer = (Sim_HogTypeDef *)arg;
+
+    timer->runs++;
+    LCD_Scroller_Request(&scroller);
+}
+
+static void ScrollTimer_Run(void *ctx, uint64_t now)
+{
+    Sim_HogTypeDef *timer = (Sim_HogTypeDef *)ctx;
+
+    if (timer->next <= now && timer->next <= timer->until)
+    {
+        timer->next = now + SIM_SCROLL_PERIOD_US * 1000ULL;
+        Sim_RaiseIrq(ScrollTimer_Irq, timer);
+    }
+}
+
+/* Deterministic pseudo-random numbers for the history scenario */
+static uint32_t History_Random(uint32_t *state)
+{
+    *state = *state * 1664525UL + 1013904223UL;
+    return *state >> 8;
+}
+
+/* Two-pass statistics of the newest count values of a ring, the shared
+ * rounding and variance code of the history left out */
+static void History_Reference(const int16_t *ring, uint32_t newest, uint16_t count, DHT22_History_StatsTypeDef *stats)
+{
+    int32_t sum = 0;
+    double mean, sq = 0.0;
+
+    stats->count = count;
+    stats->min = INT16_MAX;
+    stats->max = INT16_MIN;
+    for (uint16_t age = 0; age < count; age++)
+    {
+        int16_t value = ring[(newest - age) % DHT22_HISTORY_WINDOW_MAX];
+        sum += value;
+        stats->min = (value < stats->min) ? value : stats->min;
+        stats->max = (value > stats->max) ? value : stats->max;
+    }
+
+    // Nearest, halves away from zero
+    int32_t twice = 2 * sum, n = count;
+    stats->mean = (int16_t)((sum >= 0) ? (twice + n) / (2 * n) : -((n - twice) / (2 * n)));
+
+    mean = (double)sum / count;
+    for (uint16_t age = 0; age < count; age++)
+    {
+        double d = ring[(newest - age) % DHT22_HISTORY_WINDOW_MAX] - mean;
+        sq += d * d;
+    }
+    stats->variance = (count > 1U) ? (uint32_t)(sq / (count - 1U) + 1e-6) : 0U;
+}
+
+static uint8_t History_Same(const DHT22_History_StatsTypeDef *a, const DHT22_History_StatsTypeDef *b)
+{
+    return a->count == b->count && a->min == b->min && a->max == b->max && a->mean == b->mean &&
+           a->variance == b->variance;
+}
+
+/* Record contents derived from the timestamp, so a walk can check them */
+static FlashLog_StatusTypeDef Log_Append(FlashLog_HandleTypeDef *hlog, uint32_t time)
+{
+    return FlashLog_Append(hlog, time, (int16_t)(time / 10U), (int16_t)(-(int32_t)(time / 10U)));
+}
+
+/* Append and program records 10 s apart until the newest page is full or
+ * programming fails */
+static void Log_FillPage(FlashLog_HandleTypeDef *hlog, uint32_t *time)
+{
+    do
+    {
+        *time += 10U;
+        Log_Append(hlog, *time);
+    } while (FlashLog_Flush(hlog) == FLASHLOG_OK && hlog->writeOffset + FLASHLOG_RECORD_BYTES <= SIM_FLASH_PAGE_SIZE);
+}
+
+/* Read the log from a time on: records must rise and match their timestamp.
+ * Returns the number read, 0xFFFF if one is wrong. */
+static uint16_t Log_Walk(FlashLog_HandleTypeDef *hlog, uint32_t from, uint32_t *first, uint32_t *last)
+{
+    FlashLog_CursorTypeDef cur;
+    FlashLog_RecordTypeDef rec;
+    uint16_t count = 0;
+
+    *first = *last = 0;
+    if (FlashLog_Seek(hlog, from, &cur) != FLASHLOG_OK)
+    {
+        return 0;
+    }
+    while (FlashLog_Next(hlog, &cur, &rec) == FLASHLOG_OK)
+    {
+        if (rec.time < from || (count > 0U && rec.time <= *last) || rec.humidity != (int16_t)(rec.time / 10U) ||
+            rec.temperature != (int16_t)(-(int32_t)(rec.time / 10U)))
+        {
+            printf("    record %lu out of place or damaged\n", (unsigned long)rec.time);
+            return 0xFFFFU;
+        }
+        *first = (count == 0U) ? rec.time : *first;
+        *last = rec.time;
+        count++;
+    }
+    return count;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Scenarios                                  */
+/* -------------------------------------------------------------------------- */
+
+/* A blocking read, then the float API called back to back: the second call
+ * falls in the cooldown of the first and never triggers the sensor, and the
+ * cache and the other read paths know about the trigger */
+static uint8_t Scenario_DHT22_Blocking(void)
+{
+    DHT22_ReadingTypeDef r;
+    uint32_t age_ms;
+    float humidity, temperature;
+    uint8_t ok = 1;
+
+    Sim_Setup(1);
+    DHT22_Init(&dht22, &htim1, GPIOA, GPIO_PIN_0);
+    DHT22_Init_Async(&dht22, &htim2, TIM_CHANNEL_1, Sim_ReadCplt);
+    Sim_DHT22_Set(&sensor, 455, 234);
+
+    Sim_ResetStats();
+    ok &= Sim_Check(DHT22_Read_Raw(&dht22, &r) == HAL_OK, "read status");
+    ok &= Sim_Check(r.humidity == 455 && r.temperature == 234, "reading");
+    Sim_Report("dht22 blocking", ok);
+
+    HAL_Delay(DHT22_MIN_INTERVAL_MS);
+    Sim_DHT22_Set(&sensor, 501, -37);
+    Sim_ResetStats();
+    uint32_t frames = sensor.frames;
+    ok &= Sim_Check(DHT22_Read_Data(&dht22, &humidity, &temperature) == HAL_OK && humidity > 50.05f &&
+                        humidity < 50.15f && temperature > -3.75f && temperature < -3.65f,
+                    "float read");
+    ok &= Sim_Check(DHT22_Read_Data(&dht22, &humidity, &temperature) == HAL_BUSY, "second read refused");
+    ok &= Sim_Check(sensor.frames == frames + 1U && sensor.earlyTriggers == 0U, "sensor triggered once");
+    ok &= Sim_Check(DHT22_Get_Cached(&dht22, &r, &age_ms) == HAL_OK && r.humidity == 501 && r.temperature == -37,
+                    "cache updated");
+    ok &= Sim_Check(DHT22_Read_Cached(&dht22, &r, NULL) == HAL_OK && DHT22_StartAsync(&dht22) == HAL_BUSY &&
+                        sensor.frames == frames + 1U,
+                    "cooldown shared");
+    Sim_Report("dht22 read cooldown", ok);
+    return ok;
+}
+
+static uint8_t Scenario_DHT22_Faults(void)
+{
+    DHT22_ReadingTypeDef r;
+    uint8_t ok = 1;
+
+    Sim_Setup(1);
+    DHT22_Init(&dht22, &htim1, GPIOA, GPIO_PIN_0);
+
+    Sim_DHT22_Set(&sensor, 1000, -102);
+    ok &= Sim_Check(DHT22_Read_Raw(&dht22, &r) == HAL_OK && r.temperature == -102 && r.humidity == 1000,
+                    "negative temperature");
+
+    HAL_Delay(DHT22_MIN_INTERVAL_MS);
+    Sim_DHT22_SetFault(&sensor, SIM_DHT22_FAULT_CHECKSUM);
+    ok &= Sim_Check(DHT22_Read_Raw(&dht22, &r) == HAL_ERROR && DHT22_GetError(&dht22) == DHT22_ERROR_CHECKSUM,
+                    "checksum error");
+
+    HAL_Delay(DHT22_MIN_INTERVAL_MS);
+    Sim_DHT22_SetFault(&sensor, SIM_DHT22_FAULT_TRUNCATE);
+    ok &= Sim_Check(DHT22_Read_Raw(&dht22, &r) == HAL_TIMEOUT &&
+                        DHT22_GetError(&dht22) == DHT22_ERROR_TIMEOUT_BIT_END,
+                    "truncated frame");
+
+    // The worst case for the blocking reader: it spins for the whole budget
+    HAL_Delay(DHT22_MIN_INTERVAL_MS);
+    Sim_DHT22_SetFault(&sensor, SIM_DHT22_FAULT_SILENT);
+    Sim_ResetStats();
+    ok &= Sim_Check(DHT22_Read_Raw(&dht22, &r) == HAL_TIMEOUT &&
+                        DHT22_GetError(&dht22) == DHT22_ERROR_TIMEOUT_RESPONSE_LOW,
+                    "silent sensor");
+    ok &= Sim_Check(sensor.earlyTriggers == 0U, "trigger interval");
+    Sim_Report("dht22 faults", ok);
+    return ok;
+}
+
+static uint8_t Scenario_DHT22_Async(void)
+{
+    uint8_t ok = 1;
+
+    Sim_Setup(1);
+    DHT22_Init(&dht22, &htim1, GPIOA, GPIO_PIN_0);
+    DHT22_Init_Async(&dht22, &htim2, TIM_CHANNEL_1, Sim_ReadCplt);
+    Sim_DHT22_Set(&sensor, 612, -55);
+
+    Sim_ResetStats();
+    ok &= Sim_Check(Sim_ReadAsync() == HAL_OK, "read status");
+    ok &= Sim_Check(dht22.reading.humidity == 612 && dht22.reading.temperature == -55, "reading");
+    ok &= Sim_Check(Sim_Stats.captures == DHT22_CAPTURE_EDGES, "captured edges");
+    Sim_Report("dht22 async", ok);
+
+    // A silent sensor ends on the frame timeout, still without polling
+    HAL_Delay(DHT22_MIN_INTERVAL_MS);
+    Sim_DHT22_SetFault(&sensor, SIM_DHT22_FAULT_SILENT);
+    Sim_ResetStats();
+    ok &= Sim_Check(Sim_ReadAsync() == HAL_TIMEOUT, "silent sensor");
+    Sim_Report("dht22 async silent", ok);
+    return ok;
+}
+
+/* With shared set the LCD goes through the bus queue, by DMA or interrupt */
+static uint8_t Scenario_DHT22_Group(void)
+{
+    static DHT22_HandleTypeDef skewed, slow, missing;
+    static Sim_DHT22_TypeDef skewed_model, slow_model;
+    DHT22_GroupTypeDef group;
+    uint8_t ok = 1;
+
+    // PA0 on time, PA1 and PA2 with clocks off both ways, nothing on PA3
+    Sim_Setup(1);
+    Sim_DHT22_Init(&skewed_model, GPIOA, GPIO_PIN_1);
+    Sim_DHT22_Init(&slow_model, GPIOA, GPIO_PIN_2);
+    DHT22_Init(&dht22, &htim1, GPIOA, GPIO_PIN_0);
+    DHT22_Init(&skewed, &htim1, GPIOA, GPIO_PIN_1);
+    DHT22_Init(&slow, &htim1, GPIOA, GPIO_PIN_2);
+    DHT22_Init(&missing, &htim1, GPIOA, GPIO_PIN_3);
+    Sim_DHT22_Set(&sensor, 455, 234);
+    Sim_DHT22_Set(&skewed_model, 620, -51);
+    Sim_DHT22_SetSkew(&skewed_model, 15);
+    Sim_DHT22_Set(&slow_model, 1000, -400);
+    Sim_DHT22_SetSkew(&slow_model, -10);
+
+    DHT22_Group_Init(&group, GPIOA);
+    ok &= Sim_Check(DHT22_Group_Add(&group, &dht22) == HAL_OK && DHT22_Group_Add(&group, &skewed) == HAL_OK &&
+                        DHT22_Group_Add(&group, &slow) == HAL_OK && DHT22_Group_Add(&group, &missing) == HAL_OK,
+                    "add sensors");
+    ok &= Sim_Check(DHT22_Group_Add(&group, &skewed) == HAL_ERROR, "pin used twice");
+
+    // Long handlers keep firing through the whole read
+    Sim_ResetStats();
+    Hog_Start(10000000ULL);
+    ok &= Sim_Check(DHT22_Group_Read(&group) == HAL_ERROR, "group status");
+    ok &= Sim_Check(group.status[0] == HAL_OK && dht22.reading.humidity == 455 && dht22.reading.temperature == 234,
+                    "sensor on time");
+    ok &= Sim_Check(group.status[1] == HAL_OK && skewed.reading.humidity == 620 && skewed.reading.temperature == -51,
+                    "fast clock sensor");
+    ok &= Sim_Check(group.status[2] == HAL_OK && slow.reading.humidity == 1000 && slow.reading.temperature == -400,
+                    "slow clock sensor");
+    ok &= Sim_Check(group.status[3] == HAL_TIMEOUT && DHT22_GetError(&missing) == DHT22_ERROR_TIMEOUT_RESPONSE_LOW,
+                    "missing sensor");
+    ok &= Sim_Check(hog_model.runs > 0U, "handlers ran after the read");
+
+    ok &= Sim_Check(DHT22_Group_Read(&group) == HAL_BUSY, "cooldown");
+    HAL_Delay(DHT22_MIN_INTERVAL_MS);
+    Sim_DHT22_Set(&skewed_model, 621, -50);
+    ok &= Sim_Check(DHT22_Group_Read(&group) == HAL_ERROR && group.status[1] == HAL_OK &&
+                        skewed.reading.humidity == 621 && group.status[3] == HAL_TIMEOUT,
+                    "second read");
+    ok &= Sim_Check(sensor.earlyTriggers == 0U && skewed_model.earlyTriggers == 0U, "trigger interval");
+    Sim_Report("dht22 group", ok);
+    return ok;
+}
+
+static uint8_t Scenario_History(void)
+{
+    DHT22_History_StatsTypeDef inc, ref;
+    uint32_t rng = 12345U;
+    static int16_t shadow[DHT22_HISTORY_CHANNELS][DHT22_HISTORY_WINDOW_MAX];
+    DHT22_History_StatsTypeDef own;
+    int16_t humidity = 500, temperature = 0;
+    int8_t windows[2];
+    uint8_t ok = 1;
+
+    Sim_ResetStats();
+    DHT22_History_Init(&history);
+    windows[0] = DHT22_History_AddWindow(&history, DHT22_HISTORY_WINDOW_MAX);
+    windows[1] = DHT22_History_AddWindow(&history, SIM_HISTORY_SHORT);
+    ok &= Sim_Check(windows[0] >= 0 && windows[1] >= 0, "add windows");
+    ok &= Sim_Check(DHT22_History_AddWindow(&history, DHT22_HISTORY_WINDOW_MAX + 1U) < 0, "window too long");
+
+    for (uint32_t n = 0; ok && n < SIM_HISTORY_PUSHES; n++)
+    {
+        // Random walks with plateaus (ties in the deques) and jumps, the
+        // temperature swinging through the negative range
+        uint32_t r = History_Random(&rng);
+        switch (r % 8U)
+        {
+        case 0:
+            temperature = (int16_t)((int32_t)(History_Random(&rng) % 1201U) - 400);
+            break;
+        case 1:
+        case 2:
+            break;
+        default:
+            temperature = (int16_t)(temperature + (int16_t)((r >> 4) % 21U) - 10);
+            break;
+        }
+        humidity = (int16_t)((r >> 12) % 1001U);
+        if (temperature < -400 || temperature > 800)
+        {
+            temperature = (int16_t)((temperature < 0) ? -400 : 800);
+        }
+        DHT22_History_Push(&history, humidity, temperature);
+        shadow[DHT22_HISTORY_HUMIDITY][n % DHT22_HISTORY_WINDOW_MAX] = humidity;
+        shadow[DHT22_HISTORY_TEMPERATURE][n % DHT22_HISTORY_WINDOW_MAX] = temperature;
+
+        for (uint8_t w = 0; w < 2U; w++)
+        {
+            uint16_t length = (w == 0U) ? DHT22_HISTORY_WINDOW_MAX : SIM_HISTORY_SHORT;
+            for (uint8_t ch = 0; ch < DHT22_HISTORY_CHANNELS; ch++)
+            {
+                DHT22_History_GetStats(&history, windows[w], ch, &inc);
+                DHT22_History_Compute(&history, length, ch, &ref);
+                History_Reference(shadow[ch], n, (n < length) ? (uint16_t)(n + 1U) : length, &own);
+                if (!History_Same(&inc, &ref) || !History_Same(&ref, &own))
+                {
+                    printf("    push %lu window %u channel %u: %u %d/%d/%d/%lu, rescan %u %d/%d/%d/%lu, "
+                           "two-pass %u %d/%d/%d/%lu\n",
+                           (unsigned long)n, length, ch, inc.count, inc.min, inc.max, inc.mean,
+                           (unsigned long)inc.variance, ref.count, ref.min, ref.max, ref.mean,
+                           (unsigned long)ref.variance, own.count, own.min, own.max, own.mean,
+                           (unsigned long)own.variance);
+                    ok = 0;
+                }
+            }
+        }
+    }
+    ok &= Sim_Check(ok, "incremental statistics match the rescan and the two-pass reference");
+    ok &= Sim_Check(DHT22_History_Count(&history) == DHT22_HISTORY_CAPACITY, "buffer full");
+    Sim_Report("dht22 history", ok);
+    return ok;
+}
+
+static uint8_t Scenario_FlashLog(void)
+{
+    FlashLog_HandleTypeDef hlog;
+    FlashLog_CursorTypeDef cur;
+    FlashLog_RecordTypeDef rec;
+    uint32_t first, last, time, before;
+    uint16_t per_page = (SIM_FLASH_PAGE_SIZE - FLASHLOG_HEADER_BYTES) / FLASHLOG_RECORD_BYTES;
+    uint8_t ok = 1;
+
+    Sim_ResetStats();
+    Sim_Flash_Init();
+    ok &= Sim_Check(FlashLog_Init(&hlog, &Sim_Flash) == FLASHLOG_OK && hlog.used == 0U &&
+                        FlashLog_Seek(&hlog, 0, &cur) == FLASHLOG_END,
+                    "blank region");
+
+    // Three times around the ring: only the newest SIM_FLASH_PAGES pages stay
+    for (time = 10U; time <= 600U; time += 10U)
+    {
+        ok &= Sim_Check(Log_Append(&hlog, time) == FLASHLOG_OK, "append");
+    }
+    FlashLog_Flush(&hlog);
+    ok &= Sim_Check(Log_Walk(&hlog, 0, &first, &last) == SIM_FLASH_PAGES * per_page && first == 410U && last == 600U,
+                    "wrap-around");
+    ok &= Sim_Check(FlashLog_Init(&hlog, &Sim_Flash) == FLASHLOG_OK && hlog.used == SIM_FLASH_PAGES &&
+                        FlashLog_LastTime(&hlog) == 600U && hlog.corrupted == 0U &&
+                        Log_Walk(&hlog, 0, &first, &last) == SIM_FLASH_PAGES * per_page && first == 410U,
+                    "reopen after wrap-around");
+
+    // Seek lands inside the second page and Next runs over three page ends
+    ok &= Sim_Check(Log_Walk(&hlog, 455U, &first, &last) == 15U && first == 460U && last == 600U, "seek between");
+    ok &= Sim_Check(Log_Walk(&hlog, 510U, &first, &last) == 10U && first == 510U, "seek on a page start");
+    ok &= Sim_Check(Log_Walk(&hlog, 5U, &first, &last) == 20U && first == 410U, "seek before the oldest");
+    ok &= Sim_Check(FlashLog_Seek(&hlog, 10000U, &cur) == FLASHLOG_OK && FlashLog_Next(&hlog, &cur, &rec) == FLASHLOG_END,
+                    "seek past the newest");
+
+    // Power lost in the second record of a batch: header (6 half-words),
+    // one record (5) and 2 half-words of the next
+    Sim_Flash_CutAfter(6U + 5U + 2U);
+    for (time = 610U; time <= 640U; time += 10U)
+    {
+        Log_Append(&hlog, time);
+    }
+    Sim_Flash_CutAfter(SIM_FLASH_NO_CUT);
+    ok &= Sim_Check(FlashLog_Init(&hlog, &Sim_Flash) == FLASHLOG_OK && hlog.corrupted == 1U &&
+                        FlashLog_LastTime(&hlog) == 610U,
+                    "torn record found");
+    for (time = 650U; time <= 680U; time += 10U)
+    {
+        Log_Append(&hlog, time);
+    }
+    ok &= Sim_Check(Log_Walk(&hlog, 600U, &first, &last) == 6U && first == 600U && last == 680U,
+                    "append after a torn record");
+
+    // A failed run without a reset: the handle must not program over the
+    // slots it has started
+    Sim_Flash_CutAfter(2U);
+    for (time = 690U; time <= 720U; time += 10U)
+    {
+        Log_Append(&hlog, time);
+    }
+    Sim_Flash_CutAfter(SIM_FLASH_NO_CUT);
+    for (time = 730U; time <= 760U; time += 10U)
+    {
+        ok &= Sim_Check(Log_Append(&hlog, time) == FLASHLOG_OK, "append after a failed run");
+    }
+    ok &= Sim_Check(Log_Walk(&hlog, 680U, &first, &last) == 5U && first == 680U && last == 760U,
+                    "failed slots skipped");
+
+    // Power lost while a recycled page gets its header: the magic is missing
+    time = 760U;
+    Log_FillPage(&hlog, &time);
+    before = time;
+    Sim_Flash_CutAfter(3U);
+    Log_Append(&hlog, time + 10U);
+    ok &= Sim_Check(FlashLog_Flush(&hlog) == FLASHLOG_ERROR, "cut during header");
+    Sim_Flash_CutAfter(SIM_FLASH_NO_CUT);
+    ok &= Sim_Check(FlashLog_Init(&hlog, &Sim_Flash) == FLASHLOG_OK && hlog.used == SIM_FLASH_PAGES - 1U &&
+                        FlashLog_LastTime(&hlog) == before && Log_Walk(&hlog, 0, &first, &last) != 0xFFFFU &&
+                        last == before,
+                    "header without magic ignored");
+    time += 20U;
+    Log_Append(&hlog, time);
+    FlashLog_Flush(&hlog);
+    ok &= Sim_Check(FlashLog_Init(&hlog, &Sim_Flash) == FLASHLOG_OK && hlog.used == SIM_FLASH_PAGES &&
+                        Log_Walk(&hlog, before, &first, &last) == 2U && last == time,
+                    "page recycled after a torn header");
+
+    // Header CRC broken on the newest page: its records go, the log goes on
+    Log_FillPage(&hlog, &time);
+    before = time;
+    time += 10U;
+    Log_Append(&hlog, time);
+    FlashLog_Flush(&hlog);
+    uint32_t header = ((hlog.oldest + hlog.used - 1U) % SIM_FLASH_PAGES) * SIM_FLASH_PAGE_SIZE;
+    Sim_Flash_ClearBits(header + FLASHLOG_HEADER_BYTES - 2U, 0xFFFFU); // The CRC half-word
+    ok &= Sim_Check(FlashLog_Init(&hlog, &Sim_Flash) == FLASHLOG_OK && FlashLog_LastTime(&hlog) == before &&
+                        Log_Walk(&hlog, 0, &first, &last) != 0xFFFFU && last == before,
+                    "header with a bad CRC ignored");
+    time += 10U;
+    Log_Append(&hlog, time);
+    FlashLog_Flush(&hlog);
+    ok &= Sim_Check(FlashLog_Init(&hlog, &Sim_Flash) == FLASHLOG_OK && hlog.used == SIM_FLASH_PAGES &&
+                        Log_Walk(&hlog, before, &first, &last) == 2U && last == time,
+                    "append after a bad header");
+
+    Sim_Report("flash log", ok);
+    return ok;
+}
+
+static uint8_t Scenario_LCD(const char *name, const I2C_Bus_ProfileTypeDef *profile, uint8_t i2c_dma,
+                            uint8_t shared)
+{
+    uint8_t ok = 1;
+
+    Sim_Setup(i2c_dma);
+    I2C_Bus_Init(&hbus1, &hi2c1);
+    I2C_Bus_SetProfile(&hbus1, LCD_ADDR, profile);
+    LCD_Init(&hlcd, &hi2c1, LCD_ADDR);
+    if (shared)
+    {
+        LCD_SetBus(&hlcd, &hbus1);
+    }
+    ok &= Sim_Check(LCD_WaitIdle(&hlcd) == HAL_OK, "init drained");
+
+    Sim_ResetStats();
+    LCD_WriteString(&hlcd, 0, 0, "DHT22 + LCD");
+    LCD_WriteString(&hlcd, 0, 1, "Initialized!");
+    LCD_Flush(&hlcd);
+    ok &= Sim_Check(LCD_WaitIdle(&hlcd) == HAL_OK, "flush drained");
+    ok &= Sim_Check(Sim_LineIs(0, "DHT22 + LCD") && Sim_LineIs(1, "Initialized!"), "display contents");
+
+    // Clear holds the queue for 1.52 ms, the rewrite must wait for it
+    LCD_Clear_Display(&hlcd);
+    LCD_WriteString(&hlcd, 0, 0, "Temp: 23.4 C");
+    LCD_Flush(&hlcd);
+    ok &= Sim_Check(LCD_WaitIdle(&hlcd) == HAL_OK, "clear drained");
+    ok &= Sim_Check(Sim_LineIs(0, "Temp: 23.4 C") && Sim_LineIs(1, ""), "contents after clear");
+    ok &= Sim_Check(lcd_model.violations == 0U, "controller timing");
+    Sim_Report(name, ok);
+    Sim_BusReport();
+
+    uint32_t us = LCD_Benchmark(&hlcd);
+    ok &= Sim_Check(us != 0U, "benchmark");
+    printf("    full redraw %lu us\n", (unsigned long)us);
+    return ok;
+}
+
+/* Hardware scroller stepped from a timer interrupt while the main loop keeps
+ * redrawing the other row: the interrupt only flags the step, the main loop
+ * sends it, and its redraws wait until the display shift is undone */
+static uint8_t Scenario_Scroller(void)
+{
+    static const char message[] = "Outdoor 12.3 C  Indoor 21.7 C";
+    uint8_t ok = 1;
+    uint8_t refused = 1;
+    uint32_t steps = 0;
+    char text[LCD_COLS + 1];
+
+    Sim_Setup(1);
+    LCD_Init(&hlcd, &hi2c1, LCD_ADDR);
+    ok &= Sim_Check(LCD_WaitIdle(&hlcd) == HAL_OK, "init drained");
+    ok &= Sim_Check(LCD_Scroller_Init(&scroller, &hlcd, 0, message, 0, 1) == HAL_OK && scroller.hardware,
+                    "hardware scroller");
+    ok &= Sim_Check(LCD_WaitIdle(&hlcd) == HAL_OK, "message loaded");
+
+    Sim_ResetStats();
+    scroll_timer.next = Sim_Now() + SIM_SCROLL_PERIOD_US * 1000ULL;
+    scroll_timer.until = Sim_Now() + SIM_SCROLL_NS;
+    scroll_timer.runs = 0;
+    scroll_source = (Sim_SourceTypeDef){Hog_Next, ScrollTimer_Run, &scroll_timer};
+    Sim_AddSource(&scroll_source);
+
+    uint64_t start = Sim_Now();
+    for (uint32_t pass = 0; Sim_Now() - start < SIM_SCROLL_NS + SIM_SCROLL_PERIOD_US * 1000ULL; pass++)
+    {
+        snprintf(text, sizeof(text), "Pass %lu", (unsigned long)pass);
+        LCD_WriteString(&hlcd, 0, 1, text);
+        refused &= (LCD_Flush(&hlcd) == 0U);
+        steps += LCD_Scroller_Tick(&scroller);
+        LCD_Process(&hlcd);
+        Sim_Busy(SIM_POLL_COST_NS);
+    }
+    ok &= Sim_Check(LCD_WaitIdle(&hlcd) == HAL_OK, "steps drained");
+    ok &= Sim_Check(steps == scroll_timer.runs && steps != 0U, "one step per request");
+    ok &= Sim_Check(Sim_Stats.irqMaxNs < SIM_IRQ_MAX_NS, "no step sent from the interrupt");
+    ok &= Sim_Check(refused && Sim_LineIs(1, ""), "flush waits for the shift");
+
+    snprintf(text, sizeof(text), "%.16s", &message[scroller.pos]);
+    ok &= Sim_Check(lcd_model.shift == scroller.pos && Sim_LineIs(0, text), "scrolled window");
+
+    LCD_Scroller_Stop(&scroller);
+    LCD_WriteString(&hlcd, 0, 1, "Stopped         ");
+    ok &= Sim_Check(LCD_Flush(&hlcd) != 0U && LCD_WaitIdle(&hlcd) == HAL_OK, "flush after stop");
+    ok &= Sim_Check(Sim_LineIs(0, "Outdoor 12.3 C") && Sim_LineIs(1, "Stopped"), "contents after stop");
+    ok &= Sim_Check(lcd_model.violations == 0U, "controller timing");
+    Sim_Report("lcd scroller", ok);
+    printf("    %lu steps requested from the timer, all sent from the main loop\n", (unsigned long)steps);
+    return ok;
+}
+
+static uint8_t Sim_Reg_Write(void *ctx, const uint8_t *data, uint16_t len, uint64_t first_ns, uint64_t byte_ns)
+{
+    Sim_RegDeviceTypeDef *dev = (Sim_RegDeviceTypeDef *)ctx;
+    (void)first_ns;
+    (void)byte_ns;
+
+    dev->ptr = data[0];
+    for (uint16_t i = 1; i < len; i++)
+    {
+        dev->regs[dev->ptr++] = data[i];
+    }
+    return 1;
+}
+
+static uint8_t Sim_Reg_Read(void *ctx, uint8_t *data, uint16_t len)
+{
+    Sim_RegDeviceTypeDef *dev = (Sim_RegDeviceTypeDef *)ctx;
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        data[i] = dev->regs[dev->ptr++];
+    }
+    dev->reads++;
+    return 1;
+}
+
+static void Bus_ReadDone(I2C_Bus_TransactionTypeDef *xfer)
+{
+    (void)xfer;
+    bus_doneNs = Sim_Now();
+    bus_lcdBusy = !LCD_IsIdle(&hlcd);
+}
+
+static uint8_t Bus_Wait(I2C_Bus_TransactionTypeDef *xfer)
+{
+    uint64_t start = Sim_Now();
+
+    while (xfer->pending && Sim_Now() - start < SIM_ASYNC_TIMEOUT_NS)
+    {
+        Sim_Busy(SIM_POLL_COST_NS);
+    }
+    return !xfer->pending;
+}
+
+/* A register read submitted while the LCD streams at 100 kHz only waits for
+ * the running chunk, and each device keeps its own clock profile. Register
+ * accesses start from the completion interrupt, which never polls their
+ * address phase */
+static uint8_t Scenario_Bus(void)
+{
+    uint8_t ok = 1;
+    uint8_t raw[6];
+    uint8_t config[2] = {0xC3, 0x3C};
+    I2C_Bus_TransactionTypeDef read = {.addr = SIM_REG_ADDR,
+                                       .op = I2C_BUS_OP_MEM_READ,
+                                       .priority = I2C_BUS_PRIORITY_SENSOR,
+                                       .memAddr = 0xF7,
+                                       .memAddrSize = I2C_MEMADD_SIZE_8BIT,
+                                       .pData = raw,
+                                       .size = sizeof(raw),
+                                       .done = Bus_ReadDone};
+    I2C_Bus_TransactionTypeDef write = read;
+    I2C_Bus_TransactionTypeDef absent = read;
+    I2C_Bus_StatsTypeDef stats;
+
+    Sim_Setup(1);
+    memset(&reg_model, 0, sizeof(reg_model));
+    for (uint8_t i = 0; i < sizeof(raw); i++)
+    {
+        reg_model.regs[0xF7 + i] = (uint8_t)(0x50U + i);
+    }
+    Sim_I2C_Attach(I2C1, SIM_REG_ADDR, Sim_Reg_Write, &reg_model);
+    Sim_I2C_SetReader(I2C1, SIM_REG_ADDR, Sim_Reg_Read);
+
+    I2C_Bus_Init(&hbus1, &hi2c1);
+    I2C_Bus_SetProfile(&hbus1, LCD_ADDR, &I2C_Bus_Standard);
+    I2C_Bus_SetProfile(&hbus1, SIM_REG_ADDR, &I2C_Bus_Fast);
+    LCD_Init(&hlcd, &hi2c1, LCD_ADDR);
+    LCD_SetBus(&hlcd, &hbus1);
+    ok &= Sim_Check(LCD_WaitIdle(&hlcd) == HAL_OK, "init drained");
+
+    // Let the hold of the init's return home run out, then redraw
+    Sim_Busy(LCD_CLEAR_DELAY_US * 1000ULL);
+    Sim_ResetStats();
+    LCD_WriteString(&hlcd, 0, 0, "0123456789ABCDEF");
+    LCD_WriteString(&hlcd, 0, 1, "FEDCBA9876543210");
+    LCD_Flush(&hlcd);
+    Sim_Busy(1000000ULL);
+    ok &= Sim_Check(hbus1.current == &hlcd.xfer, "display chunk running");
+
+    uint64_t submitted = Sim_Now();
+    ok &= Sim_Check(I2C_Bus_Submit(&hbus1, &read) == HAL_OK, "submit");
+    ok &= Sim_Check(I2C_Bus_Submit(&hbus1, &read) == HAL_BUSY, "pending descriptor refused");
+    ok &= Sim_Check(Bus_Wait(&read) && read.status == HAL_OK, "register read");
+    ok &= Sim_Check(memcmp(raw, &reg_model.regs[0xF7], sizeof(raw)) == 0, "register contents");
+    ok &= Sim_Check(bus_lcdBusy, "read went ahead of the display");
+
+    uint32_t latency = (uint32_t)((bus_doneNs - submitted) / 1000U);
+    ok &= Sim_Check(latency < (LCD_BUS_CHUNK_MAX + 4U) * SIM_BYTE_100K_US, "waited for one chunk only");
+
+    write.op = I2C_BUS_OP_MEM_WRITE;
+    write.memAddr = 0xF4;
+    write.pData = config;
+    write.size = sizeof(config);
+    ok &= Sim_Check(I2C_Bus_Submit(&hbus1, &write) == HAL_OK && Bus_Wait(&write) && write.status == HAL_OK,
+                    "register write");
+    ok &= Sim_Check(memcmp(&reg_model.regs[0xF4], config, sizeof(config)) == 0, "written registers");
+    ok &= Sim_Check(bus_lcdBusy, "write went ahead of the display");
+
+    // Address and register address of a read take 72 us at 400 kHz
+    ok &= Sim_Check(Sim_Stats.irqMaxNs < SIM_IRQ_MAX_NS, "no address phase polled in an interrupt");
+
+    absent.addr = SIM_ABSENT_ADDR;
+    ok &= Sim_Check(I2C_Bus_Submit(&hbus1, &absent) == HAL_OK && Bus_Wait(&absent), "absent device");
+    ok &= Sim_Check(absent.status == HAL_ERROR && (absent.error & HAL_I2C_ERROR_AF) != 0U, "absent device NACK");
+
+    ok &= Sim_Check(LCD_WaitIdle(&hlcd) == HAL_OK, "flush drained");
+    ok &= Sim_Check(Sim_LineIs(0, "0123456789ABCDEF") && Sim_LineIs(1, "FEDCBA9876543210"), "display contents");
+    ok &= Sim_Check(lcd_model.violations == 0U, "controller timing");
+    ok &= Sim_Check(I2C_Bus_GetStats(&hbus1, SIM_REG_ADDR, &stats) == HAL_OK && stats.transactions == 2U &&
+                        stats.bytes == sizeof(raw) + sizeof(config),
+                    "register statistics");
+    Sim_Report("bus arbitration", ok);
+    Sim_BusReport();
+    printf("    register read done %lu us after submit, display still queued\n", (unsigned long)latency);
+    return ok;
+}
+
+static uint8_t Stuck_DriveSda(void *ctx)
+{
+    return ((Sim_StuckTypeDef *)ctx)->bits == 0U;
+}
+
+static uint8_t Stuck_DriveScl(void *ctx)
+{
+    (void)ctx;
+    return 1;
+}
+
+static void Stuck_SclChanged(void *ctx, uint8_t level, uint64_t now)
+{
+    Sim_StuckTypeDef *dev = (Sim_StuckTypeDef *)ctx;
+    (void)now;
+
+    if (level == 0U)
+    {
+        dev->clocks++;
+        if (dev->bits != 0U && dev->bits != SIM_STUCK_FOREVER)
+        {
+            dev->bits--;
+        }
+    }
+}
+
+static const Sim_PinDeviceTypeDef stuck_sda = {Stuck_DriveSda, NULL};
+static const Sim_PinDeviceTypeDef stuck_scl = {Stuck_DriveScl, Stuck_SclChanged};
+
+/* Run the main loop until the LCD queue and xfer (if any) are done, keeping
+ * the longest single pass, interrupts included */
+static uint8_t Recovery_Poll(I2C_Bus_TransactionTypeDef *xfer, uint64_t *stall)
+{
+    uint64_t start = Sim_Now();
+
+    while ((!LCD_IsIdle(&hlcd) || (xfer != NULL && xfer->pending)) && Sim_Now() - start < SIM_ASYNC_TIMEOUT_NS)
+    {
+        uint64_t pass = Sim_Now();
+        LCD_Process(&hlcd);
+        Sim_Busy(SIM_POLL_COST_NS);
+        pass = Sim_Now() - pass;
+        if (pass > *stall)
+        {
+            *stall = pass;
+        }
+    }
+    return LCD_IsIdle(&hlcd) && (xfer == NULL || !xfer->pending);
+}
+
+/* Redraw a row and return once its chunk is on the wire */
+static uint8_t Recovery_Redraw(uint8_t row, const char *text)
+{
+    LCD_WriteString(&hlcd, 0, row, text);
+    LCD_Flush(&hlcd);
+    Sim_Busy(200000ULL);
+    return hbus1.current == &hlcd.xfer;
+}
+
+/* Faults on the shared bus: NACKs are resent after a backoff, a bus error
+ * that leaves a slave holding SDA is clocked free, a transfer that never
+ * ends is aborted, and a line held for good fails a read in milliseconds
+ * instead of the HAL's 25 ms per attempt. No pass of the loop stalls */
+static uint8_t Scenario_Recovery(void)
+{
+    uint8_t ok = 1;
+    uint8_t raw[2];
+    I2C_Bus_TransactionTypeDef read = {.addr = SIM_REG_ADDR,
+                                       .op = I2C_BUS_OP_MEM_READ,
+                                       .priority = I2C_BUS_PRIORITY_SENSOR,
+                                       .memAddr = 0x10,
+                                       .memAddrSize = I2C_MEMADD_SIZE_8BIT,
+                                       .pData = raw,
+                                       .size = sizeof(raw),
+                                       .retries = I2C_BUS_RETRIES};
+    I2C_Bus_StatsTypeDef stats;
+    uint64_t stall = 0;
+
+    Sim_Setup(1);
+    memset(&reg_model, 0, sizeof(reg_model));
+    memset(&stuck_model, 0, sizeof(stuck_model));
+    Sim_I2C_Attach(I2C1, SIM_REG_ADDR, Sim_Reg_Write, &reg_model);
+    Sim_I2C_SetReader(I2C1, SIM_REG_ADDR, Sim_Reg_Read);
+    Sim_I2C_ConnectPins(I2C1, GPIOB, GPIO_PIN_6, GPIOB, GPIO_PIN_7);
+    Sim_GPIO_Attach(GPIOB, GPIO_PIN_6, &stuck_scl, &stuck_model);
+    Sim_GPIO_Attach(GPIOB, GPIO_PIN_7, &stuck_sda, &stuck_model);
+
+    I2C_Bus_Init(&hbus1, &hi2c1);
+    I2C_Bus_SetPins(&hbus1, GPIOB, GPIO_PIN_6, GPIOB, GPIO_PIN_7);
+    I2C_Bus_SetProfile(&hbus1, LCD_ADDR, &I2C_Bus_Standard);
+    LCD_Init(&hlcd, &hi2c1, LCD_ADDR);
+    LCD_SetBus(&hlcd, &hbus1);
+    ok &= Sim_Check(LCD_WaitIdle(&hlcd) == HAL_OK, "init drained");
+    Sim_Busy(LCD_CLEAR_DELAY_US * 1000ULL);
+    Sim_ResetStats();
+    I2C_Bus_ResetStats(&hbus1);
+
+    // The expander misses its address twice: the chunk goes out on the third try
+    Sim_I2C_InjectFault(I2C1, HAL_I2C_ERROR_AF, 2);
+    LCD_WriteString(&hlcd, 0, 0, "NACK resent");
+    LCD_Flush(&hlcd);
+    ok &= Sim_Check(Recovery_Poll(NULL, &stall), "drained after NACKs");
+    ok &= Sim_Check(Sim_LineIs(0, "NACK resent"), "contents after NACKs");
+    ok &= Sim_Check(hbus1.recoveries == 0U, "no recovery for a NACK");
+
+    // Bus error with a slave left five clocks into a byte
+    ok &= Sim_Check(Recovery_Redraw(1, "bus error fixed"), "display chunk running");
+    stuck_model.bits = 5;
+    Sim_I2C_InjectFault(I2C1, HAL_I2C_ERROR_BERR, 1);
+    ok &= Sim_Check(Recovery_Poll(NULL, &stall), "drained after bus error");
+    ok &= Sim_Check(Sim_LineIs(1, "bus error fixed"), "contents after bus error");
+    ok &= Sim_Check(hbus1.recoveries == 1U && stuck_model.bits == 0U && stuck_model.clocks == 5U,
+                    "stuck slave clocked free");
+
+    // SCL stretched forever: no interrupt comes, I2C_Bus_Process() aborts it
+    ok &= Sim_Check(Recovery_Redraw(0, "hang aborted"), "display chunk running");
+    Sim_I2C_InjectFault(I2C1, HAL_I2C_ERROR_TIMEOUT, 1);
+    ok &= Sim_Check(Recovery_Poll(NULL, &stall), "drained after hang");
+    ok &= Sim_Check(Sim_LineIs(0, "hang aborted"), "contents after hang");
+    ok &= Sim_Check(hbus1.recoveries == 2U, "hang recovered");
+
+    ok &= Sim_Check(I2C_Bus_GetStats(&hbus1, LCD_ADDR, &stats) == HAL_OK && stats.nacks == 2U &&
+                        stats.errors == 1U && stats.timeouts == 1U && stats.retries == 4U,
+                    "display statistics");
+    ok &= Sim_Check(lcd_model.violations == 0U, "controller timing");
+
+    // SDA held for good: every attempt recovers in vain, then the read fails
+    stuck_model.bits = SIM_STUCK_FOREVER;
+    Sim_Busy(0); // The peripheral sees the line before the submit
+    uint64_t submitted = Sim_Now();
+    ok &= Sim_Check(I2C_Bus_Submit(&hbus1, &read) == HAL_OK && Recovery_Poll(&read, &stall), "stuck read ended");
+    uint64_t failed_us = (Sim_Now() - submitted) / 1000U;
+    ok &= Sim_Check(read.status == HAL_ERROR && (read.error & HAL_I2C_ERROR_TIMEOUT) != 0U, "stuck read failed");
+    ok &= Sim_Check(failed_us < 5000U, "stuck read failed fast");
+
+    stuck_model.bits = 0;
+    reg_model.regs[0x10] = 0xA5;
+    ok &= Sim_Check(I2C_Bus_Submit(&hbus1, &read) == HAL_OK && Recovery_Poll(&read, &stall) &&
+                        read.status == HAL_OK && raw[0] == 0xA5,
+                    "read once released");
+
+    ok &= Sim_Check(stall < SIM_RECOVERY_STALL_NS, "no stall");
+    ok &= Sim_Check(Sim_Stats.irqMaxNs < SIM_IRQ_MAX_NS, "no recovery in an interrupt");
+    Sim_Report("bus recovery", ok);
+    Sim_BusReport();
+    printf("    %lu recoveries, stuck read failed after %lu us, longest loop pass %lu us, longest handler %lu us\n",
+           (unsigned long)hbus1.recoveries, (unsigned long)failed_us, (unsigned long)(stall / 1000U),
+           (unsigned long)(Sim_Stats.irqMaxNs / 1000U));
+    return ok;
+}
+
+static void App_SampleTask(void *arg)
+{
+    DHT22_StartAsync((DHT22_HandleTypeDef *)arg);
+}
+
+static void App_LcdTask(void *arg)
+{
+    LCD_HandleTypeDef *LCDx = (LCD_HandleTypeDef *)arg;
+
+    LCD_Process(LCDx);
+    if (LCD_IsIdle(LCDx))
+    {
+        Scheduler_Reschedule(&sched, lcd_task, SIM_APP_LCD_PARK_MS);
+    }
+}
+
+static void App_ShowReading(void *arg)
+{
+    DHT22_HandleTypeDef *dht22x = (DHT22_HandleTypeDef *)arg;
+    char line[LCD_COLS + 1] = "Temp: ";
+    char value[DHT22_FORMAT_SIZE];
+
+    DHT22_History_Push(&history, dht22x->reading.humidity, dht22x->reading.temperature);
+
+    LCD_ClearFrame(&hlcd);
+    DHT22_FormatDeci(value, dht22x->reading.temperature);
+    strcat(line, value);
+    strcat(line, " C");
+    LCD_WriteString(&hlcd, 0, 0, line);
+    strcpy(line, "Humidity: ");
+    DHT22_FormatDeci(value, dht22x->reading.humidity);
+    strcat(line, value);
+    strcat(line, "%");
+    LCD_WriteString(&hlcd, 0, 1, line);
+    LCD_Flush(&hlcd);
+    Scheduler_Reschedule(&sched, lcd_task, 0);
+}
+
+static void App_ReadCplt(DHT22_HandleTypeDef *dht22x, HAL_StatusTypeDef status)
+{
+    if (status == HAL_OK)
+    {
+        Scheduler_Post(&sched, App_ShowReading, dht22x);
+    }
+}
+
+static void App_Idle(uint32_t sleep_ms)
+{
+    // Sleep until the next task or an interrupt, like LowPower_Idle()
+    Sim_Sleep((uint64_t)sleep_ms * 1000000U);
+}
+
+/* The cooperative main loop of main.c: sampling, history and display */
+static uint8_t Scenario_App(void)
+{
+    DHT22_History_StatsTypeDef temp;
+    uint8_t ok = 1;
+
+    Sim_Setup(1);
+    DHT22_Init(&dht22, &htim1, GPIOA, GPIO_PIN_0);
+    DHT22_Init_Async(&dht22, &htim2, TIM_CHANNEL_1, App_ReadCplt);
+    I2C_Bus_Init(&hbus1, &hi2c1);
+    I2C_Bus_SetProfile(&hbus1, LCD_ADDR, &I2C_Bus_Standard);
+    LCD_Init(&hlcd, &hi2c1, LCD_ADDR);
+    LCD_SetBus(&hlcd, &hbus1);
+    DHT22_History_Init(&history);
+    history_1min = DHT22_History_AddWindow(&history, 60000U / DHT22_MIN_INTERVAL_MS);
+    Sim_DHT22_Set(&sensor, 455, 234);
+
+    Scheduler_Init(&sched, HAL_GetTick, App_Idle);
+    Scheduler_AddTask(&sched, App_SampleTask, &dht22, 0, DHT22_MIN_INTERVAL_MS);
+    lcd_task = Scheduler_AddTask(&sched, App_LcdTask, &hlcd, 0, 1);
+
+    Sim_ResetStats();
+    uint8_t changed = 0;
+    while (Sim_Now() < SIM_APP_RUN_MS * 1000000ULL)
+    {
+        if (!changed && Sim_Now() >= SIM_APP_CHANGE_MS * 1000000ULL)
+        {
+            Sim_DHT22_Set(&sensor, 480, 251);
+            changed = 1;
+        }
+        Scheduler_Dispatch(&sched);
+    }
+    LCD_WaitIdle(&hlcd);
+
+    ok &= Sim_Check(sensor.frames >= SIM_APP_RUN_MS / DHT22_MIN_INTERVAL_MS, "sample rate");
+    ok &= Sim_Check(sensor.earlyTriggers == 0U, "trigger interval");
+    ok &= Sim_Check(DHT22_History_GetStats(&history, history_1min, DHT22_HISTORY_TEMPERATURE, &temp) != 0U &&
+                        temp.min == 234 && temp.max == 251,
+                    "history window");
+    ok &= Sim_Check(Sim_LineIs(0, "Temp: 25.1 C") && Sim_LineIs(1, "Humidity: 48.0%"), "display contents");
+    ok &= Sim_Check(lcd_model.violations == 0U, "controller timing");
+    Sim_Report("app 60 s", ok);
+    Sim_BusReport();
+    printf("    %lu frames, CPU busy %.3f %% of the time\n", (unsigned long)sensor.frames,
+           100.0 * Sim_Stats.busyNs / (double)(Sim_Stats.busyNs + Sim_Stats.sleepNs));
+    return ok;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             Interrupt callbacks                            */
+/* -------------------------------------------------------------------------- */
+
+void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim)
+{
+    DHT22_TIM_IC_CaptureCallback(&dht22, htim);
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    DHT22_TIM_PeriodElapsedCallback(&dht22, htim);
+}
+
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    I2C_Bus_MasterTxCpltCallback(&hbus1, hi2c);
+    LCD_I2C_MasterTxCpltCallback(&hlcd, hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    I2C_Bus_ErrorCallback(&hbus1, hi2c);
+    LCD_I2C_ErrorCallback(&hlcd, hi2c);
+}
+
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    I2C_Bus_MasterRxCpltCallback(&hbus1, hi2c);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    I2C_Bus_MemTxCpltCallback(&hbus1, hi2c);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    I2C_Bus_MemRxCpltCallback(&hbus1, hi2c);
+}
+
+int main(void)
+{
+    int failed = 0;
+
+    printf("poll cost %u ns, times in virtual microseconds\n", (unsigned)SIM_POLL_COST_NS);
+
+    failed += !Scenario_DHT22_Blocking();
+    failed += !Scenario_DHT22_Faults();
+    failed += !Scenario_DHT22_Async();
+    failed += !Scenario_DHT22_Group();
+    failed += !Scenario_History();
+    failed += !Scenario_FlashLog();
+    failed += !Scenario_LCD("lcd 100k dma", &I2C_Bus_Standard, 1, 1);
+    failed += !Scenario_LCD("lcd 400k dma", &I2C_Bus_Fast, 1, 1);
+    failed += !Scenario_LCD("lcd 100k irq", &I2C_Bus_Standard, 0, 1);
+    failed += !Scenario_LCD("lcd 100k blocking", &I2C_Bus_Standard, 0, 0);
+    failed += !Scenario_Scroller();
+    failed += !Scenario_Bus();
+    failed += !Scenario_Recovery();
+    failed += !Scenario_App();
+
+    printf("%d scenario(s) failed\n", failed);
+    return failed;
+}
@@ -0,0 +1,179 @@
+/**
+ ******************************************************************************
+ * @file           : telemetry_decode.c
+ * @brief          : Host decoder for the UART telemetry stream.
+ *                   Prints the messages found in a capture of USART1 TX and
+ *                   measures the frame codec throughput.
+ ******************************************************************************
+ * @attention
+ *
+ * Build on the host, from the repository root:
+ *
+ *   cc -O2 -I"My Library" -o telemetry_decode Tools/telemetry_decode.c \
+ *      "My Library/Telemetry_Frame.c" "My Library/CRC16.c"
+ *
+ * Usage:
+ *
+ *   telemetry_decode [capture]   decode a raw byte capture, stdin if omitted
+ *                                (e.g. stty -F /dev/ttyUSB0 115200 raw;
+ *                                 telemetry_decode < /dev/ttyUSB0)
+ *   telemetry_decode --bench     encode/decode speed on this host and the
+ *                                frame rates the line allows
+ *
+ ******************************************************************************
+ */
+
+#include "Telemetry_Frame.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* UART frame: start bit, 8 data bits, stop bit */
+#define BITS_PER_BYTE 10U
+
+/* Frames coded per benchmark run */
+#define BENCH_FRAMES 1000000U
+
+static void PrintDeci(int16_t value)
+{
+    int v = (value < 0) ? -value : value;
+    printf("%s%d.%d", (value < 0) ? "-" : "", v / 10, v % 10);
+}
+
+static void PrintMessage(const Telemetry_MessageTypeDef *msg)
+{
+    printf("%10lu ms  #%-3u ", (unsigned long)msg->tick, (unsigned)msg->seq);
+
+    switch (msg->type)
+    {
+    case TELEMETRY_MSG_READING:
+        printf("reading  T ");
+        PrintDeci(msg->reading.temperature);
+        printf(" C  RH ");
+        PrintDeci(msg->reading.humidity);
+        printf(" %%\n");
+        break;
+    case TELEMETRY_MSG_POWER:
+        printf("power    duty %u.%u %%  avg %lu uA\n", msg->power.duty_permille / 10U,
+               msg->power.duty_permille % 10U, (unsigned long)msg->power.average_ua);
+        break;
+    default:
+        break;
+    }
+}
+
+static int Decode(FILE *in)
+{
+    Telemetry_DecoderTypeDef dec;
+    Telemetry_MessageTypeDef msg;
+    uint32_t unknown = 0;
+    uint32_t gaps = 0;
+    int have_seq = 0;
+    uint8_t next_seq = 0;
+    int c;
+
+    Telemetry_DecoderInit(&dec);
+
+    while ((c = fgetc(in)) != EOF)
+    {
+        if (Telemetry_DecodeByte(&dec, (uint8_t)c) == 0U)
+        {
+            continue;
+        }
+        if (!Telemetry_Unpack(dec.payload, dec.payloadLen, &msg))
+        {
+            unknown++;
+            continue;
+        }
+
+        // The sender numbers every message, a jump means frames were lost
+        if (have_seq && msg.seq != next_seq)
+        {
+            gaps++;
+        }
+        have_seq = 1;
+        next_seq = (uint8_t)(msg.seq + 1U);
+
+        PrintMessage(&msg);
+        fflush(stdout);
+    }
+
+    fprintf(stderr, "frames %lu  crc errors %lu  framing errors %lu  unknown %lu  sequence gaps %lu\n",
+            (unsigned long)dec.frames, (unsigned long)dec.crcErrors, (unsigned long)dec.framingErrors,
+            (unsigned long)unknown, (unsigned long)gaps);
+
+    return (dec.crcErrors || dec.framingErrors) ? 1 : 0;
+}
+
+static double Seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int Bench(void)
+{
+    static const uint32_t bauds[] = {115200U, 921600U};
+    Telemetry_MessageTypeDef msg = {.type = TELEMETRY_MSG_READING, .reading = {.humidity = 555, .temperature = 234}};
+    Telemetry_DecoderTypeDef dec;
+    uint8_t payload[TELEMETRY_PAYLOAD_MAX];
+    uint8_t frame[TELEMETRY_FRAME_MAX];
+    size_t frame_len = 0;
+    uint32_t decoded = 0;
+
+    Telemetry_DecoderInit(&dec);
+
+    double start = Seconds();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++)
+    {
+        msg.seq = (uint8_t)i;
+        msg.tick = i;
+        frame_len = Telemetry_Encode(payload, Telemetry_Pack(&msg, payload), frame);
+        for (size_t k = 0; k < frame_len; k++)
+        {
+            if (Telemetry_DecodeByte(&dec, frame[k]) > 0U)
+            {
+                decoded++;
+            }
+        }
+    }
+    double elapsed = Seconds() - start;
+
+    printf("reading frame: %zu bytes, %zu bits on the line\n", frame_len, frame_len * BITS_PER_BYTE);
+    printf("host codec: %.0f frames/s encoded and decoded (%lu/%u ok)\n", BENCH_FRAMES / elapsed,
+           (unsigned long)decoded, BENCH_FRAMES);
+    for (size_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++)
+    {
+        printf("%7lu baud: %lu frames/s max\n", (unsigned long)bauds[i],
+               (unsigned long)(bauds[i] / (frame_len * BITS_PER_BYTE)));
+    }
+
+    return (decoded == BENCH_FRAMES) ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+    {
+        return Bench();
+    }
+
+    FILE *in = stdin;
+    if (argc > 1)
+    {
+        in = fopen(argv[1], "rb");
+        if (in == NULL)
+        {
+            perror(argv[1]);
+            return 2;
+        }
+    }
+
+    int rc = Decode(in);
+    if (in != stdin)
+    {
+        fclose(in);
+    }
+    return rc;
+}